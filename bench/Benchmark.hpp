@@ -0,0 +1,182 @@
+#pragma once
+
+#include "PerfCounters.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Minimal Google Benchmark style harness, without the dependency:
+//
+//     static void benchFoo(BenchState& state)
+//     {
+//         setup...
+//         for (auto _ : state)
+//         {
+//             foo(); doNotOptimize(result);
+//         }
+//         state.setItemsProcessed(samples per iteration);
+//     }
+//
+// Each case is calibrated to run for about MinSeconds, then reports
+// ns per iteration and per item, plus cycles, IPC and cache misses
+// when PerfCounters are available.
+
+template <typename T>
+inline void doNotOptimize(T const& value)
+{
+#ifdef _MSC_VER
+    _ReadWriteBarrier();
+    (void)value;
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+class BenchState
+{
+public:
+    BenchState(std::vector<int> args, int64_t iterations, PerfCounters& counters)
+        : _args(std::move(args)), _iterations(iterations), _counters(counters) {}
+
+    int     arg(size_t index) const { return _args[index]; }
+    int64_t iterations()      const { return _iterations; }
+
+    void setItemsProcessed(int64_t itemsPerIteration) { _itemsPerIteration = itemsPerIteration; }
+
+    // not trivially destructible, so "auto _" doesn't warn as unused
+    struct Value
+    {
+        ~Value() {}
+    };
+
+    struct Iterator
+    {
+        BenchState* state;
+        int64_t     remaining;
+
+        bool operator!=(const Iterator&)
+        {
+            if (remaining > 0)
+            {
+                return true;
+            }
+            state->stopTiming();
+            return false;
+        }
+        void  operator++() { --remaining; }
+        Value operator*() const { return {}; }
+    };
+
+    Iterator begin()
+    {
+        _counters.start();
+        _start = std::chrono::steady_clock::now();
+        return { this, _iterations };
+    }
+    Iterator end() { return { this, 0 }; }
+
+    double               seconds()           const { return _seconds; }
+    int64_t              itemsPerIteration() const { return _itemsPerIteration; }
+    PerfCounters::Values counterValues()     const { return _values; }
+
+private:
+    void stopTiming()
+    {
+        _seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+        _values  = _counters.stop();
+    }
+
+    std::vector<int>                      _args;
+    int64_t                               _iterations;
+    PerfCounters&                         _counters;
+    int64_t                               _itemsPerIteration = 1;
+    std::chrono::steady_clock::time_point _start;
+    double                                _seconds = 0;
+    PerfCounters::Values                  _values  = {};
+};
+
+class BenchRunner
+{
+public:
+    using Function = std::function<void(BenchState&)>;
+
+    static constexpr double MinSeconds = 0.2;
+
+    void add(std::string name, Function function, std::vector<std::vector<int>> argSets = { {} })
+    {
+        for (auto& args : argSets)
+        {
+            _cases.push_back({ name, function, args });
+        }
+    }
+
+    void run()
+    {
+        PerfCounters counters;
+        printf("%-36s %12s %10s %10s %8s %12s\n",
+               "benchmark", "ns/iter", "ns/item", "cyc/item", "IPC", "miss/iter");
+
+        for (auto& c : _cases)
+        {
+            // grow until the run is long enough to trust
+            int64_t iterations = 1;
+            while (true)
+            {
+                BenchState state(c.args, iterations, counters);
+                c.function(state);
+
+                if (state.seconds() >= MinSeconds || iterations >= (int64_t)1 << 40)
+                {
+                    report(c, state, counters.available());
+                    break;
+                }
+
+                auto scale = state.seconds() > 0 ? MinSeconds * 1.4 / state.seconds() : 10.0;
+                iterations = (int64_t)(iterations * std::min(std::max(scale, 2.0), 100.0));
+            }
+        }
+    }
+
+private:
+    struct Case
+    {
+        std::string      name;
+        Function         function;
+        std::vector<int> args;
+    };
+
+    static void report(const Case& c, const BenchState& state, bool hasCounters)
+    {
+        auto name = c.name;
+        for (auto arg : c.args)
+        {
+            name += "/" + std::to_string(arg);
+        }
+
+        auto iterations = (double)state.iterations();
+        auto items      = iterations * state.itemsPerIteration();
+        auto values     = state.counterValues();
+
+        printf("%-36s %12.1f %10.3f", name.c_str(), state.seconds() * 1e9 / iterations, state.seconds() * 1e9 / items);
+        if (hasCounters && values.cycles)
+        {
+            printf(" %10.3f %8.2f %12.1f\n",
+                   values.cycles / items, (double)values.instructions / values.cycles, values.cacheMisses / iterations);
+        }
+        else
+        {
+            printf(" %10s %8s %12s\n", "-", "-", "-");
+        }
+    }
+
+    std::vector<Case> _cases;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <inttypes.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <string.h>
+#endif
+
+// Hardware counters of the calling thread through perf_event_open.
+// available() is false off Linux, or when perf_event_paranoid or the
+// container forbids it, the benchmarks then only report time.
+class PerfCounters
+{
+public:
+    struct Values
+    {
+        uint64_t cycles;
+        uint64_t instructions;
+        uint64_t cacheMisses;
+    };
+
+    PerfCounters(const PerfCounters&)            = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+#ifdef __linux__
+    PerfCounters()
+    {
+        _fds[0] = open(PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (_fds[0] < 0)
+        {
+            return;
+        }
+        _fds[1] = open(PERF_COUNT_HW_INSTRUCTIONS, _fds[0]);
+        _fds[2] = open(PERF_COUNT_HW_CACHE_MISSES, _fds[0]);
+    }
+
+    ~PerfCounters()
+    {
+        for (auto fd : _fds)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+
+    bool available() const { return _fds[0] >= 0 && _fds[1] >= 0 && _fds[2] >= 0; }
+
+    void start()
+    {
+        if (available())
+        {
+            ioctl(_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    Values stop()
+    {
+        Values values = {};
+        if (!available())
+        {
+            return values;
+        }
+
+        ioctl(_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // PERF_FORMAT_GROUP: count, then one value per event
+        uint64_t data[4] = {};
+        if (read(_fds[0], data, sizeof(data)) == sizeof(data))
+        {
+            values = { data[1], data[2], data[3] };
+        }
+        return values;
+    }
+
+private:
+    static int open(uint64_t config, int groupFd)
+    {
+        perf_event_attr attr = {};
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof(attr);
+        attr.config         = config;
+        attr.disabled       = groupFd < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP;
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+    }
+
+    int _fds[3] = { -1, -1, -1 };
+#else
+    PerfCounters() = default;
+
+    bool   available() const { return false; }
+    void   start() {}
+    Values stop() { return {}; }
+#endif
+};
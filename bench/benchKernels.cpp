@@ -0,0 +1,297 @@
+/**
+ * @file pcm kernel micro-benchmarks
+ *
+ * The hot inner operations of the decode paths, measured in isolation
+ * across block sizes and channel counts:
+ * - interleave as decode() does it in main.cpp and testDecode.cpp (vector insert per sample)
+ * - interleave as testStreamPlay.cpp does it (memcpy per sample)
+ * - PcmKernels interleaveFloat / interleaveS16
+ * - PcmKernels mixStereo, one stream of Mixer::mix()
+ * - PcmKernels interleaveMatrix downmixing to stereo, against interleaving
+ *   first and remixing in a second pass
+ * - tmpBuf carry-over of testStreamPlay.cpp
+ * - memmove refill of testDecode.cpp
+ */
+
+#include "Benchmark.hpp"
+#include "PcmKernels.hpp"
+
+#include <cmath>
+#include <vector>
+
+#include <string.h>
+
+constexpr int RefillThresh = 4096; // as testDecode.cpp
+
+// block size in samples per channel, channel count
+static const std::vector<std::vector<int>> BlockArgs =
+{
+    { 256, 1 }, { 256, 2 }, { 256, 6 },
+    { 1152, 1 }, { 1152, 2 }, { 1152, 6 },
+    { 4096, 2 }, { 16384, 2 }, { 16384, 6 },
+};
+
+// block size in samples per channel, source channel count
+static const std::vector<std::vector<int>> MixArgs =
+{
+    { 256, 1 }, { 256, 2 }, { 1024, 1 }, { 1024, 2 }, { 4096, 2 },
+};
+
+// block size in samples per channel, source channel count downmixed to stereo
+static const std::vector<std::vector<int>> DownmixArgs =
+{
+    { 1152, 6 }, { 4096, 6 }, { 1152, 8 }, { 4096, 8 },
+};
+
+// bytes of a streaming buffer
+static const std::vector<std::vector<int>> BufferArgs =
+{
+    { 4096 }, { 65536 }, { 1 << 20 },
+};
+
+static std::vector<std::vector<float>> makePlanes(int blockSize, int channelsNum)
+{
+    std::vector<std::vector<float>> planes(channelsNum, std::vector<float>(blockSize));
+    for (int ch = 0; ch < channelsNum; ++ch)
+    {
+        for (int i = 0; i < blockSize; ++i)
+        {
+            planes[ch][i] = (float)std::sin(0.01 * i * (ch + 1));
+        }
+    }
+    return planes;
+}
+
+static std::vector<const float*> planePointers(const std::vector<std::vector<float>>& planes)
+{
+    std::vector<const float*> pointers;
+    for (auto& plane : planes)
+    {
+        pointers.push_back(plane.data());
+    }
+    return pointers;
+}
+
+static void benchInterleaveInsert(BenchState& state)
+{
+    auto blockSize = state.arg(0), channelsNum = state.arg(1);
+    auto planes    = makePlanes(blockSize, channelsNum);
+    auto data      = planePointers(planes);
+    auto dataSize  = (int)sizeof(float);
+
+    std::vector<uint8_t> pcm;
+    for (auto _ : state)
+    {
+        pcm.clear();
+        for (int i = 0; i < blockSize; ++i)
+        {
+            for (int ch = 0; ch < channelsNum; ++ch)
+            {
+                auto p = (const uint8_t*)data[ch];
+                pcm.insert(pcm.end(), p + dataSize * i, p + dataSize * (i + 1));
+            }
+        }
+        doNotOptimize(pcm.data());
+    }
+    state.setItemsProcessed((int64_t)blockSize * channelsNum);
+}
+
+static void benchInterleaveMemcpy(BenchState& state)
+{
+    auto blockSize  = state.arg(0), channelsNum = state.arg(1);
+    auto planes     = makePlanes(blockSize, channelsNum);
+    auto data       = planePointers(planes);
+    auto sampleSize = (int)sizeof(float);
+
+    std::vector<uint8_t> buffer((size_t)blockSize * channelsNum * sampleSize);
+    for (auto _ : state)
+    {
+        int storeSize = 0;
+        for (int i = 0; i < blockSize; ++i)
+        {
+            for (int ch = 0; ch < channelsNum; ++ch)
+            {
+                memcpy(buffer.data() + storeSize, (const uint8_t*)data[ch] + sampleSize * i, sampleSize);
+                storeSize += sampleSize;
+            }
+        }
+        doNotOptimize(buffer.data());
+    }
+    state.setItemsProcessed((int64_t)blockSize * channelsNum);
+}
+
+static void benchInterleaveFloat(BenchState& state)
+{
+    auto blockSize = state.arg(0), channelsNum = state.arg(1);
+    auto planes    = makePlanes(blockSize, channelsNum);
+    auto data      = planePointers(planes);
+
+    std::vector<float> out((size_t)blockSize * channelsNum);
+    for (auto _ : state)
+    {
+        interleaveFloat(data.data(), channelsNum, 0, blockSize, out.data());
+        doNotOptimize(out.data());
+    }
+    state.setItemsProcessed((int64_t)blockSize * channelsNum);
+}
+
+static void benchInterleaveS16(BenchState& state)
+{
+    auto blockSize = state.arg(0), channelsNum = state.arg(1);
+    auto planes    = makePlanes(blockSize, channelsNum);
+    auto data      = planePointers(planes);
+
+    std::vector<int16_t> out((size_t)blockSize * channelsNum);
+    for (auto _ : state)
+    {
+        interleaveS16(data.data(), channelsNum, 0, blockSize, out.data());
+        doNotOptimize(out.data());
+    }
+    state.setItemsProcessed((int64_t)blockSize * channelsNum);
+}
+
+// the first plane as interleaved input of channelsNum 1 or 2
+static void benchMixStereo(BenchState& state)
+{
+    auto blockSize = state.arg(0), channelsNum = state.arg(1);
+    auto planes    = makePlanes(blockSize * channelsNum, 1);
+
+    std::vector<float> out((size_t)blockSize * 2);
+    for (auto _ : state)
+    {
+        mixStereo(planes[0].data(), channelsNum, blockSize, 0.5f, 0.7f, out.data());
+        doNotOptimize(out.data());
+    }
+    state.setItemsProcessed((int64_t)blockSize * channelsNum);
+}
+
+// ITU downmix of 5.1 or 7.1 (FL FR FC LFE BL BR [SL SR]) to stereo,
+// normalized as ChannelMatrix::buildDefault() does, LFE dropped
+static std::vector<float> downmixMatrix(int channelsNum)
+{
+    constexpr float Minus3dB = 0.70710678f;
+
+    std::vector<float> matrix(2 * channelsNum, 0.0f);
+    for (int side = 0; side < 2; ++side)
+    {
+        auto row = matrix.data() + side * channelsNum;
+        row[side]     = 1.0f;
+        row[2]        = Minus3dB;
+        row[4 + side] = Minus3dB;
+        if (channelsNum == 8)
+        {
+            row[6 + side] = Minus3dB;
+        }
+    }
+
+    float sum = 0;
+    for (int c = 0; c < channelsNum; ++c)
+    {
+        sum += matrix[c];
+    }
+    for (auto& gain : matrix)
+    {
+        gain /= sum;
+    }
+    return matrix;
+}
+
+static void benchInterleaveMatrix(BenchState& state)
+{
+    auto blockSize = state.arg(0), channelsNum = state.arg(1);
+    auto planes    = makePlanes(blockSize, channelsNum);
+    auto pointers  = planePointers(planes);
+    auto matrix    = downmixMatrix(channelsNum);
+
+    std::vector<float> out((size_t)blockSize * 2);
+    for (auto _ : state)
+    {
+        interleaveMatrix(pointers.data(), channelsNum, 0, blockSize, matrix.data(), 2, out.data());
+        doNotOptimize(out.data());
+    }
+    state.setItemsProcessed((int64_t)blockSize * channelsNum);
+}
+
+// the separate pass interleaveMatrix() saves: interleave all channels, then remix
+static void benchInterleaveRemix(BenchState& state)
+{
+    auto blockSize = state.arg(0), channelsNum = state.arg(1);
+    auto planes    = makePlanes(blockSize, channelsNum);
+    auto pointers  = planePointers(planes);
+    auto matrix    = downmixMatrix(channelsNum);
+
+    std::vector<float> interleaved((size_t)blockSize * channelsNum);
+    std::vector<float> out((size_t)blockSize * 2);
+    for (auto _ : state)
+    {
+        interleaveFloat(pointers.data(), channelsNum, 0, blockSize, interleaved.data());
+        for (int i = 0; i < blockSize; ++i)
+        {
+            auto in = interleaved.data() + (size_t)i * channelsNum;
+            for (int o = 0; o < 2; ++o)
+            {
+                float sum = 0;
+                for (int c = 0; c < channelsNum; ++c)
+                {
+                    sum += matrix[o * channelsNum + c] * in[c];
+                }
+                out[i * 2 + o] = sum;
+            }
+        }
+        doNotOptimize(out.data());
+    }
+    state.setItemsProcessed((int64_t)blockSize * channelsNum);
+}
+
+// testStreamPlay's decode(): fill the buffer from tmpBuf and keep the rest,
+// with a frame and a half left over, as when a big frame overflows the buffer.
+static void benchCarryOver(BenchState& state)
+{
+    auto bufferSize = state.arg(0);
+
+    std::vector<uint8_t> source(bufferSize + bufferSize / 2, 1);
+    std::vector<uint8_t> buffer(bufferSize);
+    std::vector<uint8_t> tmpBuf;
+    for (auto _ : state)
+    {
+        tmpBuf = source;
+        memcpy(buffer.data(), tmpBuf.data(), bufferSize);
+        tmpBuf.assign(tmpBuf.begin() + bufferSize, tmpBuf.end());
+        doNotOptimize(tmpBuf.data());
+        doNotOptimize(buffer.data());
+    }
+    state.setItemsProcessed(bufferSize);
+}
+
+// testDecode's input refill: move the unparsed tail to the front, read behind it.
+static void benchRefill(BenchState& state)
+{
+    auto bufferSize = state.arg(0);
+
+    std::vector<uint8_t> buffer(bufferSize + RefillThresh, 1);
+    std::vector<uint8_t> file(bufferSize, 2);
+    for (auto _ : state)
+    {
+        size_t readSize = RefillThresh - 1;
+        memmove(buffer.data(), buffer.data() + bufferSize - readSize, readSize);
+        memcpy(buffer.data() + readSize, file.data(), bufferSize - readSize); // the fread
+        doNotOptimize(buffer.data());
+    }
+    state.setItemsProcessed(bufferSize);
+}
+
+int main()
+{
+    BenchRunner runner;
+    runner.add("interleave_insert", benchInterleaveInsert, BlockArgs);
+    runner.add("interleave_memcpy", benchInterleaveMemcpy, BlockArgs);
+    runner.add("interleave_float",  benchInterleaveFloat,  BlockArgs);
+    runner.add("interleave_s16",    benchInterleaveS16,    BlockArgs);
+    runner.add("mix_stereo",        benchMixStereo,        MixArgs);
+    runner.add("interleave_matrix", benchInterleaveMatrix, DownmixArgs);
+    runner.add("interleave_remix",  benchInterleaveRemix,  DownmixArgs);
+    runner.add("carry_over",        benchCarryOver,        BufferArgs);
+    runner.add("refill",            benchRefill,           BufferArgs);
+    runner.run();
+    return 0;
+}
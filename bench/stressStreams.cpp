@@ -0,0 +1,439 @@
+/**
+ * @file stream scalability stress test
+ *
+ * Play growing numbers of independent streams of a fixture, each decoded on a
+ * thread of its own the way playFastStart() in main.cpp does it, into null
+ * sinks that a shared clock drains in real time. Every level adds players,
+ * lets them settle for SettleSeconds and then counts underruns for
+ * HoldSeconds; the ramp stops at the first level that underruns.
+ *
+ * Reported per level and for the last clean one:
+ * - streams per core, the capacity figure
+ * - resident memory per stream, growth over the idle process divided by streams
+ * - p99 block latency, from a buffer of the rotation freeing to the next submit
+ *
+ * Usage: stressStreams [min streams per core]
+ * With a minimum the exit code is nonzero when the capacity falls below it.
+ */
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/log.h>
+#include <libavutil/samplefmt.h>
+}
+
+#include "FastStart.hpp"
+#include "Fixtures.hpp"
+#include "PcmKernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+constexpr int    StreamingBufferSize = 65536; // as main.cpp
+constexpr int    MaxBufferCount      = 3;
+constexpr int    TickMs              = 10;
+constexpr double SettleSeconds       = 1.0;
+constexpr double HoldSeconds         = 4.0;
+constexpr int    MaxStreams          = 4096;
+constexpr int    LatencyBucketUs     = 100;
+constexpr int    LatencyBuckets      = 10000; // up to a second
+constexpr auto   Fixture             = "stereo_44k_cbr_long"; // outlasts the ramp
+
+using Clock = std::chrono::steady_clock;
+
+// Block latencies of all players in LatencyBucketUs buckets.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram() : _counts(LatencyBuckets) {}
+
+    void add(Clock::duration latency)
+    {
+        auto us     = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        auto bucket = std::clamp<int64_t>(us / LatencyBucketUs, 0, LatencyBuckets - 1);
+        _counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+        for (auto& count : _counts)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // upper edge of the bucket holding the p quantile, 0 without samples
+    double quantileMs(double p) const
+    {
+        int64_t total = 0;
+        for (auto& count : _counts)
+        {
+            total += count.load(std::memory_order_relaxed);
+        }
+
+        int64_t seen = 0;
+        for (int i = 0; i < LatencyBuckets && total > 0; ++i)
+        {
+            seen += _counts[i].load(std::memory_order_relaxed);
+            if (seen >= p * total)
+            {
+                return (i + 1) * LatencyBucketUs / 1000.0;
+            }
+        }
+        return 0;
+    }
+
+private:
+    std::vector<std::atomic<int64_t>> _counts;
+};
+
+struct StressStats
+{
+    std::atomic<int64_t> underruns{ 0 }; // ticks a playing sink had too little queued for
+    std::atomic<int>     failures{ 0 };  // players which could not open or decode
+    LatencyHistogram     latency;
+};
+
+// Stands in for the source voice of one player. Blocks queue like submitted
+// XAUDIO2_BUFFERs and SinkClock plays TickMs of them per tick.
+class NullSink
+{
+public:
+    explicit NullSink(StressStats& stats) : _stats(stats) {}
+
+    void setFormat(int sampleRate)
+    {
+        std::lock_guard lock(_mutex);
+        _tickSamples = sampleRate * TickMs / 1000;
+    }
+
+    // wait like playFastStart's waitQueued(), false once stopped
+    bool waitQueued(int maxQueued)
+    {
+        std::unique_lock lock(_mutex);
+        _cv.wait(lock, [&] { return (int)_blocks.size() <= maxQueued || _isStopped; });
+        return !_isStopped;
+    }
+
+    // samples per channel, the first submit starts playback
+    void submit(int samples, bool isEnd)
+    {
+        std::lock_guard lock(_mutex);
+        if (_freedAt != Clock::time_point())
+        {
+            _stats.latency.add(Clock::now() - _freedAt);
+            _freedAt = {};
+        }
+        if (samples > 0)
+        {
+            _blocks.push_back(samples);
+        }
+        _isPlaying = true;
+        _isEnded   = isEnd;
+    }
+
+    void stop()
+    {
+        std::lock_guard lock(_mutex);
+        _isStopped = true;
+        _cv.notify_all();
+    }
+
+    void tick(Clock::time_point now)
+    {
+        std::lock_guard lock(_mutex);
+        if (!_isPlaying)
+        {
+            return;
+        }
+
+        auto need = _tickSamples;
+        while (need > 0 && !_blocks.empty())
+        {
+            auto count      = std::min(need, _blocks.front());
+            _blocks.front() -= count;
+            need            -= count;
+            if (_blocks.front() == 0)
+            {
+                // the first buffer freed since the last submit starts the latency
+                _blocks.pop_front();
+                if (_freedAt == Clock::time_point())
+                {
+                    _freedAt = now;
+                }
+                _cv.notify_all();
+            }
+        }
+
+        if (need > 0 && !_isEnded)
+        {
+            _stats.underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (_blocks.empty() && _isEnded)
+        {
+            _isPlaying = false;
+        }
+    }
+
+private:
+    StressStats& _stats;
+
+    std::mutex              _mutex;
+    std::condition_variable _cv;
+    std::deque<int>         _blocks;
+    int                     _tickSamples = 0;
+    Clock::time_point       _freedAt;
+    bool                    _isPlaying   = false;
+    bool                    _isEnded     = false;
+    bool                    _isStopped   = false;
+};
+
+// One clock for all sinks, on an absolute schedule so a late tick is made up
+// by the next ones instead of slowing playback down.
+class SinkClock
+{
+public:
+    SinkClock() : _thread([this] { clockLoop(); }) {}
+
+    ~SinkClock() { stop(); }
+
+    void add(NullSink* sink)
+    {
+        std::lock_guard lock(_mutex);
+        _sinks.push_back(sink);
+    }
+
+    void stop()
+    {
+        _isStopped = true;
+        if (_thread.joinable())
+        {
+            _thread.join();
+        }
+    }
+
+private:
+    void clockLoop()
+    {
+        auto next = Clock::now();
+        while (!_isStopped)
+        {
+            next += std::chrono::milliseconds(TickMs);
+            std::this_thread::sleep_until(next);
+
+            std::lock_guard lock(_mutex);
+            for (auto sink : _sinks)
+            {
+                sink->tick(next);
+            }
+        }
+    }
+
+    std::mutex             _mutex;
+    std::vector<NullSink*> _sinks;
+    std::atomic<bool>      _isStopped = false;
+    std::thread            _thread;
+};
+
+// playFastStart() of main.cpp with the source voice replaced by sink.
+static void playStream(const char* filename, NullSink& sink, StressStats& stats)
+{
+    FastStartInput input;
+    auto           frame = av_frame_alloc();
+    if (!frame || input.open(filename) < 0 || input.receiveFrame(frame) < 0 ||
+        frame->format != AV_SAMPLE_FMT_FLTP)
+    {
+        ++stats.failures;
+        av_frame_free(&frame);
+        return;
+    }
+    sink.setFormat(frame->sample_rate);
+
+    auto channelsNum   = frame->ch_layout.nb_channels;
+    auto bufferSamples = StreamingBufferSize / (int)sizeof(float) / channelsNum;
+
+    std::vector<std::vector<float>> buffers(MaxBufferCount, std::vector<float>(bufferSamples * channelsNum));
+    int  bufferIndex = 0;
+    int  storeCount  = 0;
+    bool isEnd       = false;
+    bool isStopped   = false;
+
+    auto submit = [&]
+    {
+        sink.submit(storeCount, isEnd);
+        bufferIndex = (bufferIndex + 1) % MaxBufferCount;
+        storeCount  = 0;
+    };
+
+    while (!isEnd && !isStopped)
+    {
+        for (int offset = 0; offset < frame->nb_samples && !isStopped;)
+        {
+            auto count = std::min(frame->nb_samples - offset, bufferSamples - storeCount);
+            interleaveFloat((const float* const*)frame->extended_data, channelsNum, offset, count,
+                            buffers[bufferIndex].data() + storeCount * channelsNum);
+            offset     += count;
+            storeCount += count;
+
+            if (storeCount == bufferSamples)
+            {
+                submit();
+                isStopped = !sink.waitQueued(MaxBufferCount - 1);
+            }
+        }
+        av_frame_unref(frame);
+
+        auto ret = input.receiveFrame(frame);
+        if (ret < 0 && ret != AVERROR_EOF)
+        {
+            ++stats.failures;
+            break;
+        }
+        isEnd = ret == AVERROR_EOF;
+    }
+    if (isEnd)
+    {
+        submit();
+    }
+    av_frame_free(&frame);
+}
+
+// resident set size of the process, 0 where unknown
+static int64_t residentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return (int64_t)counters.WorkingSetSize;
+    }
+#elif defined(__linux__)
+    long long pages, resident;
+    if (auto file = fopen("/proc/self/statm", "r"))
+    {
+        auto isRead = fscanf(file, "%lld %lld", &pages, &resident) == 2;
+        fclose(file);
+        if (isRead)
+        {
+            return resident * sysconf(_SC_PAGESIZE);
+        }
+    }
+#endif
+    return 0;
+}
+
+struct Player
+{
+    std::unique_ptr<NullSink> sink;
+    std::thread               thread;
+};
+
+struct LevelResult
+{
+    int     streamsNum;
+    int64_t underruns;
+    double  p99Ms;
+    double  bytesPerStream;
+};
+
+int main(int argc, char* argv[])
+{
+    av_log_set_level(AV_LOG_ERROR);
+
+    auto minPerCore = argc > 1 ? atof(argv[1]) : 0.0;
+    auto path       = fixturePath(Fixture);
+    auto coresNum   = (int)std::max(1u, std::thread::hardware_concurrency());
+
+    StressStats         stats;
+    SinkClock           clock;
+    std::vector<Player> players;
+
+    auto baseline   = residentBytes();
+    auto streamsNum = coresNum;
+
+    LevelResult best  = {};
+    bool        isCut = false; // the ramp underran before MaxStreams
+
+    printf("%d cores, %d x %d byte buffers per stream, %s\n", coresNum, MaxBufferCount, StreamingBufferSize, path.c_str());
+    printf("%8s %10s %10s %10s %12s\n", "streams", "per core", "underruns", "p99 ms", "KiB/stream");
+    while (streamsNum <= MaxStreams)
+    {
+        while ((int)players.size() < streamsNum)
+        {
+            auto& player = players.emplace_back();
+            player.sink  = std::make_unique<NullSink>(stats);
+            clock.add(player.sink.get());
+            player.thread = std::thread(playStream, path.c_str(), std::ref(*player.sink), std::ref(stats));
+        }
+
+        // the joining players fill their rotation at once, count from after that
+        std::this_thread::sleep_for(std::chrono::duration<double>(SettleSeconds));
+        stats.underruns = 0;
+        stats.latency.reset();
+        std::this_thread::sleep_for(std::chrono::duration<double>(HoldSeconds));
+
+        if (stats.failures > 0)
+        {
+            fprintf(stderr, "Could not play %s\n", path.c_str());
+            break;
+        }
+
+        LevelResult level = { streamsNum, stats.underruns.load(), stats.latency.quantileMs(0.99),
+                              (double)(residentBytes() - baseline) / streamsNum };
+        printf("%8d %10.1f %10lld %10.1f %12.1f\n", level.streamsNum, (double)level.streamsNum / coresNum,
+               (long long)level.underruns, level.p99Ms, level.bytesPerStream / 1024);
+
+        if (level.underruns > 0)
+        {
+            isCut = true;
+            break;
+        }
+        best        = level;
+        streamsNum += std::max(coresNum, streamsNum / 4);
+    }
+
+    for (auto& player : players)
+    {
+        player.sink->stop();
+    }
+    for (auto& player : players)
+    {
+        player.thread.join();
+    }
+    clock.stop();
+
+    if (stats.failures > 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    auto perCore = (double)best.streamsNum / coresNum;
+    printf("\nmax sustainable: %d streams, %.1f per core%s\n", best.streamsNum, perCore, isCut ? "" : " (ramp limit)");
+    printf("memory per stream: %.1f KiB\n", best.bytesPerStream / 1024);
+    printf("p99 block latency: %.1f ms\n", best.p99Ms);
+
+    if (minPerCore > 0 && perCore < minPerCore)
+    {
+        fprintf(stderr, "%.1f streams per core is below the minimum of %.1f\n", perCore, minPerCore);
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
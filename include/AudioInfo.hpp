@@ -13,11 +13,20 @@ class AudioInfo
 {
 public:
     AudioInfo(AVFormatContext* ctx);
+    // Without avformat_find_stream_info, the sample format is taken from the first
+    // decoded frame and the duration is unknown until setDuration().
+    AudioInfo(AVFormatContext* ctx, const AVFrame* firstFrame);
 
     WAVEFORMATEX getWaveFormat();
 
     const std::string_view type() { return _type; }
     AVCodecID codecID() { return _codecID; }
+    uint64_t duration() { return _duration; }
+
+    void setDuration(uint64_t duration) { _duration = duration; }
+
+    // the channels of the output format, when a ChannelMatrix remixes the source
+    void setChannelsNum(int channelsNum) { _channelsNum = channelsNum; }
 
 private:
     uint16_t getFormatTag();
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "FrameTap.hpp"
+
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Decode the audio stream of filename from start to end, and feed every
+// frame to taps, converted to planar float if the decoder outputs another format.
+// Taps that got begin() get end(), or abort() when decoding fails, corrupt
+// packets were skipped or fewer samples came out than the container states.
+// Return 0 on success or a negative AVERROR.
+int decodeFile(const char* filename, std::span<FrameTap* const> taps);
+
+// Decode files in parallel on ThreadPool::shared(), tapsOf(i) gives the taps of files[i].
+// Return decodeFile() result of every file.
+std::vector<int> decodeBatch(const std::vector<std::string>& files,
+                             const std::function<std::vector<FrameTap*>(size_t index)>& tapsOf);
@@ -0,0 +1,45 @@
+#pragma once
+
+extern "C"
+{
+#include <libavutil/channel_layout.h>
+}
+
+#include <vector>
+
+// Mapping of a source layout onto the output layout, out channel o being the
+// sum of gain(o, c) * input channel c. It is applied by interleaveMatrix()
+// while the planar frame is interleaved, so the remix costs no pass of its own.
+class ChannelMatrix
+{
+public:
+    ChannelMatrix() = default;
+
+    // all coefficients zero, set() the ones needed
+    ChannelMatrix(int inChannelsNum, int outChannelsNum);
+
+    static ChannelMatrix identity(int channelsNum);
+
+    // The matrix libswresample would use: ITU-R BS.775 downmix with center and
+    // surrounds at -3 dB and the LFE dropped unless lfeMixLevel says otherwise,
+    // upmix into the matching front channels. Normalized so no output can clip.
+    // Return 0 on success or a negative AVERROR.
+    int buildDefault(const AVChannelLayout& in, const AVChannelLayout& out, double lfeMixLevel = 0.0);
+
+    void  set(int out, int in, float gain) { _coefs[out * _inChannelsNum + in] = gain; }
+    float gain(int out, int in) const      { return _coefs[out * _inChannelsNum + in]; }
+
+    int inChannelsNum()  const { return _inChannelsNum; }
+    int outChannelsNum() const { return _outChannelsNum; }
+
+    bool isIdentity() const;
+
+    // samples [offset, offset + samples) of every input channel into out,
+    // interleaved in the output layout
+    void apply(const float* const* channels, int offset, int samples, float* out) const;
+
+private:
+    int                _inChannelsNum  = 0;
+    int                _outChannelsNum = 0;
+    std::vector<float> _coefs; // out * inChannelsNum + in
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "FrameTap.hpp"
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <vector>
+
+// A whole decoded track kept in memory, compressed in blocks as it is decoded
+// and decompressed on demand, for fully buffered playback (loops, scrubbing).
+// Samples are quantized to bitsPerSample (16, like PcmDiskCache, or 24), then
+// every block is coded losslessly like FLAC: fixed polynomial prediction of
+// order 0 to 4, left/side stereo, and rice coded residuals with a parameter
+// per partition. Blocks decode independently, so any position is one block away.
+class CompressedPcm : public FrameTap
+{
+public:
+    static constexpr int BlockSamples = 4096; // per channel
+
+    explicit CompressedPcm(int bitsPerSample = 16);
+
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+
+    int     sampleRate()  const { return _sampleRate; }
+    int     channelsNum() const { return _channelsNum; }
+    int64_t samplesNum()  const { return _samplesNum; }
+
+    size_t compressedBytes() const { return _compressedBytes; }
+    size_t rawBytes()        const { return (size_t)_samplesNum * _channelsNum * sizeof(float); }
+
+    // Decompress samples [start, start + count), clamped to the track, to interleaved float.
+    // Return the number of samples per channel written. The last decoded block is
+    // kept for the next call, so a reader must not share the object across threads.
+    int64_t read(int64_t start, int64_t count, float* out) const;
+
+private:
+    void encodeBlock();
+    void decodeBlock(int64_t block) const;
+
+    int   _bitsPerSample;
+    float _scale;
+
+    int     _sampleRate      = 0;
+    int     _channelsNum     = 0;
+    int64_t _samplesNum      = 0;
+    size_t  _compressedBytes = 0;
+
+    std::vector<std::vector<uint8_t>> _blocks;
+    std::vector<std::vector<int32_t>> _pending; // quantized samples of the open block, per channel
+    int                               _pendingCount = 0;
+
+    mutable int64_t              _decodedBlock = -1;
+    mutable std::vector<float>   _decoded;  // interleaved
+    mutable std::vector<int32_t> _planes;   // decoding scratch, channels after another
+};
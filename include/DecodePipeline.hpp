@@ -0,0 +1,39 @@
+#pragma once
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+#include "Generator.hpp"
+
+#include <span>
+
+#include <stdio.h>
+
+// testStreamPlay's streaming (read, parse, decode, fill the output buffers)
+// as generator stages, each pulling from the previous one only when asked for
+// its next element, so output demand drives exactly as much decoding as needed.
+//
+//     int error = 0;
+//     for (auto block : decodeBlocks(filename, StreamingBufferSize, error))
+//     {
+//         submit(block);
+//     }
+//     if (error < 0) ...
+//
+// A stage ending on an error stores the AVERROR in error.
+// Yielded packets and frames are valid until the next element is pulled.
+
+// Read file in the parser, yield the packets of whole frames.
+Generator<AVPacket*> parsePackets(FILE* file, AVCodecParserContext* parser, AVCodecContext* decCtx, int& error);
+
+// Decode packets, then drain decCtx, yield the frames.
+Generator<AVFrame*> decodeFrames(AVCodecContext* decCtx, Generator<AVPacket*> packets, int& error);
+
+// Interleave float frames into blocks of blockSize bytes, whole samples,
+// the last one shorter. The span is valid until the next block is pulled.
+Generator<std::span<const uint8_t>> fillBlocks(Generator<AVFrame*> frames, int blockSize, int& error);
+
+// The three stages on an MPEG audio file, skipping its ID3v2 tag.
+Generator<std::span<const uint8_t>> decodeBlocks(const char* filename, int blockSize, int& error);
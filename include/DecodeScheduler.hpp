@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Mixer.hpp"
+
+#include <inttypes.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class SchedulePolicy
+{
+    EarliestDeadline, // the stream closest to running dry first
+    RoundRobin,       // the stream decoded least recently first, for comparison
+};
+
+struct DecodeSchedulerStats
+{
+    int64_t quanta;          // decode tasks run
+    int64_t missedDeadlines; // underruns, quanta done after their audio was due
+    double  maxLatenessMs;
+    int     playingNum;
+    int     finishedNum;
+};
+
+// Decodes many streams on a fixed set of workers, a quantum of audio at a time.
+// Every stream plays from startDelay after it is added, so it runs dry at
+// playStart + decoded duration: its deadline. A stream is runnable while it has
+// less than bufferSeconds decoded ahead, and workers take the runnable stream
+// by policy. A missed deadline delays the stream's playback by the lateness,
+// as the underrun of a real output would.
+class DecodeScheduler
+{
+public:
+    // interleaved float, count samples per channel, called on a worker
+    using Sink = std::function<void(const float* samples, int count)>;
+
+    DecodeScheduler(size_t         workersNum,
+                    SchedulePolicy policy            = SchedulePolicy::EarliestDeadline,
+                    double         bufferSeconds     = 0.5,
+                    double         quantumSeconds    = 0.05,
+                    double         startDelaySeconds = 0.1);
+    ~DecodeScheduler();
+
+    DecodeScheduler(const DecodeScheduler&)            = delete;
+    DecodeScheduler& operator=(const DecodeScheduler&) = delete;
+
+    // Open filename with a StreamDecoder and start playing it.
+    // Return the stream index or a negative AVERROR.
+    int addStream(const char* filename, Sink sink = nullptr);
+    int addSource(std::unique_ptr<MixerSource> source, Sink sink = nullptr);
+
+    // Stop the workers after their current quantum.
+    void stop();
+
+    DecodeSchedulerStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stream
+    {
+        std::unique_ptr<MixerSource> source;
+        Sink                         sink;
+        std::vector<float>           scratch;
+        int                          quantumSamples;
+        Clock::time_point            playStart;
+        int64_t                      decodedSamples = 0;
+        int64_t                      lastRun        = 0;
+        bool                         isBusy         = false;
+        bool                         isFinished     = false;
+
+        Clock::time_point deadline() const;
+    };
+
+    void    workerLoop();
+    Stream* pickStream(Clock::time_point now, Clock::time_point& wake);
+    void    runQuantum(Stream& stream, std::unique_lock<std::mutex>& lock);
+
+    SchedulePolicy  _policy;
+    Clock::duration _buffer;
+    double          _quantumSeconds;
+    Clock::duration _startDelay;
+
+    mutable std::mutex                   _mutex;
+    std::condition_variable              _cond;
+    std::vector<std::unique_ptr<Stream>> _streams;
+    std::vector<std::thread>             _workers;
+    int64_t                              _runCount = 0;
+    bool                                 _stop     = false;
+    DecodeSchedulerStats                 _stats    = {};
+};
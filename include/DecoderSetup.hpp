@@ -0,0 +1,17 @@
+#pragma once
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+// Open decoder like avcodec_open2(), single threaded unless useSharedPool.
+//
+// With useSharedPool, slice threaded codecs run their slice jobs on
+// ThreadPool::shared(), so many concurrent decoders don't oversubscribe the
+// cores. libavcodec still creates thread_count - 1 slice threads per context
+// in avcodec_open2() before the jobs are redirected; they stay idle for the
+// life of the context but cost their stacks, so opt in only for codecs that
+// slice thread and when contexts are few and long lived.
+int openDecoder(AVCodecContext* decCtx, const AVCodec* decoder, AVDictionary** options = nullptr,
+                bool useSharedPool = false);
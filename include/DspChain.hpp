@@ -0,0 +1,179 @@
+#pragma once
+
+#include <atomic>
+#include <inttypes.h>
+#include <vector>
+
+// Processing of interleaved float blocks in place, between decode and
+// SubmitSourceBuffer. prepare() sizes every buffer for the largest block,
+// so process() doesn't allocate.
+class DspEffect
+{
+public:
+    virtual ~DspEffect() = default;
+
+    virtual const char* name() const = 0;
+
+    // Called before the first block and on a format change.
+    virtual void prepare(int sampleRate, int channelsNum, int maxBlockSamples) = 0;
+
+    // count samples per channel, at most maxBlockSamples
+    virtual void process(float* samples, int count) = 0;
+
+    // Forget the history, as after a seek.
+    virtual void reset() {}
+
+    // samples per channel the output lags the input
+    virtual int latencySamples() const { return 0; }
+};
+
+struct DspEffectCost
+{
+    const char* name;
+    double      nsPerSample; // per sample of every channel
+    int64_t     samples;
+};
+
+// Effects run in the order added, each over the whole block, timed per block.
+class DspChain
+{
+public:
+    // Add effect, not owned, before prepare().
+    void add(DspEffect* effect);
+
+    void prepare(int sampleRate, int channelsNum, int maxBlockSamples);
+    void process(float* samples, int count);
+    void reset();
+
+    int latencySamples() const;
+
+    std::vector<DspEffectCost> costs() const;
+    void                       resetCosts();
+
+private:
+    struct Slot
+    {
+        DspEffect* effect;
+        int64_t    ns;
+        int64_t    samples;
+    };
+
+    std::vector<Slot> _slots;
+};
+
+// Gain ramping to its target with a one-pole smoother, so changes from the UI
+// thread don't click. setGainDb() may be called from any thread.
+class SmoothedGain : public DspEffect
+{
+public:
+    explicit SmoothedGain(float gainDb = 0.0f, float smoothingMs = 20.0f);
+
+    void setGainDb(float gainDb);
+
+    const char* name() const override { return "gain"; }
+
+    void prepare(int sampleRate, int channelsNum, int maxBlockSamples) override;
+    void process(float* samples, int count) override;
+    void reset() override;
+
+private:
+    std::atomic<float> _target;
+    float              _gain;
+    float              _smoothingMs;
+    float              _coef        = 0.0f; // per sample pull towards the target
+    int                _channelsNum = 0;
+};
+
+enum class BiquadType
+{
+    LowPass,
+    HighPass,
+    Peaking,
+    LowShelf,
+    HighShelf,
+};
+
+// Cascaded biquads (RBJ cookbook, transposed direct form II), the same curve
+// on every channel. Channels run in SIMD lanes, 8 or 4 at a time and the
+// stereo pair in the low half of a vector, so the per sample recursion of a
+// biquad stays intact.
+class BiquadCascade : public DspEffect
+{
+public:
+    // Add a stage before prepare(), gainDb only counts for Peaking and the shelves.
+    void addStage(BiquadType type, float frequency, float q, float gainDb = 0.0f);
+
+    int stagesNum() const { return (int)_specs.size(); }
+
+    const char* name() const override { return "biquads"; }
+
+    void prepare(int sampleRate, int channelsNum, int maxBlockSamples) override;
+    void process(float* samples, int count) override;
+    void reset() override;
+
+private:
+    struct Spec
+    {
+        BiquadType type;
+        float      frequency;
+        float      q;
+        float      gainDb;
+    };
+
+    // normalized by a0
+    struct Coefs
+    {
+        float b0, b1, b2, a1, a2;
+    };
+
+    std::vector<Spec>  _specs;
+    std::vector<Coefs> _coefs;
+    std::vector<float> _z1; // stage * channelsNum + channel
+    std::vector<float> _z2;
+    int                _channelsNum = 0;
+};
+
+// Peak limiter which sees lookaheadMs ahead: the gain every sample needs is
+// held for the lookahead, released with releaseMs and then averaged over the
+// lookahead, which starts the attack early enough that the delayed output
+// never exceeds thresholdDb.
+class Limiter : public DspEffect
+{
+public:
+    explicit Limiter(float thresholdDb = -1.0f, float lookaheadMs = 5.0f, float releaseMs = 50.0f);
+
+    const char* name() const override { return "limiter"; }
+
+    void prepare(int sampleRate, int channelsNum, int maxBlockSamples) override;
+    void process(float* samples, int count) override;
+    void reset() override;
+
+    int latencySamples() const override { return _window - 1; }
+
+    // lowest gain applied since the last reset, 1 when nothing was limited
+    float minGain() const { return _minGain; }
+
+private:
+    void computePeaks(const float* samples, int count);
+
+    float _threshold;
+    float _lookaheadMs;
+    float _releaseMs;
+    float _releaseCoef = 0.0f;
+    int   _channelsNum = 0;
+    int   _window      = 1; // lookahead in samples, the last one is the current sample
+
+    std::vector<float>   _peaks;        // per sample of the block, largest of the channels
+    std::vector<float>   _delay;        // last _window samples, interleaved
+    std::vector<float>   _boxRing;      // last _window envelope values
+    std::vector<float>   _minValues;    // ring of increasing required gains, the window minimum first
+    std::vector<int64_t> _minPositions;
+
+    int64_t _position = 0; // samples seen since reset
+    int     _minHead  = 0;
+    int     _minCount = 0;
+    int     _ringPos  = 0;
+    double  _boxSum   = 0;
+    float   _envelope = 1.0f;
+    float   _minGain  = 1.0f;
+};
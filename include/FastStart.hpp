@@ -0,0 +1,68 @@
+#pragma once
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include <future>
+#include <map>
+#include <string>
+
+struct FastStartOptions
+{
+    int64_t probeSize       = 4096;   // bytes probed when the extension is not cached yet
+    int64_t analyzeDuration = 100000; // microseconds the demuxer may read ahead
+    bool    lazyMetadata    = true;   // false: avformat_find_stream_info before the first frame
+};
+
+// What only a full probe of the file knows.
+struct StreamMetadata
+{
+    int64_t                            durationMs = -1;
+    int64_t                            bitRate    = 0;
+    int64_t                            startTime  = AV_NOPTS_VALUE;
+    std::map<std::string, std::string> tags;
+};
+
+// Open an audio file for playback doing as little as possible before the first frame.
+// The input format is taken from a per extension cache, and only probeSize bytes are
+// probed on a miss. avformat_find_stream_info is skipped, so the output format
+// comes from the first decoded frame. Duration, bit rate and tags are probed
+// meanwhile on ThreadPool::shared(), with a context of their own.
+class FastStartInput
+{
+public:
+    FastStartInput() = default;
+    ~FastStartInput();
+
+    FastStartInput(const FastStartInput&)            = delete;
+    FastStartInput& operator=(const FastStartInput&) = delete;
+
+    // Return 0 on success or a negative AVERROR.
+    int open(const char* filename, const FastStartOptions& options = {});
+    void close();
+
+    // Decode the next frame of the audio stream, AVERROR_EOF after the last one.
+    int receiveFrame(AVFrame* frame);
+
+    AVFormatContext* formatContext() const { return _fmtCtx; }
+    AVCodecContext*  codecContext()  const { return _decCtx; }
+
+    bool metadataReady() const;
+
+    // Wait for the background probe if it's still running.
+    const StreamMetadata& metadata() const;
+
+private:
+    AVFormatContext* _fmtCtx      = nullptr;
+    AVCodecContext*  _decCtx      = nullptr;
+    AVPacket*        _pkt         = nullptr;
+    int              _streamIndex = -1;
+
+    std::shared_future<StreamMetadata> _metadata;
+};
+
+// Forget the input formats remembered per extension, so the next open() probes again.
+void clearInputFormatCache();
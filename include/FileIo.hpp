@@ -0,0 +1,38 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+// fseek/ftell with 64 bit offsets, long is 32 bits on Windows.
+
+inline int seekFile(FILE* file, int64_t offset, int origin)
+{
+#ifdef _WIN32
+    return _fseeki64(file, offset, origin);
+#else
+    return fseeko(file, (off_t)offset, origin);
+#endif
+}
+
+inline int64_t tellFile(FILE* file)
+{
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return ftello(file);
+#endif
+}
+
+// Return the offset of the audio data behind an ID3v2 tag, 0 if there is none.
+// Moves the position of file, callers seek to where they continue.
+inline int64_t getID3TagEnd(FILE* file)
+{
+    uint8_t header[10];
+    seekFile(file, 0, SEEK_SET);
+    if (fread(header, 1, 10, file) == 10 && memcmp(header, "ID3", 3) == 0)
+    {
+        return 10 + ((header[6] << 21) | (header[7] << 14) | (header[8] << 7) | header[9]);
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+extern "C"
+{
+#include <libswresample/swresample.h>
+}
+
+#include "FrameTap.hpp"
+#include "Spectral.hpp"
+
+#include <inttypes.h>
+
+#include <vector>
+
+struct FingerprintOptions
+{
+    int   sampleRate   = 5512;    // the mono mix is resampled to this first
+    int   fftSize      = 2048;    // 0.37 s
+    int   hopSize      = 256;     // samples between frames, 21.5 frames per second
+    float minFrequency = 300.0f;  // 33 log spaced bands between these give 32 bits
+    float maxFrequency = 2000.0f;
+};
+
+struct Fingerprint
+{
+    int                   sampleRate = 0; // of the analyzed audio
+    int                   hopSize    = 0;
+    std::vector<uint32_t> frames;         // one per hopSize samples
+};
+
+// Perceptual fingerprint after Haitsma and Kalker, "A Highly Robust Audio
+// Fingerprinting System" (2002), computed while decoding. Bit m of a frame
+// is set when the energy difference of bands m and m + 1 grew since the
+// previous frame, which survives re-encoding, resampling and gain changes
+// where a hash of the samples does not. The decoded audio is downmixed and
+// resampled by swresample, then every hopSize samples a Hann windowed real
+// FFT (av_tx) gives the band energies.
+class FingerprintExtractor : public FrameTap
+{
+public:
+    explicit FingerprintExtractor(const FingerprintOptions& options = {});
+    ~FingerprintExtractor();
+
+    FingerprintExtractor(const FingerprintExtractor&)            = delete;
+    FingerprintExtractor& operator=(const FingerprintExtractor&) = delete;
+
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+
+    // 0 or the AVERROR of setting up or running the resampler or transform
+    int error() const { return _error; }
+
+    const Fingerprint& fingerprint() const { return _fingerprint; }
+
+private:
+    static constexpr int BandsNum = 33;
+
+    void release();
+    void resample(const uint8_t* const* input, int samples);
+    void analyzeWindow();
+
+    FingerprintOptions _options;
+    int                _error = 0;
+
+    SwrContext*        _swr = nullptr;
+    RealFft            _fft;
+    std::vector<float> _window;
+    std::vector<int>   _bandBins;         // BandsNum + 1 bin edges
+
+    std::vector<float> _resampled;
+    std::vector<float> _history;          // last fftSize resampled samples
+    int                _fill = 0;         // samples in _history
+    std::vector<float> _previous;         // band energy differences of the last window
+    bool               _hasPrevious = false;
+
+    Fingerprint _fingerprint;
+};
+
+// Compact sidecar of a fingerprint, 4 bytes per frame after a small header.
+bool saveFingerprint(const char* filename, const Fingerprint& fingerprint);
+bool loadFingerprint(const char* filename, Fingerprint& fingerprint);
+
+// Number of differing bits of a[0, n) and b[0, n).
+int64_t hammingDistance(const uint32_t* a, const uint32_t* b, int n);
+
+struct FingerprintMatch
+{
+    size_t index;        // as returned by FingerprintCatalog::add()
+    float  bitErrorRate; // 0 for identical frames, around 0.5 for unrelated audio
+    int    offset;       // query frame i lines up with catalog frame i + offset
+};
+
+// Fingerprints of a library in one contiguous block, searched by brute force
+// Hamming distance over every track and every offset up to maxOffsetFrames,
+// which covers encoder delay and trimmed silence. The distance is summed in
+// blocks, and an alignment is given up as soon as its errors pass the bound,
+// so unrelated tracks cost about one block per offset. All fingerprints must
+// come from the same FingerprintOptions.
+class FingerprintCatalog
+{
+public:
+    explicit FingerprintCatalog(int maxOffsetFrames = 32) : _maxOffsetFrames(maxOffsetFrames) {}
+
+    size_t add(const Fingerprint& fingerprint);
+    size_t size() const { return _entries.size(); }
+
+    // Tracks matching query with a bit error rate of at most maxBitErrorRate,
+    // over at least half of the shorter one, best first.
+    std::vector<FingerprintMatch> match(const Fingerprint& query, float maxBitErrorRate = 0.35f) const;
+
+private:
+    struct Entry
+    {
+        size_t start; // in _frames
+        int    count;
+    };
+
+    int                   _maxOffsetFrames;
+    std::vector<uint32_t> _frames;
+    std::vector<Entry>    _entries;
+};
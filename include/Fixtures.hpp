@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Deterministic inputs written by the genFixtures target, so benchmarks
+// and stress tests run on identical data on every machine.
+
+// relative to the working directory
+constexpr auto FixtureDir = "fixtures";
+
+struct FixtureSpec
+{
+    const char* name;
+    int         seconds;
+    int         sampleRate;
+    int         channelsNum;
+    bool        isVbr;
+    bool        hasId3;
+    bool        hasXing;
+};
+
+constexpr FixtureSpec FixtureSpecs[] =
+{
+    { "stereo_44k_cbr",        60, 44100, 2, false, true,  true  },
+    { "stereo_48k_vbr",        60, 48000, 2, true,  true,  true  },
+    { "mono_22k_cbr",          60, 22050, 1, false, true,  true  },
+    { "stereo_44k_cbr_bare",   60, 44100, 2, false, false, false },
+    { "stereo_44k_vbr_noxing", 60, 44100, 2, true,  true,  false },
+    { "stereo_44k_cbr_short",   5, 44100, 2, false, true,  true  },
+    { "stereo_44k_cbr_long",  600, 44100, 2, false, true,  true  },
+};
+
+// Damaged copies of stereo_44k_cbr.
+constexpr auto FixtureTruncated = "stereo_44k_cbr_truncated"; // cut at 60%
+constexpr auto FixtureCorrupted = "stereo_44k_cbr_corrupted"; // bytes flipped in the middle
+
+// The file every single stream benchmark decodes.
+constexpr auto FixtureDefault = "stereo_44k_cbr";
+
+inline std::string fixturePath(std::string_view name)
+{
+    return std::string(FixtureDir) + "/" + std::string(name) + ".mp3";
+}
+
+// Every fixture, damaged copies included, as a small library for batch tests.
+inline std::vector<std::string> fixtureLibrary()
+{
+    std::vector<std::string> files;
+    for (auto& spec : FixtureSpecs)
+    {
+        files.push_back(fixturePath(spec.name));
+    }
+    files.push_back(fixturePath(FixtureTruncated));
+    files.push_back(fixturePath(FixtureCorrupted));
+    return files;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+struct AVChannelLayout;
+
+// Stage which sees every decoded frame of a track, in decode order.
+// Samples are planar float, channels[ch][i] for i < samples.
+class FrameTap
+{
+public:
+    virtual ~FrameTap() = default;
+
+    // Called before begin() by sources which know the channel order, taps
+    // that need it assume ffmpeg's default layout for channelsNum otherwise.
+    virtual void setChannelLayout(const AVChannelLayout& /*layout*/) {}
+
+    virtual void begin(int /*sampleRate*/, int /*channelsNum*/) {}
+    virtual void process(const float* const* channels, int samples) = 0;
+    virtual void end() {}
+
+    // Called instead of end() when the track wasn't decoded whole: the decode
+    // failed, damaged data was skipped or the audio ended before its stated
+    // duration. Taps finish with what they got unless they need all of it.
+    virtual void abort() { end(); }
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+// std::generator where the standard library has it, otherwise a minimal
+// stand-in with the same use: a lazy input range of T, resumed on every
+// increment. The stand-in doesn't support elements_of or allocators.
+
+#if __has_include(<generator>)
+#include <generator>
+#endif
+
+#ifdef __cpp_lib_generator
+
+template <typename T>
+using Generator = std::generator<T>;
+
+#else
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+template <typename T>
+class Generator
+{
+public:
+    struct promise_type
+    {
+        const T* value = nullptr;
+
+        Generator get_return_object() { return Generator(Handle::from_promise(*this)); }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        // value lives until the generator is resumed
+        std::suspend_always yield_value(const T& yielded) noexcept
+        {
+            value = std::addressof(yielded);
+            return {};
+        }
+
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+
+        template <typename U>
+        void await_transform(U&&) = delete;
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class Iterator
+    {
+    public:
+        using value_type      = T;
+        using difference_type = std::ptrdiff_t;
+
+        explicit Iterator(Handle handle = nullptr) : _handle(handle) {}
+
+        const T& operator*() const { return *_handle.promise().value; }
+
+        Iterator& operator++()
+        {
+            _handle.resume();
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const { return !_handle || _handle.done(); }
+
+    private:
+        Handle _handle;
+    };
+
+    Generator(Generator&& other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+
+    Generator& operator=(Generator&& other) noexcept
+    {
+        std::swap(_handle, other._handle);
+        return *this;
+    }
+
+    ~Generator()
+    {
+        if (_handle)
+        {
+            _handle.destroy();
+        }
+    }
+
+    // once, runs up to the first element
+    Iterator begin()
+    {
+        _handle.resume();
+        return Iterator(_handle);
+    }
+
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    explicit Generator(Handle handle) : _handle(handle) {}
+
+    Handle _handle;
+};
+
+#endif
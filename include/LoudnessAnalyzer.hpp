@@ -0,0 +1,76 @@
+#pragma once
+
+#include "FrameTap.hpp"
+
+#include <array>
+#include <vector>
+
+struct LoudnessResult
+{
+    double integrated; // LUFS
+    double range;      // LU, loudness range (EBU Tech 3342)
+    double truePeak;   // dBTP, 4x oversampled
+    double samplePeak; // dBFS
+    double replayGain; // dB, ReplayGain 2.0 track gain, reference -18 LUFS
+};
+
+// EBU R128 / ITU-R BS.1770-4 loudness measured on the decoded frames,
+// so no extra pass over the file is needed.
+class LoudnessAnalyzer : public FrameTap
+{
+public:
+    // Channel weights follow layout, LFE is not measured and surrounds get +1.5 dB.
+    void setChannelLayout(const AVChannelLayout& layout) override;
+
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+
+    const LoudnessResult& result() const { return _result; }
+
+private:
+    // K-weighting, high shelf followed by high pass, transposed direct form II
+    struct KFilter
+    {
+        double shelfB0, shelfB1, shelfB2, shelfA1, shelfA2;
+        double highPassA1, highPassA2;
+    };
+
+    // filter state of one channel
+    struct KState
+    {
+        double shelfZ1, shelfZ2;
+        double highPassZ1, highPassZ2;
+    };
+
+    static constexpr int SubBlocksPerMomentary  = 4;  // 400 ms
+    static constexpr int SubBlocksPerShortTerm  = 30; // 3 s
+
+    void filterSubBlock(const float* const* channels, int offset, int samples);
+    void finishSubBlock();
+    void measurePeaks(const float* const* channels, int samples);
+
+    KFilter             _filter = {};
+    std::vector<KState> _states;
+    std::vector<double> _channelWeights;
+    std::vector<double> _layoutWeights;  // from setChannelLayout(), for the next begin()
+    std::vector<double> _sumOfSquares;   // current sub-block, per channel
+
+    int _channelsNum    = 0;
+    int _subBlockSize   = 0; // 100 ms of samples
+    int _subBlockFill   = 0;
+    int _subBlocksCount = 0;
+
+    std::array<double, SubBlocksPerShortTerm> _recentSubBlocks = {}; // ring of weighted mean squares
+
+    std::vector<double> _momentaryEnergies;
+    std::vector<double> _shortTermEnergies;
+
+    // true peak interpolation, last taps - 1 samples of every channel followed by new ones
+    std::vector<std::vector<float>> _truePeakInputs;
+
+    float _samplePeak = 0;
+    float _truePeak   = 0;
+
+    LoudnessResult _result = {};
+};
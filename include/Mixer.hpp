@@ -0,0 +1,90 @@
+#pragma once
+
+#include "StreamDecoder.hpp"
+
+#include <vector>
+
+// What the mixer pulls audio from: interleaved float, mono or stereo.
+class MixerSource
+{
+public:
+    virtual ~MixerSource() = default;
+
+    virtual int sampleRate()  const = 0;
+    virtual int channelsNum() const = 0;
+
+    // Fill up to samples per channel, less only at the end of the source.
+    // Return the number filled or a negative AVERROR.
+    virtual int read(float* out, int samples) = 0;
+};
+
+// A StreamDecoder as a source, the decoder is not owned.
+class StreamDecoderSource : public MixerSource
+{
+public:
+    explicit StreamDecoderSource(StreamDecoder& decoder) : _decoder(decoder) {}
+
+    int sampleRate()  const override { return _decoder.sampleRate(); }
+    int channelsNum() const override { return _decoder.channelsNum(); }
+
+    int read(float* out, int samples) override;
+
+private:
+    StreamDecoder& _decoder;
+};
+
+// Sums sources into one interleaved stereo block at a time, with a gain and
+// pan per stream, for servers mixing many streams without XAudio2.
+// Mono sources pan at constant power, stereo sources pan as a balance.
+// Buffers are sized up front, mix() doesn't allocate.
+class Mixer
+{
+public:
+    Mixer(int sampleRate, int blockSamples);
+
+    int blockSamples() const { return _blockSamples; }
+
+    // Add source, not owned, at the mixer rate and mono or stereo.
+    // Return the stream handle or AVERROR(EINVAL).
+    int add(MixerSource* source, float gain = 1.0f, float pan = 0.0f);
+
+    // Calls with the handle of a stream that was removed, by remove() or by
+    // mix() at its end, do nothing and return false, even once its slot was
+    // reused by a later add().
+    bool remove(int stream);
+    bool setGain(int stream, float gain);
+    bool setPan(int stream, float pan); // -1 left to 1 right
+
+    // Mix the next blockSamples of every stream into out, blockSamples * 2 floats.
+    // Streams reaching their end or failing are removed after contributing what they had.
+    // Return the number of streams still playing.
+    int mix(float* out);
+
+    int streamsNum() const { return _streamsNum; }
+
+private:
+    struct Stream
+    {
+        MixerSource* source     = nullptr;
+        int          generation = 0; // bumped by every add() to the slot
+        float        gain       = 1.0f;
+        float        pan        = 0.0f;
+        float        gainLeft   = 1.0f;
+        float        gainRight  = 1.0f;
+    };
+
+    // a handle is the slot index in the low bits and its generation above
+    static constexpr int SlotBits       = 16;
+    static constexpr int GenerationMask = (1 << (31 - SlotBits)) - 1;
+
+    // the playing stream of handle or nullptr
+    Stream*     find(int stream);
+    void        removeSlot(Stream& stream);
+    static void updateGains(Stream& stream);
+
+    int                 _sampleRate;
+    int                 _blockSamples;
+    int                 _streamsNum = 0;
+    std::vector<Stream> _streams; // removed slots have no source and are reused
+    std::vector<float>  _scratch;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include <inttypes.h>
+#include <stdio.h>
+
+struct MpegFrameHeader
+{
+    int layer;
+    int frameSize;  // bytes, header included
+    int samplesNum; // per channel
+    int sampleRate;
+    int channelsNum;
+};
+
+// Parse the 4 bytes at p, false if they aren't a valid MPEG audio frame header.
+// Free format frames are not supported.
+bool parseMpegFrameHeader(const uint8_t* p, MpegFrameHeader& header);
+
+// Byte offset and first sample of every frame of a raw MPEG audio stream,
+// counted as the decoder outputs them, without encoder delay or padding removed.
+class MpegFrameIndex
+{
+public:
+    struct Frame
+    {
+        int64_t offset;
+        int64_t firstSample;
+        int     size;
+    };
+
+    // Scan the frame headers of file from dataStart to the end. A header only counts
+    // when the next one follows right behind its frame, junk in between is skipped.
+    // Return false if no frame was found.
+    bool build(FILE* file, int64_t dataStart);
+
+    size_t       size()                   const { return _frames.size(); }
+    const Frame& operator[](size_t index) const { return _frames[index]; }
+
+    int64_t samplesNum()  const { return _samplesNum; }
+    int     sampleRate()  const { return _header.sampleRate; }
+    int     channelsNum() const { return _header.channelsNum; }
+
+    // Index of the frame holding sample, size() past the end.
+    size_t frameOf(int64_t sample) const;
+
+    // First frame to feed a flushed decoder so the output of frame is exact.
+    size_t preRollStart(size_t frame) const;
+
+private:
+    std::vector<Frame> _frames;
+    MpegFrameHeader    _header     = {}; // of the first frame
+    int64_t            _samplesNum = 0;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "FrameTap.hpp"
+#include "PcmFileWriter.hpp"
+
+#include <inttypes.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+struct PcmCacheCounters
+{
+    int64_t hits;
+    int64_t misses;
+    int64_t stores;
+    int64_t evictions;
+};
+
+// Read only view of a cached track, memory mapped.
+class CachedPcm
+{
+public:
+    CachedPcm() = default;
+    ~CachedPcm();
+
+    CachedPcm(const CachedPcm&)            = delete;
+    CachedPcm& operator=(const CachedPcm&) = delete;
+
+    bool open(const char* filename);
+    void close();
+
+    int             sampleRate()  const { return _sampleRate; }
+    int             channelsNum() const { return _channelsNum; }
+    int64_t         samplesNum()  const { return _samplesNum; }
+    PcmSampleFormat format()      const { return _format; }
+
+    // Convert samples [start, start + count), clamped to the track, to interleaved float.
+    // Return the number of samples per channel converted.
+    int64_t readFloat(int64_t start, int64_t count, float* out) const;
+
+private:
+    uint8_t*        _fileBuffer  = nullptr;
+    size_t          _fileSize    = 0;
+    const uint8_t*  _data        = nullptr;
+    int             _sampleRate  = 0;
+    int             _channelsNum = 0;
+    int64_t         _samplesNum  = 0;
+    PcmSampleFormat _format      = PcmSampleFormat::Int16;
+};
+
+// Decoded audio of recently played tracks, stored as wav files in dir and keyed
+// by file identity (path, size and modification time), so a replay maps it
+// instead of decoding again. Int16 halves the size at 16 bit precision.
+// The least recently used entries are removed to keep dir under maxBytes.
+class PcmDiskCache
+{
+public:
+    PcmDiskCache(std::string dir, uint64_t maxBytes, PcmSampleFormat format = PcmSampleFormat::Int16);
+
+    // Map the cached audio of filename, false on a miss.
+    bool open(const char* filename, CachedPcm& pcm);
+
+    // A tap storing what is decoded of filename, nullptr if filename doesn't exist.
+    // The entry appears only when end() is reached, a decode that failed, skipped
+    // damaged data or came out short ends in abort() and leaves nothing.
+    std::unique_ptr<FrameTap> writer(const char* filename);
+
+    PcmCacheCounters counters() const;
+
+private:
+    friend class PcmCacheWriter;
+
+    // empty if filename doesn't exist
+    std::string entryPath(const char* filename) const;
+    std::string tempPath(const std::string& entry);
+
+    void commit(const std::string& tempPath, const std::string& entry);
+    void evict();
+
+    std::string     _dir;
+    uint64_t        _maxBytes;
+    PcmSampleFormat _format;
+    std::mutex      _evictMutex;
+
+    std::atomic<int64_t> _hits      = 0;
+    std::atomic<int64_t> _misses    = 0;
+    std::atomic<int64_t> _stores    = 0;
+    std::atomic<int64_t> _evictions = 0;
+    std::atomic<int64_t> _tempCount = 0;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "FrameTap.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <string>
+
+enum class PcmContainer
+{
+    Wav, // RF64 once the data passes 4 GB
+    Raw,
+};
+
+enum class PcmSampleFormat
+{
+    Float32,
+    Int16,
+};
+
+// Export decoded audio while decoding.
+// Samples are interleaved straight into a large aligned block that is
+// written with a single call, and the header is patched once the size is known.
+class PcmFileWriter : public FrameTap
+{
+public:
+    explicit PcmFileWriter(std::string     filename,
+                           PcmContainer    container = PcmContainer::Wav,
+                           PcmSampleFormat format    = PcmSampleFormat::Float32,
+                           bool            directIo  = false); // O_DIRECT on Linux
+    ~PcmFileWriter();
+
+    PcmFileWriter(const PcmFileWriter&)            = delete;
+    PcmFileWriter& operator=(const PcmFileWriter&) = delete;
+
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+
+    bool    ok()       const { return _ok; }
+    int64_t fileSize() const { return _fileSize; }
+
+private:
+    bool openFile();
+    bool writeBlock(const uint8_t* data, size_t size);
+    bool writeHeader();
+    void closeFile();
+
+    std::string     _filename;
+    PcmContainer    _container;
+    PcmSampleFormat _format;
+    bool            _directIo;
+
+    int _sampleRate  = 0;
+    int _channelsNum = 0;
+    int _frameBytes  = 0;
+
+    uint8_t* _buffer     = nullptr;
+    size_t   _bufferFill = 0;
+    size_t   _headerSize = 0;
+    int64_t  _fileSize   = 0; // bytes written so far
+    bool     _ok         = false;
+
+#ifdef __linux__
+    int   _fd   = -1;
+#else
+    FILE* _file = nullptr;
+#endif
+};
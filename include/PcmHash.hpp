@@ -0,0 +1,43 @@
+#pragma once
+
+#include "FrameTap.hpp"
+#include "Xxh64.hpp"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <vector>
+
+// Content hash of a track's decoded audio, independent of tags and container.
+struct PcmHash
+{
+    uint64_t              track;         // whole track
+    int                   windowSeconds;
+    std::vector<uint64_t> windows;       // one per windowSeconds of audio, the last may be shorter,
+                                         // none when windowSeconds is 0
+};
+
+// Hash decoded PCM quantized to interleaved 16 bit while decoding, so
+// copies whose float output differs only by decoder rounding hash equal too.
+// A windowSeconds of 0 or less hashes the whole track only.
+class PcmHasher : public FrameTap
+{
+public:
+    explicit PcmHasher(int windowSeconds = 10) : _windowSeconds(std::max(0, windowSeconds)) {}
+
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+
+    const PcmHash& hash() const { return _hash; }
+
+private:
+    int                  _windowSeconds;
+    int                  _channelsNum   = 0;
+    int64_t              _windowSamples = 0;
+    int64_t              _windowFill    = 0;
+    Xxh64                _trackState;
+    Xxh64                _windowState;
+    std::vector<int16_t> _quantized;
+    PcmHash              _hash = {};
+};
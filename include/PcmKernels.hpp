@@ -0,0 +1,34 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <cmath>
+
+// Planar float to interleaved conversions shared by the stages,
+// samples [offset, offset + samples) of every channel.
+
+void interleaveFloat(const float* const* channels, int channelsNum, int offset, int samples, float* out);
+
+// Clamped to [-1, 1] and rounded to nearest even.
+void interleaveS16(const float* const* channels, int channelsNum, int offset, int samples, int16_t* out);
+
+// Add samples of interleaved mono or stereo in, scaled by gainLeft and gainRight,
+// to interleaved stereo out.
+void mixStereo(const float* in, int inChannelsNum, int samples, float gainLeft, float gainRight, float* out);
+
+// interleaveFloat() with a channel matrix applied on the way, out channel o
+// being the sum of matrix[o * channelsNum + c] * channels[c]. Zero coefficients
+// are skipped.
+void interleaveMatrix(const float* const* channels, int channelsNum, int offset, int samples,
+                      const float* matrix, int outChannelsNum, float* out);
+
+// Index of the first / last of n samples whose magnitude exceeds threshold,
+// n / -1 when there is none.
+int findFirstAbove(const float* samples, int n, float threshold);
+int findLastAbove(const float* samples, int n, float threshold);
+
+// Linear amplitude of a level in dB, for thresholds and gains.
+inline float dbToGain(float db)
+{
+    return std::pow(10.0f, db / 20.0f);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "StreamDecoder.hpp"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Least recently used decoded blocks, bounded by their total size.
+// One cache can be shared by the readers of many tracks.
+class PcmBlockCache
+{
+public:
+    using Block = std::shared_ptr<const std::vector<float>>;
+
+    explicit PcmBlockCache(size_t maxBytes = 64 << 20) : _maxBytes(maxBytes) {}
+
+    // nullptr when not cached
+    Block find(const void* owner, int64_t index);
+    void  insert(const void* owner, int64_t index, Block block);
+
+    // drop every block of owner
+    void erase(const void* owner);
+
+    size_t bytes() const;
+
+private:
+    struct Key
+    {
+        const void* owner;
+        int64_t     index;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return std::hash<const void*>()(key.owner) ^ std::hash<int64_t>()(key.index) * 0x9e3779b97f4a7c15ull;
+        }
+    };
+
+    struct Entry
+    {
+        Key   key;
+        Block block;
+    };
+
+    static size_t sizeOf(const Block& block) { return block->size() * sizeof(float); }
+
+    mutable std::mutex                                           _mutex;
+    size_t                                                       _maxBytes;
+    size_t                                                       _bytes = 0;
+    std::list<Entry>                                             _entries; // most recent first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> _lookup;
+};
+
+struct PcmReaderStats
+{
+    int64_t reads          = 0;
+    int64_t blockHits      = 0;
+    int64_t blockMisses    = 0;
+    int64_t decodedSamples = 0; // per channel, pre-roll included
+    int64_t preRollSamples = 0;
+    double  hitReadMs      = 0; // total of the reads served from memory only
+    double  missReadMs     = 0; // total of the reads that decoded
+    int64_t hitReads       = 0;
+    double  maxReadMs      = 0;
+
+    double hitRate() const
+    {
+        auto lookups = blockHits + blockMisses;
+        return lookups ? (double)blockHits / lookups : 0;
+    }
+};
+
+// Random access to the samples of a compressed file. The stream is split into
+// blocks of BlockFrames frames, a read decodes only the blocks its range
+// touches, plus the pre-roll of a seek, and keeps them in a PcmBlockCache,
+// so repeated and overlapping reads are served from memory.
+class PcmReader
+{
+public:
+    static constexpr size_t BlockFrames = 16;
+
+    // without cache the reader keeps its own of the default size
+    explicit PcmReader(PcmBlockCache* cache = nullptr);
+    ~PcmReader();
+
+    PcmReader(const PcmReader&)            = delete;
+    PcmReader& operator=(const PcmReader&) = delete;
+
+    // Return 0 on success or a negative AVERROR.
+    int  open(const char* filename);
+    void close();
+
+    // Copy samples [start, end), clamped to the stream, interleaved to out.
+    // Samples a damaged block doesn't decode to are zero.
+    // Return the number of samples per channel copied or a negative AVERROR.
+    int64_t read(int64_t start, int64_t end, float* out);
+
+    int64_t samplesNum()  const { return _decoder.index().samplesNum(); }
+    int     sampleRate()  const { return _decoder.sampleRate(); }
+    int     channelsNum() const { return _decoder.channelsNum(); }
+
+    const PcmReaderStats& stats() const { return _stats; }
+    void resetStats() { _stats = {}; }
+
+private:
+    int64_t blockStart(int64_t block) const;
+    int     loadBlock(int64_t block, PcmBlockCache::Block& out);
+
+    std::unique_ptr<PcmBlockCache> _ownCache;
+    PcmBlockCache*                 _cache;
+    StreamDecoder                  _decoder;
+    PcmReaderStats                 _stats;
+};
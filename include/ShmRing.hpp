@@ -0,0 +1,113 @@
+#pragma once
+
+// Decoded audio handed to other processes through shared memory, Linux only.
+#ifdef __linux__
+
+#include "FrameTap.hpp"
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <string>
+
+enum class ShmRecordKind : uint32_t
+{
+    Begin,
+    Samples,
+    End,
+};
+
+// What a reader gets from the ring, data points into the shared memory
+// and stays valid until ShmRingReader::release().
+struct ShmRingBlock
+{
+    ShmRecordKind kind;
+    int           sampleRate;
+    int           channelsNum;
+    int           samples;     // per channel
+    int64_t       timestampNs; // steady clock of the writer when published
+    const float*  data;        // interleaved, samples * channelsNum
+};
+
+struct ShmRingHeader;
+
+// Single producer side of a ring of records in shared memory: begin, end and
+// interleaved float blocks, written in place. The ring is named for shm_open,
+// or anonymous on a memfd which children inherit.
+// The reader is woken through a futex in the ring, only when it sleeps.
+class ShmRingWriter : public FrameTap
+{
+public:
+    ShmRingWriter() = default;
+    ~ShmRingWriter();
+
+    ShmRingWriter(const ShmRingWriter&)            = delete;
+    ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+    // Create a ring of at least capacity bytes, named or anonymous when name is null.
+    // When the reader is behind, a block waits up to maxWaitMs for room,
+    // forever when negative, then is dropped.
+    // Return 0 on success or a negative AVERROR.
+    int  create(const char* name, size_t capacity, int maxWaitMs = -1);
+    void close();
+
+    // of the memfd or the shm object
+    int fd() const { return _fd; }
+
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+
+    // Blocks dropped, also every block while there is no ring after a failed
+    // or missing create().
+    int64_t dropped() const { return _dropped; }
+
+private:
+    uint8_t* reserve(size_t size);
+    void     publish(size_t size);
+
+    ShmRingHeader* _header      = nullptr;
+    uint8_t*       _data        = nullptr; // mapped twice in a row
+    size_t         _capacity    = 0;
+    int            _fd          = -1;
+    std::string    _name;
+    int            _maxWaitMs   = -1;
+    int            _sampleRate  = 0;
+    int            _channelsNum = 0;
+    int64_t        _dropped     = 0;
+};
+
+// Single consumer side, for the processes receiving the audio.
+class ShmRingReader
+{
+public:
+    ShmRingReader() = default;
+    ~ShmRingReader();
+
+    ShmRingReader(const ShmRingReader&)            = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+    // Attach to a named ring, or to the fd of one, which is duplicated.
+    // Return 0 on success or a negative AVERROR.
+    int  open(const char* name);
+    int  openFd(int fd);
+    void close();
+
+    // Wait up to timeoutMs, forever when negative, for the next record.
+    // Return 1 with block filled, 0 on timeout, AVERROR_EOF once the writer
+    // closed and everything was read.
+    int next(ShmRingBlock& block, int timeoutMs = -1);
+
+    // Give the space of the block from next() back to the writer.
+    void release();
+
+private:
+    ShmRingHeader* _header   = nullptr;
+    uint8_t*       _data     = nullptr;
+    size_t         _capacity = 0;
+    int            _fd       = -1;
+    size_t         _pending  = 0; // bytes of the block held
+};
+
+#endif
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "FrameTap.hpp"
+
+#include <inttypes.h>
+
+#include <vector>
+
+struct SilenceOptions
+{
+    float thresholdDb  = -60.0f; // samples of every channel at or below are silent
+    int   minSilenceMs = 500;    // quieter stretches that are shorter belong to the music
+};
+
+// samples per channel, [start, end)
+struct SilentRegion
+{
+    int64_t start;
+    int64_t end;
+};
+
+struct SilenceResult
+{
+    std::vector<SilentRegion> regions;    // at least minSilenceMs long, intro and outro included
+    int64_t                   audioStart; // first sample above the threshold
+    int64_t                   audioEnd;   // after the last one, audioStart == audioEnd for a silent track
+    int64_t                   samplesNum;
+};
+
+// Where the audible part of a frame begins and ends. Two threshold scans per
+// channel, which stop at the first loud sample from either side, so frames of
+// music cost next to nothing. Quiet gaps inside a frame are not looked at,
+// minSilenceMs is far longer than a frame.
+struct LoudRange
+{
+    int first; // samples when the frame is silent
+    int last;  // -1 when the frame is silent
+};
+
+LoudRange findLoudRange(const float* const* channels, int channelsNum, int samples, float threshold);
+
+// Reports the silent regions of a track while it is decoded, for batch
+// analysis through decodeBatch() or next to other taps of a decode.
+class SilenceDetector : public FrameTap
+{
+public:
+    explicit SilenceDetector(const SilenceOptions& options = {}) : _options(options) {}
+
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+
+    const SilenceResult& result() const { return _result; }
+
+private:
+    void closeRun(int64_t runEnd);
+
+    SilenceOptions _options;
+    float          _threshold   = 0;
+    int64_t        _minSilence  = 0;
+    int            _channelsNum = 0;
+    int64_t        _position    = 0;
+    int64_t        _run         = 0; // silent samples before _position
+    SilenceResult  _result      = {};
+};
+
+// part of a frame, samples per channel
+struct SampleRange
+{
+    int offset;
+    int count;
+};
+
+// Cuts silence out of a stream without looking ahead: the intro goes
+// entirely, every later silent stretch is shortened to minSilenceMs, which
+// also bounds the outro. For playback, exports keep their pauses through
+// SilenceSkipTap.
+class SilenceSkipper
+{
+public:
+    explicit SilenceSkipper(const SilenceOptions& options = {}) : _options(options) {}
+
+    void begin(int sampleRate, int channelsNum);
+
+    // Store the parts of the next frame to keep in ranges, in order.
+    // Return how many, at most 2.
+    int keep(const float* const* channels, int samples, SampleRange ranges[2]);
+
+    int64_t skippedSamples() const { return _skipped; }
+
+private:
+    SilenceOptions _options;
+    float          _threshold   = 0;
+    int64_t        _minSilence  = 0;
+    int            _channelsNum = 0;
+    int64_t        _run         = 0; // silent samples at the end of what was seen
+    int64_t        _skipped     = 0;
+    bool           _isAudible   = false;
+};
+
+// Trims the intro and the outro in front of another tap, e.g. a PcmFileWriter
+// exporting the track, and passes pauses inside it on whole. Silence after
+// audio is held back until audio resumes, or dropped at end(), so it costs
+// memory for as long as the pause lasts. minSilenceMs is not used.
+class SilenceSkipTap : public FrameTap
+{
+public:
+    SilenceSkipTap(FrameTap& next, const SilenceOptions& options = {}) : _next(next), _options(options) {}
+
+    void setChannelLayout(const AVChannelLayout& layout) override { _next.setChannelLayout(layout); }
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+    void abort() override;
+
+    int64_t skippedSamples() const { return _skipped; }
+
+private:
+    void hold(const float* const* channels, int offset, int count);
+    void flush();
+    void drop();
+
+    FrameTap&                       _next;
+    SilenceOptions                  _options;
+    float                           _threshold = 0;
+    bool                            _isAudible = false;
+    int64_t                         _skipped   = 0;
+    std::vector<std::vector<float>> _held;     // silence since the last loud sample, per channel
+    std::vector<const float*>       _channels; // offset into the frame or _held
+};
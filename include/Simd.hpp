@@ -0,0 +1,14 @@
+#pragma once
+
+// Instruction sets available at compile time.
+// MSVC only reports SSE2 through _M_X64 / _M_IX86_FP.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define HAS_AVX2 1
+#include <immintrin.h>
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+extern "C"
+{
+#include <libavutil/tx.h>
+}
+
+#include <vector>
+
+// Real forward FFT of one size through av_tx, with its input and output
+// buffers, for the analyzers that window a block of samples at a time.
+class RealFft
+{
+public:
+    RealFft() = default;
+    ~RealFft();
+
+    RealFft(const RealFft&)            = delete;
+    RealFft& operator=(const RealFft&) = delete;
+
+    // Return 0 or a negative AVERROR, nothing is kept on failure.
+    int  init(int size);
+    void release();
+
+    bool isReady() const { return _tx; }
+    int  size()    const { return _size; }
+
+    // size samples to fill before transform()
+    float* input() { return _input; }
+
+    // re, im pairs of bins 0 to size / 2
+    const float* output() const { return _output; }
+
+    void transform() { _txFn(_tx, _output, _input, sizeof(float)); }
+
+private:
+    AVTXContext* _tx     = nullptr;
+    av_tx_fn     _txFn   = nullptr;
+    float*       _input  = nullptr; // av_malloc'ed
+    float*       _output = nullptr; // av_malloc'ed
+    int          _size   = 0;
+};
+
+// Periodic Hann window of size samples.
+std::vector<float> hannWindow(int size);
+
+// bandsNum + 1 bin edges of bands log spaced from minHz to maxHz, clamped to
+// what fftSize resolves at sampleRate, every band at least one bin wide.
+std::vector<int> logBandBins(int fftSize, int sampleRate, int bandsNum, double minHz, double maxHz);
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "FrameTap.hpp"
+#include "Spectral.hpp"
+#include "TripleBuffer.hpp"
+
+#include <inttypes.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct SpectrumOptions
+{
+    int   fftSize      = 2048;
+    int   hopSize      = 1024; // samples between the starts of two analyses
+    int   bandsNum     = 32;   // log spaced from minFrequency to half the sample rate
+    float minFrequency = 20.0f;
+};
+
+struct SpectrumFrame
+{
+    std::vector<float> bands;        // power in dB, a full scale sine reads 0
+    int64_t            position = 0; // sample after the analyzed window
+    int64_t            sequence = 0; // 1 for the first analysis, 0 before it
+};
+
+struct SpectrumStats
+{
+    int64_t analyses;
+    int64_t droppedSamples; // the analyzer fell behind the decoder
+    double  busySeconds;    // transform and band sums, on the analyzer thread
+};
+
+// Band energies of the decoded audio for monitoring. The decoder thread only
+// mixes each frame to mono into a ring; a thread of the analyzer runs a Hann
+// windowed real FFT (av_tx) every hopSize samples and publishes the bands
+// through a triple buffer, so neither side ever waits on the other. When the
+// ring is full, as when decoding far faster than real time, samples are
+// dropped instead of stalling the decoder.
+class SpectrumAnalyzer : public FrameTap
+{
+public:
+    explicit SpectrumAnalyzer(const SpectrumOptions& options = {});
+    ~SpectrumAnalyzer();
+
+    SpectrumAnalyzer(const SpectrumAnalyzer&)            = delete;
+    SpectrumAnalyzer& operator=(const SpectrumAnalyzer&) = delete;
+
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+
+    // 0 or the AVERROR of setting up the transform in begin()
+    int error() const { return _error; }
+
+    // Newest published spectrum, from a single reader thread, which may
+    // keep calling it across begin() and end().
+    const SpectrumFrame& latest();
+
+    // lower edge of every band in Hz, valid after begin()
+    const std::vector<float>& bandFrequencies() const { return _bandFrequencies; }
+
+    SpectrumStats stats() const;
+
+private:
+    void stop();
+    void analyzerLoop();
+    void analyze(int64_t position);
+
+    SpectrumOptions _options;
+    int             _channelsNum = 0;
+    int             _error       = 0;
+
+    // decoder to analyzer, mono
+    std::vector<float>    _ring;
+    int64_t               _ringMask       = 0;
+    std::atomic<int64_t>  _written        = 0;
+    std::atomic<int64_t>  _read           = 0;
+    std::atomic<uint32_t> _wakeups        = 0; // bumped after every write and on stop
+    std::atomic<bool>     _isStopping     = false;
+    std::atomic<int64_t>  _droppedSamples = 0;
+
+    // analyzer thread only
+    RealFft            _fft;
+    std::vector<float> _history;  // last fftSize samples
+    std::vector<float> _window;
+    std::vector<int>   _bandBins; // bandsNum + 1 bin edges
+    std::vector<float> _bandFrequencies;
+    float              _powerScale = 0;
+
+    TripleBuffer<SpectrumFrame> _spectra;
+    std::atomic<int64_t>        _analyses = 0;
+    std::atomic<int64_t>        _busyNs   = 0;
+
+    std::thread _thread;
+};
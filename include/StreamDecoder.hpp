@@ -0,0 +1,77 @@
+#pragma once
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+#include "MpegFrameIndex.hpp"
+
+#include <vector>
+
+#include <stdio.h>
+
+// testStreamPlay's streaming of a raw MPEG audio file (read, parse, decode)
+// as a class. It hands out interleaved float bytes in blocks of any size and
+// seeks to the exact sample through a frame index.
+class StreamDecoder
+{
+public:
+    StreamDecoder() = default;
+    ~StreamDecoder();
+
+    StreamDecoder(const StreamDecoder&)            = delete;
+    StreamDecoder& operator=(const StreamDecoder&) = delete;
+
+    // Open filename and index its frames.
+    // Return 0 on success or a negative AVERROR.
+    int open(const char* filename);
+    void close();
+
+    // Fill up to size bytes, less only at the end of the stream.
+    // Return the stored size or a negative AVERROR.
+    int fill(uint8_t* buffer, int size);
+
+    // Continue at samplePos: flush the decoder, restart the input early enough
+    // for the bit reservoir and the overlap of the frame holding samplePos,
+    // and drop the decoded samples before it.
+    // Return 0 on success or a negative AVERROR.
+    int seek(int64_t samplePos);
+
+    // sample of the next byte fill() hands out
+    int64_t position() const { return _position; }
+
+    const MpegFrameIndex& index() const { return _index; }
+
+    int sampleRate()     const { return _index.sampleRate(); }
+    int channelsNum()    const { return _index.channelsNum(); }
+    int blockAlign()     const { return _index.channelsNum() * (int)sizeof(float); }
+    int bytesPerSecond() const { return sampleRate() * blockAlign(); }
+
+private:
+    int pendingSize() const { return (int)(_pcm.size() - _pcmOffset); }
+
+    int  decodeMore();
+    int  sendPacket(AVPacket* pkt);
+    int  storeFrame(const AVFrame* frame);
+    void resetInput();
+
+    FILE*                 _file    = nullptr;
+    const AVCodec*        _decoder = nullptr;
+    AVCodecContext*       _decCtx  = nullptr;
+    AVCodecParserContext* _parser  = nullptr;
+    AVPacket*             _pkt     = nullptr;
+    AVFrame*              _frame   = nullptr;
+    MpegFrameIndex        _index;
+
+    std::vector<uint8_t> _input;
+    uint8_t*             _data     = nullptr;
+    size_t               _readSize = 0;
+    bool                 _eof      = false;
+    bool                 _drained  = false;
+
+    std::vector<uint8_t> _pcm; // decoded, not yet handed out
+    size_t               _pcmOffset   = 0;
+    int64_t              _skipSamples = 0; // pre-roll still to drop
+    int64_t              _position    = 0;
+};
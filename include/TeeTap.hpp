@@ -0,0 +1,100 @@
+#pragma once
+
+#include "FrameTap.hpp"
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// What a sink queue does with a block when it is full.
+enum class OverflowPolicy
+{
+    Block,      // the decoder waits, for sinks which must see everything
+    DropOldest, // the sink skips ahead, for live outputs
+    DropNewest, // the sink keeps what it has, for analyzers which tolerate gaps
+};
+
+struct TeeSinkStats
+{
+    int64_t blocks;    // processed by the sink
+    int64_t dropped;
+    int64_t maxQueued; // blocks
+};
+
+// One decoded frame, planar float, shared read only by every sink.
+struct PcmBlock
+{
+    std::vector<float>        samples;  // channel after channel
+    std::vector<const float*> channels; // into samples
+    int                       samplesNum = 0;
+};
+
+class PcmBlockPool;
+
+// Fan out of one decode to several sinks. Every frame is copied once into a
+// reference counted PcmBlock which all sinks share, each sink runs on its own
+// thread behind a queue of its own, so a slow sink only affects the decoder
+// when its policy is Block. Sinks see begin() and end() or abort() whatever
+// the policy.
+class TeeTap : public FrameTap
+{
+public:
+    TeeTap();
+    ~TeeTap();
+
+    TeeTap(const TeeTap&)            = delete;
+    TeeTap& operator=(const TeeTap&) = delete;
+
+    // Add sink, not owned, before the first begin(). Return the sink index.
+    int addSink(FrameTap* sink, size_t queueBlocks, OverflowPolicy policy);
+
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+    void abort() override;
+
+    // Wait until every sink has processed everything queued.
+    void drain();
+
+    TeeSinkStats stats(int sink) const;
+
+private:
+    struct Item
+    {
+        std::shared_ptr<const PcmBlock> block; // none for begin and end
+        int                             sampleRate  = 0;
+        int                             channelsNum = 0;
+        bool                            isEnd       = false;
+        bool                            isAborted   = false; // with isEnd
+    };
+
+    struct Sink
+    {
+        FrameTap*      tap;
+        size_t         queueBlocks;
+        OverflowPolicy policy;
+
+        mutable std::mutex      mutex;
+        std::condition_variable itemCond;  // consumer waits for items
+        std::condition_variable spaceCond; // producer and drain() wait for room
+        std::deque<Item>        queue;
+        size_t                  queuedBlocks = 0;
+        bool                    isBusy       = false;
+        bool                    stop         = false;
+        TeeSinkStats            stats        = {};
+        std::thread             thread;
+    };
+
+    void push(Sink& sink, Item item);
+    void sinkLoop(Sink& sink);
+
+    std::vector<std::unique_ptr<Sink>> _sinks;
+    std::shared_ptr<PcmBlockPool>      _pool;
+    int                                _channelsNum = 0;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "FrameTap.hpp"
+
+#include <inttypes.h>
+
+#include <vector>
+
+struct TempoOptions
+{
+    int   fftSize      = 1024;
+    int   hopSize      = 512;      // samples between two values of the onset envelope
+    int   bandsNum     = 24;       // log spaced, the flux is taken over bands rather than bins
+    float minFrequency = 40.0f;
+    float maxFrequency = 16000.0f; // or half the sample rate
+    float minBpm       = 60.0f;
+    float maxBpm       = 200.0f;
+    bool  keepEnvelope = false;    // about 1.2 MB per hour at 44.1 kHz
+};
+
+struct TempoResult
+{
+    float                bpm          = 0; // 0 when the track is too short or has no onsets
+    float                confidence   = 0; // autocorrelation at the beat period over that at 0
+    std::vector<int64_t> onsets;           // sample of every detected onset
+    std::vector<float>   envelope;         // spectral flux every hopSize samples, with keepEnvelope
+    float                envelopeRate = 0; // values per second
+};
+
+struct FluxWorkspace;
+
+// Onsets and tempo of a track measured while it is decoded, for tagging a
+// library through decodeBatch(). Every hopSize samples the mono mix goes
+// through a Hann windowed real FFT (av_tx); the onset envelope is the
+// positive change of log compressed band magnitudes (spectral flux). At the
+// end the envelope is peak picked for onsets, and its autocorrelation,
+// weighted towards 120 BPM against octave errors, gives the tempo.
+// The transform and its buffers belong to the decoding thread and are
+// shared by every track it decodes with the same options and sample rate,
+// a track only keeps its own history. begin() and end() of an analyzer must
+// run on the same thread.
+class TempoAnalyzer : public FrameTap
+{
+public:
+    explicit TempoAnalyzer(const TempoOptions& options = {});
+
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+
+    // 0 or the AVERROR of setting up the transform in begin()
+    int error() const { return _error; }
+
+    const TempoResult& result() const { return _result; }
+
+private:
+    void analyzeWindow();
+    void findOnsets(const std::vector<float>& envelope, const std::vector<double>& sums);
+    void estimateTempo(const std::vector<float>& envelope, const std::vector<double>& sums);
+
+    TempoOptions   _options;
+    FluxWorkspace* _workspace   = nullptr; // of the decoding thread, between begin() and end()
+    int            _error       = 0;
+    int            _channelsNum = 0;
+
+    std::vector<float> _history;   // last fftSize samples of the mono mix
+    int                _fill = 0;  // samples in _history
+    std::vector<float> _previous;  // compressed band magnitudes of the last window
+    std::vector<float> _envelope;
+
+    TempoResult _result;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool.
+// Every worker owns a task deque, it pops its own tasks from the back
+// and steals from the front of the other workers' deques when empty.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+    using Job  = std::function<void(int jobIndex, int slot)>;
+
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Process-wide pool, shared by every decoder context.
+    static ThreadPool& shared();
+
+    size_t size() const { return _workers.size(); }
+
+    void submit(Task task);
+
+    // Run job(0) ... job(count - 1) and wait for all of them.
+    // The calling thread takes part, so it is safe to call from a worker.
+    // At most maxSlots participants run at once, and slot is unique
+    // among them and in range [0, maxSlots).
+    void parallelFor(int count, int maxSlots, const Job& job);
+
+private:
+    struct Worker
+    {
+        std::mutex       mutex;
+        std::deque<Task> tasks;
+        std::thread      thread;
+    };
+
+    void workerLoop(size_t index);
+    bool popTask(size_t index, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    std::mutex              _sleepMutex;
+    std::condition_variable _sleepCond;
+    std::atomic<size_t>     _pendingCount = 0;
+    std::atomic<size_t>     _nextQueue    = 0;
+    bool                    _stop         = false; // guarded by _sleepMutex
+};
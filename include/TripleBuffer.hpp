@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+// Hands the newest value of one writer thread to one reader thread without
+// locks or waiting. The writer fills back() and publish() swaps it with the
+// middle slot; update() on the reader swaps the middle slot into front() when
+// something was published since. Values the reader never picked up are
+// overwritten, the reader always sees a whole one.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Set every slot, before the threads start.
+    void fill(const T& value)
+    {
+        _slots.fill(value);
+    }
+
+    // writer side
+
+    T& back() { return _slots[_back]; }
+
+    void publish()
+    {
+        _back = _middle.exchange(_back | FreshBit, std::memory_order_acq_rel) & IndexMask;
+    }
+
+    // reader side
+
+    // Return true when front() changed.
+    bool update()
+    {
+        if (!(_middle.load(std::memory_order_relaxed) & FreshBit))
+        {
+            return false;
+        }
+        _front = _middle.exchange(_front, std::memory_order_acq_rel) & IndexMask;
+        return true;
+    }
+
+    const T& front() const { return _slots[_front]; }
+
+private:
+    static constexpr int IndexMask = 3;
+    static constexpr int FreshBit  = 4;
+
+    std::array<T, 3> _slots;
+    int              _back   = 0;
+    int              _front  = 1;
+    std::atomic<int> _middle = 2;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "FrameTap.hpp"
+
+#include <inttypes.h>
+
+#include <span>
+#include <vector>
+
+struct PeakBin
+{
+    float min;
+    float max;
+    float rms;
+};
+
+// Build a min/max/rms pyramid of every channel while decoding.
+// Coarser levels are reduced from finer bins, not from samples, so the bin
+// sizes are sorted and each is rounded up to a multiple of the previous one.
+// Non-positive and repeated bin sizes are ignored.
+class WaveformBuilder : public FrameTap
+{
+public:
+    explicit WaveformBuilder(std::vector<int> binSizes = { 256, 4096, 65536 });
+
+    void begin(int sampleRate, int channelsNum) override;
+    void process(const float* const* channels, int samples) override;
+    void end() override;
+
+    // Write the pyramid as sidecar file for WaveformPeaks.
+    bool save(const char* filename) const;
+
+private:
+    struct Accumulator
+    {
+        float   min;
+        float   max;
+        double  sumOfSquares;
+        int64_t count;
+    };
+
+    struct Level
+    {
+        int64_t                  binSize;
+        int64_t                  fill;         // samples in the open bin
+        std::vector<Accumulator> accumulators; // open bin, per channel
+        std::vector<PeakBin>     bins;         // closed bins, channels interleaved
+    };
+
+    void closeBin(size_t level);
+
+    std::vector<Level> _levels;
+    int                _sampleRate   = 0;
+    int                _channelsNum  = 0;
+    int64_t            _totalSamples = 0;
+};
+
+// Read only view of a sidecar written by WaveformBuilder, memory mapped
+// so any zoom level is served without decoding again.
+class WaveformPeaks
+{
+public:
+    ~WaveformPeaks();
+
+    bool open(const char* filename);
+    void close();
+
+    int     sampleRate()   const { return _sampleRate; }
+    int     channelsNum()  const { return _channelsNum; }
+    int64_t totalSamples() const { return _totalSamples; }
+
+    // Reduce samples [startSample, endSample) of channel into columns,
+    // from the coarsest level that still has a bin per column.
+    void query(int channel, int64_t startSample, int64_t endSample, std::span<PeakBin> columns) const;
+
+private:
+    struct Level
+    {
+        int64_t        binSize;
+        int64_t        binCount;
+        const PeakBin* bins;
+    };
+
+    uint8_t*           _fileBuffer   = nullptr;
+    size_t             _fileSize     = 0;
+    int                _sampleRate   = 0;
+    int                _channelsNum  = 0;
+    int64_t            _totalSamples = 0;
+    std::vector<Level> _levels;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// Streaming XXH64, bit compatible with the reference xxHash implementation.
+class Xxh64
+{
+public:
+    explicit Xxh64(uint64_t seed = 0) { reset(seed); }
+
+    void     reset(uint64_t seed = 0);
+    void     update(const void* data, size_t size);
+    uint64_t digest() const;
+
+private:
+    uint64_t _seed;
+    uint64_t _acc[4];
+    uint64_t _totalSize;
+    uint8_t  _buffer[32];
+    size_t   _bufferSize;
+};
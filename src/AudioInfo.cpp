@@ -22,6 +22,23 @@ AudioInfo::AudioInfo(AVFormatContext* ctx)
     _startTime    = ctx->start_time;
 }
 
+AudioInfo::AudioInfo(AVFormatContext* ctx, const AVFrame* firstFrame)
+{
+    auto sampleFormat = av_get_packed_sample_fmt((AVSampleFormat)firstFrame->format);
+
+    _type         = ctx->iformat->name;
+    _codecID      = ctx->streams[0]->codecpar->codec_id;
+    _sampleFormat = sampleFormat;
+    _sampleSize   = av_get_bytes_per_sample(sampleFormat) * 8;
+    _sampleRate   = firstFrame->sample_rate;
+    _channelsNum  = firstFrame->ch_layout.nb_channels;
+    _bitRate      = ctx->streams[0]->codecpar->bit_rate;
+    _frameSize    = firstFrame->nb_samples;
+    _formatTag    = getFormatTag();
+    _duration     = 0;
+    _startTime    = ctx->start_time;
+}
+
 uint16_t AudioInfo::getFormatTag()
 {
     switch (_codecID)
@@ -0,0 +1,223 @@
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswresample/swresample.h>
+}
+
+#include "BatchDecoder.hpp"
+#include "DecoderSetup.hpp"
+#include "ThreadPool.hpp"
+
+constexpr int MaxShortfallMs = 100; // decoded audio this much shorter than stated is truncated
+
+// Whether samplesNum falls short of the duration the container states, as
+// for a truncated file. Durations estimated from the bitrate shrink with the
+// file, so they tell nothing.
+static bool isShorterThanStated(const AVFormatContext* fmtCtx, const AVStream* stream, int sampleRate,
+                                int64_t samplesNum)
+{
+    if (stream->duration == AV_NOPTS_VALUE || fmtCtx->duration_estimation_method == AVFMT_DURATION_FROM_BITRATE)
+    {
+        return false;
+    }
+    auto stated = av_rescale_q(stream->duration, stream->time_base, { 1, sampleRate });
+    return samplesNum < stated - (int64_t)sampleRate * MaxShortfallMs / 1000;
+}
+
+// Convert frame to planar float if needed and pass it to every tap.
+static int processFrame(AVFrame* frame, SwrContext* swr, std::vector<std::vector<float>>& planes,
+                        std::vector<float*>& planePtrs, std::span<FrameTap* const> taps)
+{
+    auto channels = (const float* const*)frame->extended_data;
+
+    if (swr)
+    {
+        for (auto& plane : planes)
+        {
+            if (plane.size() < (size_t)frame->nb_samples)
+            {
+                plane.resize(frame->nb_samples);
+            }
+        }
+        for (size_t ch = 0; ch < planes.size(); ++ch)
+        {
+            planePtrs[ch] = planes[ch].data();
+        }
+
+        auto ret = swr_convert(swr, (uint8_t**)planePtrs.data(), frame->nb_samples,
+                               (const uint8_t**)frame->extended_data, frame->nb_samples);
+        if (ret < 0)
+        {
+            return ret;
+        }
+        channels = planePtrs.data();
+    }
+
+    for (auto tap : taps)
+    {
+        tap->process(channels, frame->nb_samples);
+    }
+    return 0;
+}
+
+int decodeFile(const char* filename, std::span<FrameTap* const> taps)
+{
+    AVFormatContext* fmtCtx  = nullptr;
+    AVCodecContext*  decCtx  = nullptr;
+    SwrContext*      swr     = nullptr;
+    AVPacket*        pkt     = nullptr;
+    AVFrame*         frame   = nullptr;
+    const AVCodec*   decoder = nullptr;
+
+    std::vector<std::vector<float>> planes;
+    std::vector<float*>             planePtrs;
+    bool                            isBegun    = false; // taps see end() once begin() was called
+    bool                            isDamaged  = false; // taps see abort() instead
+    int64_t                         samplesNum = 0;
+
+    int streamIndex;
+    int ret = avformat_open_input(&fmtCtx, filename, nullptr, nullptr);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    if ((ret = avformat_find_stream_info(fmtCtx, nullptr)) < 0)
+    {
+        goto end;
+    }
+
+    if ((ret = streamIndex = av_find_best_stream(fmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, &decoder, 0)) < 0)
+    {
+        goto end;
+    }
+
+    decCtx = avcodec_alloc_context3(decoder);
+    pkt    = av_packet_alloc();
+    frame  = av_frame_alloc();
+    if (!decCtx || !pkt || !frame)
+    {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    if ((ret = avcodec_parameters_to_context(decCtx, fmtCtx->streams[streamIndex]->codecpar)) < 0 ||
+        (ret = openDecoder(decCtx, decoder)) < 0)
+    {
+        goto end;
+    }
+
+    // taps always get planar float
+    if (decCtx->sample_fmt != AV_SAMPLE_FMT_FLTP)
+    {
+        ret = swr_alloc_set_opts2(&swr,
+                                  &decCtx->ch_layout, AV_SAMPLE_FMT_FLTP, decCtx->sample_rate,
+                                  &decCtx->ch_layout, decCtx->sample_fmt, decCtx->sample_rate,
+                                  0, nullptr);
+        if (ret < 0 || (ret = swr_init(swr)) < 0)
+        {
+            goto end;
+        }
+        planes.resize(decCtx->ch_layout.nb_channels);
+        planePtrs.resize(decCtx->ch_layout.nb_channels);
+    }
+
+    for (auto tap : taps)
+    {
+        tap->setChannelLayout(decCtx->ch_layout);
+        tap->begin(decCtx->sample_rate, decCtx->ch_layout.nb_channels);
+    }
+    isBegun = true;
+
+    // read, decode and flush, a null packet is sent once after the last packet
+    while (true)
+    {
+        ret = av_read_frame(fmtCtx, pkt);
+        if (ret == 0 && pkt->stream_index != streamIndex)
+        {
+            av_packet_unref(pkt);
+            continue;
+        }
+
+        // read errors fail the decode, a truncated file isn't a complete one
+        if (ret < 0 && ret != AVERROR_EOF)
+        {
+            goto end;
+        }
+
+        auto isFlushing = ret == AVERROR_EOF;
+        ret = avcodec_send_packet(decCtx, isFlushing ? nullptr : pkt);
+        av_packet_unref(pkt);
+        // skip corrupt packets like the players do
+        if (ret < 0 && ret != AVERROR_INVALIDDATA)
+        {
+            goto end;
+        }
+        isDamaged |= ret == AVERROR_INVALIDDATA;
+
+        while ((ret = avcodec_receive_frame(decCtx, frame)) >= 0)
+        {
+            samplesNum += frame->nb_samples;
+            ret         = processFrame(frame, swr, planes, planePtrs, taps);
+            av_frame_unref(frame);
+            if (ret < 0)
+            {
+                goto end;
+            }
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF && ret != AVERROR_INVALIDDATA)
+        {
+            goto end;
+        }
+        isDamaged |= ret == AVERROR_INVALIDDATA;
+
+        if (isFlushing)
+        {
+            break;
+        }
+    }
+
+    ret       = 0;
+    isDamaged = isDamaged || isShorterThanStated(fmtCtx, fmtCtx->streams[streamIndex], decCtx->sample_rate, samplesNum);
+
+end:
+    // also on failure, so writers close their files and threaded taps stop
+    if (isBegun)
+    {
+        for (auto tap : taps)
+        {
+            if (ret < 0 || isDamaged)
+            {
+                tap->abort();
+            }
+            else
+            {
+                tap->end();
+            }
+        }
+    }
+
+    swr_free(&swr);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&decCtx);
+    avformat_close_input(&fmtCtx);
+
+    return ret;
+}
+
+std::vector<int> decodeBatch(const std::vector<std::string>& files,
+                             const std::function<std::vector<FrameTap*>(size_t index)>& tapsOf)
+{
+    std::vector<int> results(files.size());
+
+    auto& pool = ThreadPool::shared();
+    pool.parallelFor((int)files.size(), (int)pool.size() + 1, [&](int index, int)
+    {
+        auto taps      = tapsOf(index);
+        results[index] = decodeFile(files[index].c_str(), taps);
+    });
+
+    return results;
+}
@@ -0,0 +1,73 @@
+extern "C"
+{
+#include <libavutil/error.h>
+#include <libavutil/mathematics.h>
+#include <libswresample/swresample.h>
+}
+
+#include "ChannelMatrix.hpp"
+#include "PcmKernels.hpp"
+
+ChannelMatrix::ChannelMatrix(int inChannelsNum, int outChannelsNum)
+    : _inChannelsNum(inChannelsNum)
+    , _outChannelsNum(outChannelsNum)
+    , _coefs((size_t)inChannelsNum * outChannelsNum, 0.0f)
+{
+}
+
+ChannelMatrix ChannelMatrix::identity(int channelsNum)
+{
+    ChannelMatrix matrix(channelsNum, channelsNum);
+    for (int ch = 0; ch < channelsNum; ++ch)
+    {
+        matrix.set(ch, ch, 1.0f);
+    }
+    return matrix;
+}
+
+int ChannelMatrix::buildDefault(const AVChannelLayout& in, const AVChannelLayout& out, double lfeMixLevel)
+{
+    if (in.nb_channels <= 0 || out.nb_channels <= 0)
+    {
+        return AVERROR(EINVAL);
+    }
+
+    std::vector<double> coefs((size_t)in.nb_channels * out.nb_channels);
+    auto ret = swr_build_matrix2(&in, &out, M_SQRT1_2, M_SQRT1_2, lfeMixLevel, 1.0, 1.0,
+                                 coefs.data(), in.nb_channels, AV_MATRIX_ENCODING_NONE, nullptr);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    *this = ChannelMatrix(in.nb_channels, out.nb_channels);
+    for (size_t i = 0; i < coefs.size(); ++i)
+    {
+        _coefs[i] = (float)coefs[i];
+    }
+    return 0;
+}
+
+bool ChannelMatrix::isIdentity() const
+{
+    if (_inChannelsNum != _outChannelsNum)
+    {
+        return false;
+    }
+    for (int o = 0; o < _outChannelsNum; ++o)
+    {
+        for (int c = 0; c < _inChannelsNum; ++c)
+        {
+            if (gain(o, c) != (o == c ? 1.0f : 0.0f))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void ChannelMatrix::apply(const float* const* channels, int offset, int samples, float* out) const
+{
+    interleaveMatrix(channels, _inChannelsNum, offset, samples, _coefs.data(), _outChannelsNum, out);
+}
@@ -0,0 +1,383 @@
+#include "CompressedPcm.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include <string.h>
+
+constexpr int PartitionSamples = 256; // one rice parameter each
+constexpr int MaxOrder         = 4;
+constexpr int EscapeZeros      = 24;  // longer quotients store the value raw
+
+//
+// Bits
+//
+
+class BitWriter
+{
+public:
+    void clear()
+    {
+        _bytes.clear();
+        _acc   = 0;
+        _count = 0;
+    }
+
+    // bits <= 32
+    void put(uint32_t value, int bits)
+    {
+        _acc    = (_acc << bits) | value;
+        _count += bits;
+        while (_count >= 8)
+        {
+            _count -= 8;
+            _bytes.push_back((uint8_t)(_acc >> _count));
+        }
+    }
+
+    void putRice(uint32_t value, int k)
+    {
+        auto quotient = value >> k;
+        if (quotient < EscapeZeros)
+        {
+            put(1, quotient + 1);
+            put(value & ((1u << k) - 1), k);
+        }
+        else
+        {
+            put(0, EscapeZeros);
+            put(value, 32);
+        }
+    }
+
+    const std::vector<uint8_t>& finish()
+    {
+        if (_count > 0)
+        {
+            _bytes.push_back((uint8_t)(_acc << (8 - _count)));
+            _count = 0;
+        }
+        return _bytes;
+    }
+
+private:
+    std::vector<uint8_t> _bytes;
+    uint64_t             _acc   = 0;
+    int                  _count = 0;
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t* data, size_t size) : _p(data), _end(data + size) {}
+
+    // bits <= 32
+    uint32_t get(int bits)
+    {
+        if (bits == 0)
+        {
+            return 0;
+        }
+        refill();
+        auto value = (uint32_t)(_acc >> (64 - bits));
+        _acc   <<= bits;
+        _count  -= bits;
+        return value;
+    }
+
+    uint32_t getRice(int k)
+    {
+        refill();
+        auto zeros = std::min(std::countl_zero(_acc), EscapeZeros);
+        if (zeros == EscapeZeros)
+        {
+            _acc   <<= EscapeZeros;
+            _count  -= EscapeZeros;
+            return get(32);
+        }
+
+        _acc   <<= zeros + 1;
+        _count  -= zeros + 1;
+        return ((uint32_t)zeros << k) | get(k);
+    }
+
+private:
+    // keep at least 57 bits, left aligned
+    void refill()
+    {
+        while (_count <= 56)
+        {
+            _acc   |= (uint64_t)(_p < _end ? *_p++ : 0) << (56 - _count);
+            _count += 8;
+        }
+    }
+
+    const uint8_t* _p;
+    const uint8_t* _end;
+    uint64_t       _acc   = 0;
+    int            _count = 0;
+};
+
+//
+// Prediction
+//
+
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// fixed polynomial predictors, samples before the block count as 0
+static int32_t predict(const int32_t* x, int i, int order)
+{
+    auto at = [&](int back) { return i >= back ? x[i - back] : 0; };
+    switch (order)
+    {
+    case 0:  return 0;
+    case 1:  return at(1);
+    case 2:  return 2 * at(1) - at(2);
+    case 3:  return 3 * at(1) - 3 * at(2) + at(3);
+    default: return 4 * at(1) - 6 * at(2) + 4 * at(3) - at(4);
+    }
+}
+
+// sum of absolute residuals of every order at once, return the cheapest order
+static int bestOrder(const int32_t* x, int n, int64_t& cost)
+{
+    int64_t sums[MaxOrder + 1] = {};
+    int64_t e[MaxOrder + 1]    = {};
+    int64_t last[MaxOrder + 1] = {}; // residual of the previous sample per order
+    for (int i = 0; i < n; ++i)
+    {
+        e[0] = x[i];
+        for (int order = 1; order <= MaxOrder; ++order)
+        {
+            e[order] = e[order - 1] - last[order - 1];
+        }
+        for (int order = 0; order <= MaxOrder; ++order)
+        {
+            sums[order] += std::abs(e[order]);
+            last[order]  = e[order];
+        }
+    }
+
+    auto best = (int)(std::min_element(sums, sums + MaxOrder + 1) - sums);
+    cost      = sums[best];
+    return best;
+}
+
+static int riceParameter(const uint32_t* values, int n)
+{
+    uint64_t sum = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        sum += values[i];
+    }
+
+    // about log2 of the mean
+    int k = 0;
+    while (k < 30 && ((uint64_t)n << (k + 1)) <= sum)
+    {
+        ++k;
+    }
+    return k;
+}
+
+static void encodeChannel(const int32_t* x, int n, BitWriter& writer, std::vector<uint32_t>& residuals)
+{
+    int64_t cost;
+    auto    order = bestOrder(x, n, cost);
+    writer.put(order, 3);
+
+    residuals.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        residuals[i] = zigzag(x[i] - predict(x, i, order));
+    }
+
+    for (int start = 0; start < n; start += PartitionSamples)
+    {
+        auto count = std::min(PartitionSamples, n - start);
+        auto k     = riceParameter(residuals.data() + start, count);
+        writer.put(k, 5);
+        for (int i = start; i < start + count; ++i)
+        {
+            writer.putRice(residuals[i], k);
+        }
+    }
+}
+
+static void decodeChannel(BitReader& reader, int n, int32_t* x)
+{
+    auto order = (int)reader.get(3);
+    for (int start = 0; start < n; start += PartitionSamples)
+    {
+        auto count = std::min(PartitionSamples, n - start);
+        auto k     = (int)reader.get(5);
+        for (int i = start; i < start + count; ++i)
+        {
+            x[i] = unzigzag(reader.getRice(k)) + predict(x, i, order);
+        }
+    }
+}
+
+//
+// CompressedPcm
+//
+
+CompressedPcm::CompressedPcm(int bitsPerSample)
+    : _bitsPerSample(std::clamp(bitsPerSample, 8, 24))
+    , _scale((float)((1 << (_bitsPerSample - 1)) - 1))
+{
+}
+
+void CompressedPcm::begin(int sampleRate, int channelsNum)
+{
+    _sampleRate      = sampleRate;
+    _channelsNum     = channelsNum;
+    _samplesNum      = 0;
+    _compressedBytes = 0;
+    _pendingCount    = 0;
+    _decodedBlock    = -1;
+    _blocks.clear();
+    _pending.assign(channelsNum, std::vector<int32_t>(BlockSamples));
+}
+
+void CompressedPcm::process(const float* const* channels, int samples)
+{
+    for (int offset = 0; offset < samples;)
+    {
+        auto count = std::min(samples - offset, BlockSamples - _pendingCount);
+        for (int ch = 0; ch < _channelsNum; ++ch)
+        {
+            auto in  = channels[ch] + offset;
+            auto out = _pending[ch].data() + _pendingCount;
+            for (int i = 0; i < count; ++i)
+            {
+                out[i] = (int32_t)std::lrint(std::clamp(in[i], -1.0f, 1.0f) * _scale);
+            }
+        }
+        offset        += count;
+        _pendingCount += count;
+        _samplesNum   += count;
+
+        if (_pendingCount == BlockSamples)
+        {
+            encodeBlock();
+        }
+    }
+}
+
+void CompressedPcm::end()
+{
+    if (_pendingCount > 0)
+    {
+        encodeBlock();
+    }
+    _pending.clear();
+    _pending.shrink_to_fit();
+}
+
+void CompressedPcm::encodeBlock()
+{
+    static thread_local BitWriter             writer;
+    static thread_local std::vector<uint32_t> residuals;
+    writer.clear();
+
+    auto n = _pendingCount;
+
+    // left/side when the difference predicts better than the right channel
+    auto isSide = false;
+    if (_channelsNum == 2)
+    {
+        auto& left  = _pending[0];
+        auto& right = _pending[1];
+
+        static thread_local std::vector<int32_t> side;
+        side.resize(n);
+        for (int i = 0; i < n; ++i)
+        {
+            side[i] = left[i] - right[i];
+        }
+
+        int64_t rightCost, sideCost;
+        bestOrder(right.data(), n, rightCost);
+        bestOrder(side.data(), n, sideCost);
+        isSide = sideCost < rightCost;
+        if (isSide)
+        {
+            std::copy(side.begin(), side.end(), right.begin());
+        }
+        writer.put(isSide, 1);
+    }
+
+    for (int ch = 0; ch < _channelsNum; ++ch)
+    {
+        encodeChannel(_pending[ch].data(), n, writer, residuals);
+    }
+
+    auto& bytes = writer.finish();
+    _blocks.emplace_back(bytes.begin(), bytes.end());
+    _compressedBytes += bytes.size();
+    _pendingCount     = 0;
+}
+
+void CompressedPcm::decodeBlock(int64_t block) const
+{
+    auto n = (int)std::min<int64_t>(BlockSamples, _samplesNum - block * BlockSamples);
+    _planes.resize((size_t)n * _channelsNum);
+    _decoded.resize((size_t)n * _channelsNum);
+
+    auto&     bytes = _blocks[block];
+    BitReader reader(bytes.data(), bytes.size());
+
+    auto isSide = _channelsNum == 2 && reader.get(1);
+    for (int ch = 0; ch < _channelsNum; ++ch)
+    {
+        decodeChannel(reader, n, _planes.data() + (size_t)ch * n);
+    }
+
+    auto invScale = 1.0f / _scale;
+    for (int ch = 0; ch < _channelsNum; ++ch)
+    {
+        auto plane = _planes.data() + (size_t)ch * n;
+        auto left  = _planes.data();
+        for (int i = 0; i < n; ++i)
+        {
+            auto value = isSide && ch == 1 ? left[i] - plane[i] : plane[i];
+            _decoded[(size_t)i * _channelsNum + ch] = value * invScale;
+        }
+    }
+    _decodedBlock = block;
+}
+
+int64_t CompressedPcm::read(int64_t start, int64_t count, float* out) const
+{
+    start = std::clamp<int64_t>(start, 0, _samplesNum);
+    count = std::clamp<int64_t>(count, 0, _samplesNum - start);
+
+    int64_t copied = 0;
+    while (copied < count)
+    {
+        auto position = start + copied;
+        auto block    = position / BlockSamples;
+        if (block != _decodedBlock)
+        {
+            decodeBlock(block);
+        }
+
+        auto offset    = position - block * BlockSamples;
+        auto available = (int64_t)_decoded.size() / _channelsNum - offset;
+        auto n         = std::min(count - copied, available);
+        memcpy(out + copied * _channelsNum, _decoded.data() + offset * _channelsNum,
+               (size_t)n * _channelsNum * sizeof(float));
+        copied += n;
+    }
+    return copied;
+}
@@ -0,0 +1,196 @@
+#include "DecodePipeline.hpp"
+#include "DecoderSetup.hpp"
+#include "FileIo.hpp"
+#include "PcmKernels.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <errno.h>
+#include <string.h>
+
+constexpr int BufferSize   = 20480; // file read size
+constexpr int RefillThresh = 4096;
+
+// a stage may be destroyed suspended, what it allocated must free itself
+struct PacketFree       { void operator()(AVPacket* p)             const { av_packet_free(&p); } };
+struct FrameFree        { void operator()(AVFrame* p)              const { av_frame_free(&p); } };
+struct CodecContextFree { void operator()(AVCodecContext* p)       const { avcodec_free_context(&p); } };
+struct ParserClose      { void operator()(AVCodecParserContext* p) const { av_parser_close(p); } };
+struct FileClose        { void operator()(FILE* p)                 const { fclose(p); } };
+
+Generator<AVPacket*> parsePackets(FILE* file, AVCodecParserContext* parser, AVCodecContext* decCtx, int& error)
+{
+    std::unique_ptr<AVPacket, PacketFree> pkt(av_packet_alloc());
+    if (!pkt)
+    {
+        error = AVERROR(ENOMEM);
+        co_return;
+    }
+
+    std::vector<uint8_t> input(BufferSize + RefillThresh + AV_INPUT_BUFFER_PADDING_SIZE);
+    uint8_t*             data     = input.data();
+    size_t               readSize = 0;
+    bool                 eof      = false;
+    while (true)
+    {
+        // keep enough input for the parser to find a whole frame
+        if (readSize < RefillThresh && !eof)
+        {
+            memmove(input.data(), data, readSize);
+            data      = input.data();
+            readSize += fread(data + readSize, 1, BufferSize - readSize, file);
+            eof       = feof(file) != 0;
+            if (ferror(file))
+            {
+                error = AVERROR(EIO);
+                co_return;
+            }
+        }
+
+        // empty input flushes the parser
+        auto ret = av_parser_parse2(parser, decCtx, &pkt->data, &pkt->size,
+                                    data, (int)readSize,
+                                    AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+        if (ret < 0)
+        {
+            error = ret;
+            co_return;
+        }
+        data     += ret;
+        readSize -= ret;
+
+        if (pkt->size)
+        {
+            co_yield pkt.get();
+        }
+        else if (readSize == 0 && eof)
+        {
+            co_return;
+        }
+    }
+}
+
+Generator<AVFrame*> decodeFrames(AVCodecContext* decCtx, Generator<AVPacket*> packets, int& error)
+{
+    std::unique_ptr<AVFrame, FrameFree> frame(av_frame_alloc());
+    if (!frame)
+    {
+        error = AVERROR(ENOMEM);
+        co_return;
+    }
+
+    // a null packet is sent once after the last packet
+    auto packet = packets.begin();
+    while (error == 0)
+    {
+        auto isFlushing = packet == packets.end();
+        auto ret        = avcodec_send_packet(decCtx, isFlushing ? nullptr : *packet);
+        // skip corrupt packets like the players do
+        if (ret < 0 && ret != AVERROR_INVALIDDATA)
+        {
+            error = ret;
+            co_return;
+        }
+
+        while ((ret = avcodec_receive_frame(decCtx, frame.get())) >= 0)
+        {
+            co_yield frame.get();
+            av_frame_unref(frame.get());
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+        {
+            error = ret;
+            co_return;
+        }
+
+        if (isFlushing)
+        {
+            co_return;
+        }
+        ++packet;
+    }
+}
+
+Generator<std::span<const uint8_t>> fillBlocks(Generator<AVFrame*> frames, int blockSize, int& error)
+{
+    std::vector<uint8_t> block(blockSize);
+    int                  storeSize = 0;
+    for (auto frame : frames)
+    {
+        auto fmt        = (AVSampleFormat)frame->format;
+        auto blockAlign = frame->ch_layout.nb_channels * (int)sizeof(float);
+        if (av_get_packed_sample_fmt(fmt) != AV_SAMPLE_FMT_FLT || blockSize < blockAlign)
+        {
+            error = AVERROR(EINVAL);
+            co_return;
+        }
+
+        // a frame overflowing the block continues in the next one
+        for (int offset = 0; offset < frame->nb_samples;)
+        {
+            auto count = std::min(frame->nb_samples - offset, (blockSize - storeSize) / blockAlign);
+            auto out   = (float*)(block.data() + storeSize);
+            if (av_sample_fmt_is_planar(fmt))
+            {
+                interleaveFloat((const float* const*)frame->extended_data, frame->ch_layout.nb_channels, offset, count, out);
+            }
+            else
+            {
+                memcpy(out, frame->data[0] + (size_t)offset * blockAlign, (size_t)count * blockAlign);
+            }
+            storeSize += count * blockAlign;
+            offset    += count;
+
+            if (blockSize - storeSize < blockAlign)
+            {
+                co_yield std::span<const uint8_t>(block.data(), storeSize);
+                storeSize = 0;
+            }
+        }
+    }
+
+    if (storeSize > 0 && error == 0)
+    {
+        co_yield std::span<const uint8_t>(block.data(), storeSize);
+    }
+}
+
+Generator<std::span<const uint8_t>> decodeBlocks(const char* filename, int blockSize, int& error)
+{
+    std::unique_ptr<FILE, FileClose> file(fopen(filename, "rb"));
+    if (!file)
+    {
+        error = AVERROR(errno);
+        co_return;
+    }
+    seekFile(file.get(), getID3TagEnd(file.get()), SEEK_SET);
+
+    auto decoder = avcodec_find_decoder(AV_CODEC_ID_MP3);
+    if (!decoder)
+    {
+        error = AVERROR_DECODER_NOT_FOUND;
+        co_return;
+    }
+
+    std::unique_ptr<AVCodecContext, CodecContextFree>  decCtx(avcodec_alloc_context3(decoder));
+    std::unique_ptr<AVCodecParserContext, ParserClose> parser(av_parser_init(decoder->id));
+    if (!decCtx || !parser)
+    {
+        error = AVERROR(ENOMEM);
+        co_return;
+    }
+    if (auto ret = openDecoder(decCtx.get(), decoder); ret < 0)
+    {
+        error = ret;
+        co_return;
+    }
+
+    auto packets = parsePackets(file.get(), parser.get(), decCtx.get(), error);
+    auto frames  = decodeFrames(decCtx.get(), std::move(packets), error);
+    for (auto block : fillBlocks(std::move(frames), blockSize, error))
+    {
+        co_yield block;
+    }
+}
@@ -0,0 +1,213 @@
+extern "C"
+{
+#include <libavutil/error.h>
+}
+
+#include "DecodeScheduler.hpp"
+
+#include <algorithm>
+
+// StreamDecoderSource which owns its decoder.
+class FileSource : public MixerSource
+{
+public:
+    FileSource() : _source(_decoder) {}
+
+    int open(const char* filename) { return _decoder.open(filename); }
+
+    int sampleRate()  const override { return _source.sampleRate(); }
+    int channelsNum() const override { return _source.channelsNum(); }
+
+    int read(float* out, int samples) override { return _source.read(out, samples); }
+
+private:
+    StreamDecoder       _decoder;
+    StreamDecoderSource _source;
+};
+
+DecodeScheduler::Clock::time_point DecodeScheduler::Stream::deadline() const
+{
+    auto played = std::chrono::duration<double>((double)decodedSamples / source->sampleRate());
+    return playStart + std::chrono::duration_cast<Clock::duration>(played);
+}
+
+DecodeScheduler::DecodeScheduler(size_t         workersNum,
+                                 SchedulePolicy policy,
+                                 double         bufferSeconds,
+                                 double         quantumSeconds,
+                                 double         startDelaySeconds)
+    : _policy(policy)
+    , _buffer(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(bufferSeconds)))
+    , _quantumSeconds(quantumSeconds)
+    , _startDelay(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(startDelaySeconds)))
+{
+    workersNum = std::max<size_t>(workersNum, 1);
+    for (size_t i = 0; i < workersNum; ++i)
+    {
+        _workers.emplace_back(&DecodeScheduler::workerLoop, this);
+    }
+}
+
+DecodeScheduler::~DecodeScheduler()
+{
+    stop();
+}
+
+int DecodeScheduler::addStream(const char* filename, Sink sink)
+{
+    auto source = std::make_unique<FileSource>();
+    if (auto ret = source->open(filename); ret < 0)
+    {
+        return ret;
+    }
+    return addSource(std::move(source), std::move(sink));
+}
+
+int DecodeScheduler::addSource(std::unique_ptr<MixerSource> source, Sink sink)
+{
+    if (!source || source->sampleRate() <= 0)
+    {
+        return AVERROR(EINVAL);
+    }
+
+    auto stream            = std::make_unique<Stream>();
+    stream->quantumSamples = std::max(1, (int)(_quantumSeconds * source->sampleRate()));
+    stream->scratch.resize((size_t)stream->quantumSamples * source->channelsNum());
+    stream->source         = std::move(source);
+    stream->sink           = std::move(sink);
+    stream->playStart      = Clock::now() + _startDelay;
+
+    int index;
+    {
+        std::lock_guard lock(_mutex);
+        _streams.push_back(std::move(stream));
+        index = (int)_streams.size() - 1;
+        ++_stats.playingNum;
+    }
+    _cond.notify_all();
+    return index;
+}
+
+void DecodeScheduler::stop()
+{
+    {
+        std::lock_guard lock(_mutex);
+        if (_stop)
+        {
+            return;
+        }
+        _stop = true;
+    }
+    _cond.notify_all();
+
+    for (auto& worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+DecodeSchedulerStats DecodeScheduler::stats() const
+{
+    std::lock_guard lock(_mutex);
+    return _stats;
+}
+
+// A linear scan, a quantum of decoding costs far more than a few hundred compares.
+DecodeScheduler::Stream* DecodeScheduler::pickStream(Clock::time_point now, Clock::time_point& wake)
+{
+    Stream* next = nullptr;
+    wake         = Clock::time_point::max();
+    for (auto& stream : _streams)
+    {
+        if (stream->isBusy || stream->isFinished)
+        {
+            continue;
+        }
+
+        // enough decoded ahead until the buffer drains below _buffer
+        auto refill = stream->deadline() - _buffer;
+        if (refill > now)
+        {
+            wake = std::min(wake, refill);
+            continue;
+        }
+
+        auto isBetter = !next ||
+            (_policy == SchedulePolicy::EarliestDeadline ? stream->deadline() < next->deadline()
+                                                         : stream->lastRun < next->lastRun);
+        if (isBetter)
+        {
+            next = stream.get();
+        }
+    }
+    return next;
+}
+
+void DecodeScheduler::runQuantum(Stream& stream, std::unique_lock<std::mutex>& lock)
+{
+    stream.isBusy  = true;
+    stream.lastRun = ++_runCount;
+    auto deadline  = stream.deadline();
+    lock.unlock();
+
+    int filled = 0;
+    while (filled < stream.quantumSamples)
+    {
+        auto ret = stream.source->read(stream.scratch.data() + (size_t)filled * stream.source->channelsNum(),
+                                       stream.quantumSamples - filled);
+        if (ret <= 0)
+        {
+            break;
+        }
+        filled += ret;
+    }
+    if (filled > 0 && stream.sink)
+    {
+        stream.sink(stream.scratch.data(), filled);
+    }
+    auto done = Clock::now();
+
+    lock.lock();
+    stream.isBusy          = false;
+    stream.decodedSamples += filled;
+    ++_stats.quanta;
+
+    if (done > deadline)
+    {
+        // the output ran dry and resumes with this quantum
+        stream.playStart     += done - deadline;
+        _stats.maxLatenessMs  = std::max(_stats.maxLatenessMs,
+                                         std::chrono::duration<double, std::milli>(done - deadline).count());
+        ++_stats.missedDeadlines;
+    }
+
+    if (filled < stream.quantumSamples)
+    {
+        stream.isFinished = true;
+        stream.source.reset();
+        --_stats.playingNum;
+        ++_stats.finishedNum;
+    }
+}
+
+void DecodeScheduler::workerLoop()
+{
+    std::unique_lock lock(_mutex);
+    while (!_stop)
+    {
+        Clock::time_point wake;
+        if (auto stream = pickStream(Clock::now(), wake))
+        {
+            runQuantum(*stream, lock);
+            _cond.notify_one(); // the stream may be runnable again
+        }
+        else if (wake == Clock::time_point::max())
+        {
+            _cond.wait(lock);
+        }
+        else
+        {
+            _cond.wait_until(lock, wake);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#include "DecoderSetup.hpp"
+#include "ThreadPool.hpp"
+
+static int sharedExecute(AVCodecContext* c, int (*func)(AVCodecContext* c2, void* arg),
+                         void* arg2, int* ret, int count, int size)
+{
+    ThreadPool::shared().parallelFor(count, c->thread_count, [&](int jobIndex, int)
+    {
+        auto r = func(c, (uint8_t*)arg2 + jobIndex * size);
+        if (ret)
+        {
+            ret[jobIndex] = r;
+        }
+    });
+    return 0;
+}
+
+static int sharedExecute2(AVCodecContext* c, int (*func)(AVCodecContext* c2, void* arg, int jobnr, int threadnr),
+                          void* arg2, int* ret, int count)
+{
+    // slot is unique among running jobs and below thread_count,
+    // which is what the codec expects from threadnr
+    ThreadPool::shared().parallelFor(count, c->thread_count, [&](int jobIndex, int slot)
+    {
+        auto r = func(c, arg2, jobIndex, slot);
+        if (ret)
+        {
+            ret[jobIndex] = r;
+        }
+    });
+    return 0;
+}
+
+int openDecoder(AVCodecContext* decCtx, const AVCodec* decoder, AVDictionary** options, bool useSharedPool)
+{
+    if (!useSharedPool)
+    {
+        decCtx->thread_count = 1;
+        return avcodec_open2(decCtx, decoder, options);
+    }
+
+    // Size the codec's per-thread state for the pool. Only slice threading,
+    // frame threading would still run one thread per frame in flight.
+    decCtx->thread_count = (int)ThreadPool::shared().size();
+    decCtx->thread_type  = FF_THREAD_SLICE;
+
+    auto ret = avcodec_open2(decCtx, decoder, options);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    // Replace the callbacks installed by libavcodec, its own slice threads
+    // stay idle from now on. Codecs without slice threading
+    // (like mp3) got thread_count = 1 and never call these.
+    if (decCtx->active_thread_type & FF_THREAD_SLICE)
+    {
+        decCtx->execute  = sharedExecute;
+        decCtx->execute2 = sharedExecute2;
+    }
+
+    return ret;
+}
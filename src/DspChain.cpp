@@ -0,0 +1,481 @@
+#include "DspChain.hpp"
+#include "PcmKernels.hpp"
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+
+constexpr float GainSnap = 1e-5f; // a smoothed gain this close to its target jumps onto it
+
+// samples *= gain, n floats
+static void scale(float* samples, int n, float gain)
+{
+    int i = 0;
+
+#if defined(HAS_AVX2)
+    auto g8 = _mm256_set1_ps(gain);
+    for (; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), g8));
+    }
+#elif defined(HAS_SSE2)
+    auto g4 = _mm_set1_ps(gain);
+    for (; i + 4 <= n; i += 4)
+    {
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), g4));
+    }
+#endif
+
+    for (; i < n; ++i)
+    {
+        samples[i] *= gain;
+    }
+}
+
+//
+// DspChain
+//
+
+void DspChain::add(DspEffect* effect)
+{
+    _slots.push_back({ effect, 0, 0 });
+}
+
+void DspChain::prepare(int sampleRate, int channelsNum, int maxBlockSamples)
+{
+    for (auto& slot : _slots)
+    {
+        slot.effect->prepare(sampleRate, channelsNum, maxBlockSamples);
+    }
+}
+
+void DspChain::process(float* samples, int count)
+{
+#ifdef HAS_SSE2
+    // flush denormals to zero, decaying filter and smoother state would crawl through them
+    auto csr = _mm_getcsr();
+    _mm_setcsr(csr | 0x8040);
+#endif
+
+    for (auto& slot : _slots)
+    {
+        auto start = std::chrono::steady_clock::now();
+        slot.effect->process(samples, count);
+        slot.ns      += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        slot.samples += count;
+    }
+
+#ifdef HAS_SSE2
+    _mm_setcsr(csr);
+#endif
+}
+
+void DspChain::reset()
+{
+    for (auto& slot : _slots)
+    {
+        slot.effect->reset();
+    }
+}
+
+int DspChain::latencySamples() const
+{
+    int latency = 0;
+    for (auto& slot : _slots)
+    {
+        latency += slot.effect->latencySamples();
+    }
+    return latency;
+}
+
+std::vector<DspEffectCost> DspChain::costs() const
+{
+    std::vector<DspEffectCost> costs;
+    for (auto& slot : _slots)
+    {
+        costs.push_back({ slot.effect->name(), slot.samples ? (double)slot.ns / slot.samples : 0.0, slot.samples });
+    }
+    return costs;
+}
+
+void DspChain::resetCosts()
+{
+    for (auto& slot : _slots)
+    {
+        slot.ns      = 0;
+        slot.samples = 0;
+    }
+}
+
+//
+// SmoothedGain
+//
+
+SmoothedGain::SmoothedGain(float gainDb, float smoothingMs)
+    : _target(dbToGain(gainDb))
+    , _gain(dbToGain(gainDb))
+    , _smoothingMs(smoothingMs)
+{
+}
+
+void SmoothedGain::setGainDb(float gainDb)
+{
+    _target.store(dbToGain(gainDb), std::memory_order_relaxed);
+}
+
+void SmoothedGain::prepare(int sampleRate, int channelsNum, int /*maxBlockSamples*/)
+{
+    _channelsNum = channelsNum;
+    _coef        = 1.0f - std::exp(-1000.0f / (std::max(_smoothingMs, 0.01f) * sampleRate));
+}
+
+void SmoothedGain::process(float* samples, int count)
+{
+    auto target = _target.load(std::memory_order_relaxed);
+
+    // ramp sample by sample while the gain moves, a single multiply once it's there
+    int i = 0;
+    for (; i < count && std::fabs(target - _gain) > GainSnap; ++i)
+    {
+        _gain += (target - _gain) * _coef;
+        for (int ch = 0; ch < _channelsNum; ++ch)
+        {
+            samples[i * _channelsNum + ch] *= _gain;
+        }
+    }
+    if (i == count)
+    {
+        return;
+    }
+
+    _gain = target;
+    if (_gain != 1.0f)
+    {
+        scale(samples + i * _channelsNum, (count - i) * _channelsNum, _gain);
+    }
+}
+
+void SmoothedGain::reset()
+{
+    _gain = _target.load(std::memory_order_relaxed);
+}
+
+//
+// BiquadCascade
+//
+
+// One stage over the lanes of a vector, x advancing by stride floats per sample.
+// y = b0 x + z1, z1 = b1 x - a1 y + z2, z2 = b2 x - a2 y
+
+#ifdef HAS_AVX2
+static void filterLanes8(const float* c, float* x, int stride, int count, float* z1, float* z2)
+{
+    auto b0 = _mm256_set1_ps(c[0]);
+    auto b1 = _mm256_set1_ps(c[1]);
+    auto b2 = _mm256_set1_ps(c[2]);
+    auto a1 = _mm256_set1_ps(c[3]);
+    auto a2 = _mm256_set1_ps(c[4]);
+    auto s1 = _mm256_loadu_ps(z1);
+    auto s2 = _mm256_loadu_ps(z2);
+    for (int i = 0; i < count; ++i, x += stride)
+    {
+        auto in  = _mm256_loadu_ps(x);
+        auto out = _mm256_add_ps(_mm256_mul_ps(b0, in), s1);
+        s1 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b1, in), _mm256_mul_ps(a1, out)), s2);
+        s2 = _mm256_sub_ps(_mm256_mul_ps(b2, in), _mm256_mul_ps(a2, out));
+        _mm256_storeu_ps(x, out);
+    }
+    _mm256_storeu_ps(z1, s1);
+    _mm256_storeu_ps(z2, s2);
+}
+#endif
+
+#ifdef HAS_SSE2
+static void filterLanes4(const float* c, float* x, int stride, int count, float* z1, float* z2)
+{
+    auto b0 = _mm_set1_ps(c[0]);
+    auto b1 = _mm_set1_ps(c[1]);
+    auto b2 = _mm_set1_ps(c[2]);
+    auto a1 = _mm_set1_ps(c[3]);
+    auto a2 = _mm_set1_ps(c[4]);
+    auto s1 = _mm_loadu_ps(z1);
+    auto s2 = _mm_loadu_ps(z2);
+    for (int i = 0; i < count; ++i, x += stride)
+    {
+        auto in  = _mm_loadu_ps(x);
+        auto out = _mm_add_ps(_mm_mul_ps(b0, in), s1);
+        s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, in), _mm_mul_ps(a1, out)), s2);
+        s2 = _mm_sub_ps(_mm_mul_ps(b2, in), _mm_mul_ps(a2, out));
+        _mm_storeu_ps(x, out);
+    }
+    _mm_storeu_ps(z1, s1);
+    _mm_storeu_ps(z2, s2);
+}
+
+// two channels in the low half, the high half runs on zeros
+static void filterLanes2(const float* c, float* x, int stride, int count, float* z1, float* z2)
+{
+    auto b0 = _mm_set1_ps(c[0]);
+    auto b1 = _mm_set1_ps(c[1]);
+    auto b2 = _mm_set1_ps(c[2]);
+    auto a1 = _mm_set1_ps(c[3]);
+    auto a2 = _mm_set1_ps(c[4]);
+    auto s1 = _mm_castpd_ps(_mm_load_sd((const double*)z1));
+    auto s2 = _mm_castpd_ps(_mm_load_sd((const double*)z2));
+    for (int i = 0; i < count; ++i, x += stride)
+    {
+        auto in  = _mm_castpd_ps(_mm_load_sd((const double*)x));
+        auto out = _mm_add_ps(_mm_mul_ps(b0, in), s1);
+        s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, in), _mm_mul_ps(a1, out)), s2);
+        s2 = _mm_sub_ps(_mm_mul_ps(b2, in), _mm_mul_ps(a2, out));
+        _mm_store_sd((double*)x, _mm_castps_pd(out));
+    }
+    _mm_store_sd((double*)z1, _mm_castps_pd(s1));
+    _mm_store_sd((double*)z2, _mm_castps_pd(s2));
+}
+#endif
+
+static void filterLane(const float* c, float* x, int stride, int count, float* z1, float* z2)
+{
+    auto s1 = *z1;
+    auto s2 = *z2;
+    for (int i = 0; i < count; ++i, x += stride)
+    {
+        auto in  = *x;
+        auto out = c[0] * in + s1;
+        s1 = c[1] * in - c[3] * out + s2;
+        s2 = c[2] * in - c[4] * out;
+        *x = out;
+    }
+    *z1 = s1;
+    *z2 = s2;
+}
+
+void BiquadCascade::addStage(BiquadType type, float frequency, float q, float gainDb)
+{
+    _specs.push_back({ type, frequency, q, gainDb });
+}
+
+void BiquadCascade::prepare(int sampleRate, int channelsNum, int /*maxBlockSamples*/)
+{
+    _channelsNum = channelsNum;
+    _coefs.clear();
+    for (auto& spec : _specs)
+    {
+        auto frequency = std::clamp((double)spec.frequency, 1.0, 0.49 * sampleRate);
+        auto w0        = 2 * std::numbers::pi * frequency / sampleRate;
+        auto cosW0     = std::cos(w0);
+        auto alpha     = std::sin(w0) / (2 * std::max((double)spec.q, 0.01));
+        auto A         = std::pow(10.0, spec.gainDb / 40.0);
+        auto shelf     = 2 * std::sqrt(A) * alpha;
+
+        double b0, b1, b2, a0, a1, a2;
+        switch (spec.type)
+        {
+        case BiquadType::LowPass:
+            b0 = (1 - cosW0) / 2;
+            b1 = 1 - cosW0;
+            b2 = (1 - cosW0) / 2;
+            a0 = 1 + alpha;
+            a1 = -2 * cosW0;
+            a2 = 1 - alpha;
+            break;
+        case BiquadType::HighPass:
+            b0 = (1 + cosW0) / 2;
+            b1 = -(1 + cosW0);
+            b2 = (1 + cosW0) / 2;
+            a0 = 1 + alpha;
+            a1 = -2 * cosW0;
+            a2 = 1 - alpha;
+            break;
+        case BiquadType::Peaking:
+            b0 = 1 + alpha * A;
+            b1 = -2 * cosW0;
+            b2 = 1 - alpha * A;
+            a0 = 1 + alpha / A;
+            a1 = -2 * cosW0;
+            a2 = 1 - alpha / A;
+            break;
+        case BiquadType::LowShelf:
+            b0 = A * ((A + 1) - (A - 1) * cosW0 + shelf);
+            b1 = 2 * A * ((A - 1) - (A + 1) * cosW0);
+            b2 = A * ((A + 1) - (A - 1) * cosW0 - shelf);
+            a0 = (A + 1) + (A - 1) * cosW0 + shelf;
+            a1 = -2 * ((A - 1) + (A + 1) * cosW0);
+            a2 = (A + 1) + (A - 1) * cosW0 - shelf;
+            break;
+        case BiquadType::HighShelf:
+        default:
+            b0 = A * ((A + 1) + (A - 1) * cosW0 + shelf);
+            b1 = -2 * A * ((A - 1) + (A + 1) * cosW0);
+            b2 = A * ((A + 1) + (A - 1) * cosW0 - shelf);
+            a0 = (A + 1) - (A - 1) * cosW0 + shelf;
+            a1 = 2 * ((A - 1) - (A + 1) * cosW0);
+            a2 = (A + 1) - (A - 1) * cosW0 - shelf;
+            break;
+        }
+        _coefs.push_back({ (float)(b0 / a0), (float)(b1 / a0), (float)(b2 / a0), (float)(a1 / a0), (float)(a2 / a0) });
+    }
+
+    _z1.assign(_specs.size() * channelsNum, 0.0f);
+    _z2.assign(_specs.size() * channelsNum, 0.0f);
+}
+
+// A stage at a time over the block keeps its state in registers; the block
+// stays in cache between the stages.
+void BiquadCascade::process(float* samples, int count)
+{
+    for (size_t stage = 0; stage < _coefs.size(); ++stage)
+    {
+        auto c  = &_coefs[stage].b0;
+        auto z1 = _z1.data() + stage * _channelsNum;
+        auto z2 = _z2.data() + stage * _channelsNum;
+
+        int ch = 0;
+#ifdef HAS_AVX2
+        for (; ch + 8 <= _channelsNum; ch += 8)
+        {
+            filterLanes8(c, samples + ch, _channelsNum, count, z1 + ch, z2 + ch);
+        }
+#endif
+#ifdef HAS_SSE2
+        for (; ch + 4 <= _channelsNum; ch += 4)
+        {
+            filterLanes4(c, samples + ch, _channelsNum, count, z1 + ch, z2 + ch);
+        }
+        if (ch + 2 <= _channelsNum)
+        {
+            filterLanes2(c, samples + ch, _channelsNum, count, z1 + ch, z2 + ch);
+            ch += 2;
+        }
+#endif
+        for (; ch < _channelsNum; ++ch)
+        {
+            filterLane(c, samples + ch, _channelsNum, count, z1 + ch, z2 + ch);
+        }
+    }
+}
+
+void BiquadCascade::reset()
+{
+    std::fill(_z1.begin(), _z1.end(), 0.0f);
+    std::fill(_z2.begin(), _z2.end(), 0.0f);
+}
+
+//
+// Limiter
+//
+
+Limiter::Limiter(float thresholdDb, float lookaheadMs, float releaseMs)
+    : _threshold(dbToGain(thresholdDb))
+    , _lookaheadMs(lookaheadMs)
+    , _releaseMs(releaseMs)
+{
+}
+
+void Limiter::prepare(int sampleRate, int channelsNum, int maxBlockSamples)
+{
+    _channelsNum = channelsNum;
+    _window      = std::max(1, (int)std::lround(_lookaheadMs * sampleRate / 1000));
+    _releaseCoef = std::exp(-1000.0f / (std::max(_releaseMs, 0.01f) * sampleRate));
+
+    _peaks.resize(maxBlockSamples);
+    _delay.resize((size_t)_window * channelsNum);
+    _boxRing.resize(_window);
+    _minValues.resize(_window);
+    _minPositions.resize(_window);
+    reset();
+}
+
+void Limiter::reset()
+{
+    std::fill(_delay.begin(), _delay.end(), 0.0f);
+    std::fill(_boxRing.begin(), _boxRing.end(), 1.0f);
+    _position = 0;
+    _minHead  = 0;
+    _minCount = 0;
+    _ringPos  = 0;
+    _boxSum   = _window;
+    _envelope = 1.0f;
+    _minGain  = 1.0f;
+}
+
+void Limiter::computePeaks(const float* samples, int count)
+{
+    int i = 0;
+
+#ifdef HAS_SSE2
+    if (_channelsNum == 2)
+    {
+        auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        for (; i + 4 <= count; i += 4)
+        {
+            auto a = _mm_and_ps(_mm_loadu_ps(samples + i * 2),     absMask);
+            auto b = _mm_and_ps(_mm_loadu_ps(samples + i * 2 + 4), absMask);
+            auto left  = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            auto right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(_peaks.data() + i, _mm_max_ps(left, right));
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        float peak = 0;
+        for (int ch = 0; ch < _channelsNum; ++ch)
+        {
+            peak = std::max(peak, std::fabs(samples[i * _channelsNum + ch]));
+        }
+        _peaks[i] = peak;
+    }
+}
+
+void Limiter::process(float* samples, int count)
+{
+    computePeaks(samples, count);
+
+    // ring index increments, without a division per sample
+    auto wrap = [this](int index) { return index >= _window ? index - _window : index; };
+
+    for (int i = 0; i < count; ++i, ++_position)
+    {
+        auto required = _peaks[i] > _threshold ? _threshold / _peaks[i] : 1.0f;
+
+        // minimum of the required gains over the window
+        while (_minCount > 0 && _minValues[wrap(_minHead + _minCount - 1)] >= required)
+        {
+            --_minCount;
+        }
+        if (_minCount > 0 && _minPositions[_minHead] <= _position - _window)
+        {
+            _minHead = wrap(_minHead + 1);
+            --_minCount;
+        }
+        auto tail           = wrap(_minHead + _minCount);
+        _minValues[tail]    = required;
+        _minPositions[tail] = _position;
+        ++_minCount;
+        auto hold = _minValues[_minHead];
+
+        // drop at once, the averaging below is the attack
+        _envelope = hold < _envelope ? hold : hold + (_envelope - hold) * _releaseCoef;
+
+        _boxSum             += _envelope - _boxRing[_ringPos];
+        _boxRing[_ringPos]   = _envelope;
+        auto gain            = std::min((float)(_boxSum / _window), 1.0f);
+        _minGain             = std::min(_minGain, gain);
+
+        // the oldest sample of the window goes out
+        auto in  = samples + (size_t)i * _channelsNum;
+        auto pos = _delay.data() + (size_t)_ringPos * _channelsNum;
+        _ringPos = wrap(_ringPos + 1);
+        auto out = _delay.data() + (size_t)_ringPos * _channelsNum;
+        for (int ch = 0; ch < _channelsNum; ++ch)
+        {
+            pos[ch] = in[ch];
+            in[ch]  = out[ch] * gain;
+        }
+    }
+}
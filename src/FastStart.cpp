@@ -0,0 +1,224 @@
+#include "FastStart.hpp"
+#include "DecoderSetup.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// input format chosen for each file extension so far
+static std::mutex                                            g_formatCacheMutex;
+static std::unordered_map<std::string, const AVInputFormat*> g_formatCache;
+
+static std::string extensionOf(const char* filename)
+{
+    std::string name = filename;
+    auto        pos  = name.find_last_of("./\\");
+    if (pos == std::string::npos || name[pos] != '.')
+    {
+        return {};
+    }
+
+    auto extension = name.substr(pos + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return (char)std::tolower(c); });
+    return extension;
+}
+
+static const AVInputFormat* cachedFormat(const std::string& extension)
+{
+    std::lock_guard lock(g_formatCacheMutex);
+    auto it = g_formatCache.find(extension);
+    return it == g_formatCache.end() ? nullptr : it->second;
+}
+
+static void cacheFormat(const std::string& extension, const AVInputFormat* format)
+{
+    std::lock_guard lock(g_formatCacheMutex);
+    g_formatCache[extension] = format;
+}
+
+void clearInputFormatCache()
+{
+    std::lock_guard lock(g_formatCacheMutex);
+    g_formatCache.clear();
+}
+
+static StreamMetadata readMetadata(AVFormatContext* fmtCtx, int streamIndex)
+{
+    StreamMetadata metadata;
+    if (fmtCtx->duration != AV_NOPTS_VALUE)
+    {
+        metadata.durationMs = (fmtCtx->duration + 500) / 1000;
+    }
+    metadata.bitRate   = fmtCtx->bit_rate;
+    metadata.startTime = fmtCtx->start_time;
+
+    // container tags first, the stream's override them
+    const AVDictionaryEntry* tag = nullptr;
+    while ((tag = av_dict_iterate(fmtCtx->metadata, tag)))
+    {
+        metadata.tags[tag->key] = tag->value;
+    }
+    while (streamIndex >= 0 && (tag = av_dict_iterate(fmtCtx->streams[streamIndex]->metadata, tag)))
+    {
+        metadata.tags[tag->key] = tag->value;
+    }
+    return metadata;
+}
+
+// the full open, on a context of its own so the playing one is never touched
+static StreamMetadata probeMetadata(const char* filename)
+{
+    AVFormatContext* fmtCtx = nullptr;
+    if (avformat_open_input(&fmtCtx, filename, nullptr, nullptr) < 0)
+    {
+        return {};
+    }
+
+    StreamMetadata metadata;
+    if (avformat_find_stream_info(fmtCtx, nullptr) >= 0)
+    {
+        metadata = readMetadata(fmtCtx, av_find_best_stream(fmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0));
+    }
+    avformat_close_input(&fmtCtx);
+    return metadata;
+}
+
+FastStartInput::~FastStartInput()
+{
+    close();
+}
+
+int FastStartInput::open(const char* filename, const FastStartOptions& options)
+{
+    close();
+
+    auto extension = extensionOf(filename);
+    auto format    = cachedFormat(extension);
+
+    AVDictionary* formatOptions = nullptr;
+    av_dict_set_int(&formatOptions, "probesize", options.probeSize, 0);
+    av_dict_set_int(&formatOptions, "analyzeduration", options.analyzeDuration, 0);
+    auto ret = avformat_open_input(&_fmtCtx, filename, format, &formatOptions);
+    av_dict_free(&formatOptions);
+
+    // The cached format may not fit this file, or the short probe
+    // may end inside a big ID3 tag, probe again in full.
+    if (ret < 0)
+    {
+        ret = avformat_open_input(&_fmtCtx, filename, nullptr, nullptr);
+    }
+    if (ret < 0)
+    {
+        return ret;
+    }
+    cacheFormat(extension, _fmtCtx->iformat);
+
+    if (!options.lazyMetadata && (ret = avformat_find_stream_info(_fmtCtx, nullptr)) < 0)
+    {
+        close();
+        return ret;
+    }
+
+    const AVCodec* decoder = nullptr;
+    if ((ret = _streamIndex = av_find_best_stream(_fmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, &decoder, 0)) < 0)
+    {
+        close();
+        return ret;
+    }
+
+    _decCtx = avcodec_alloc_context3(decoder);
+    _pkt    = av_packet_alloc();
+    if (!_decCtx || !_pkt)
+    {
+        close();
+        return AVERROR(ENOMEM);
+    }
+
+    if ((ret = avcodec_parameters_to_context(_decCtx, _fmtCtx->streams[_streamIndex]->codecpar)) < 0 ||
+        (ret = openDecoder(_decCtx, decoder)) < 0)
+    {
+        close();
+        return ret;
+    }
+
+    if (options.lazyMetadata)
+    {
+        auto promise = std::make_shared<std::promise<StreamMetadata>>();
+        _metadata    = promise->get_future().share();
+        ThreadPool::shared().submit([promise, path = std::string(filename)]
+        {
+            promise->set_value(probeMetadata(path.c_str()));
+        });
+    }
+    else
+    {
+        std::promise<StreamMetadata> promise;
+        promise.set_value(readMetadata(_fmtCtx, _streamIndex));
+        _metadata = promise.get_future().share();
+    }
+    return 0;
+}
+
+void FastStartInput::close()
+{
+    av_packet_free(&_pkt);
+    avcodec_free_context(&_decCtx);
+    avformat_close_input(&_fmtCtx);
+    _streamIndex = -1;
+    _metadata    = {}; // a running probe finishes on its own
+}
+
+int FastStartInput::receiveFrame(AVFrame* frame)
+{
+    while (true)
+    {
+        auto ret = avcodec_receive_frame(_decCtx, frame);
+        if (ret != AVERROR(EAGAIN))
+        {
+            return ret;
+        }
+
+        // once flushed the decoder never asks for more
+        ret = av_read_frame(_fmtCtx, _pkt);
+        if (ret == AVERROR_EOF)
+        {
+            if ((ret = avcodec_send_packet(_decCtx, nullptr)) < 0)
+            {
+                return ret;
+            }
+            continue;
+        }
+        if (ret < 0)
+        {
+            return ret;
+        }
+
+        if (_pkt->stream_index == _streamIndex)
+        {
+            ret = avcodec_send_packet(_decCtx, _pkt);
+        }
+        av_packet_unref(_pkt);
+
+        // skip corrupt packets like the players do
+        if (ret < 0 && ret != AVERROR_INVALIDDATA)
+        {
+            return ret;
+        }
+    }
+}
+
+bool FastStartInput::metadataReady() const
+{
+    return _metadata.valid() && _metadata.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+const StreamMetadata& FastStartInput::metadata() const
+{
+    static const StreamMetadata unknown;
+    return _metadata.valid() ? _metadata.get() : unknown;
+}
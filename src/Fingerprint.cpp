@@ -0,0 +1,358 @@
+extern "C"
+{
+#include <libavutil/channel_layout.h>
+#include <libavutil/error.h>
+}
+
+#include "Fingerprint.hpp"
+#include "FileIo.hpp"
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include <stdio.h>
+#include <string.h>
+
+constexpr int MatchBlock = 256; // frames summed between checks against the error bound
+
+//
+// Sidecar Layout
+//
+// FingerprintHeader, then uint32_t frames[framesNum].
+//
+
+constexpr char     FingerprintMagic[4] = { 'A', 'F', 'P', 'R' };
+constexpr uint32_t FingerprintVersion  = 1;
+
+struct FingerprintHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t sampleRate;
+    uint32_t hopSize;
+    uint64_t framesNum;
+};
+
+//
+// FingerprintExtractor
+//
+
+FingerprintExtractor::FingerprintExtractor(const FingerprintOptions& options) : _options(options)
+{
+    _options.sampleRate = std::max(1000, _options.sampleRate);
+    _options.fftSize    = std::max(64, _options.fftSize);
+    _options.hopSize    = std::clamp(_options.hopSize, 1, _options.fftSize);
+}
+
+FingerprintExtractor::~FingerprintExtractor()
+{
+    release();
+}
+
+void FingerprintExtractor::release()
+{
+    swr_free(&_swr);
+    _fft.release();
+}
+
+void FingerprintExtractor::begin(int sampleRate, int channelsNum)
+{
+    release();
+
+    auto fftSize = _options.fftSize;
+    _error       = 0;
+    _fingerprint = { _options.sampleRate, _options.hopSize, {} };
+
+    AVChannelLayout inLayout;
+    AVChannelLayout outLayout = AV_CHANNEL_LAYOUT_MONO;
+    av_channel_layout_default(&inLayout, channelsNum);
+    _error = swr_alloc_set_opts2(&_swr,
+                                 &outLayout, AV_SAMPLE_FMT_FLT, _options.sampleRate,
+                                 &inLayout, AV_SAMPLE_FMT_FLTP, sampleRate,
+                                 0, nullptr);
+    av_channel_layout_uninit(&inLayout);
+    if (_error < 0 || (_error = swr_init(_swr)) < 0)
+    {
+        release();
+        return;
+    }
+
+    if ((_error = _fft.init(fftSize)) < 0)
+    {
+        release();
+        return;
+    }
+
+    _window   = hannWindow(fftSize);
+    _bandBins = logBandBins(fftSize, _options.sampleRate, BandsNum, _options.minFrequency, _options.maxFrequency);
+
+    _history.assign(fftSize, 0.0f);
+    _fill = 0;
+    _previous.assign(BandsNum - 1, 0.0f);
+    _hasPrevious = false;
+}
+
+void FingerprintExtractor::process(const float* const* channels, int samples)
+{
+    if (_swr)
+    {
+        resample((const uint8_t* const*)channels, samples);
+    }
+}
+
+void FingerprintExtractor::end()
+{
+    // what the resampler still holds
+    if (_swr)
+    {
+        resample(nullptr, 0);
+    }
+    release();
+
+    std::vector<float>().swap(_resampled);
+    std::vector<float>().swap(_history);
+}
+
+void FingerprintExtractor::resample(const uint8_t* const* input, int samples)
+{
+    auto capacity = swr_get_out_samples(_swr, samples);
+    if (capacity <= 0)
+    {
+        return;
+    }
+    if (_resampled.size() < (size_t)capacity)
+    {
+        _resampled.resize(capacity);
+    }
+
+    auto out   = (uint8_t*)_resampled.data();
+    auto count = swr_convert(_swr, &out, capacity, (const uint8_t**)input, samples);
+    if (count < 0)
+    {
+        _error = count;
+        release();
+        return;
+    }
+
+    auto fftSize = _options.fftSize;
+    auto hopSize = _options.hopSize;
+    for (int offset = 0; offset < count;)
+    {
+        auto n = std::min(count - offset, fftSize - _fill);
+        memcpy(_history.data() + _fill, _resampled.data() + offset, n * sizeof(float));
+        offset += n;
+        _fill  += n;
+
+        if (_fill == fftSize)
+        {
+            analyzeWindow();
+            memmove(_history.data(), _history.data() + hopSize, (fftSize - hopSize) * sizeof(float));
+            _fill = fftSize - hopSize;
+        }
+    }
+}
+
+void FingerprintExtractor::analyzeWindow()
+{
+    auto fftSize = _options.fftSize;
+    auto input   = _fft.input();
+    for (int i = 0; i < fftSize; ++i)
+    {
+        input[i] = _history[i] * _window[i];
+    }
+    _fft.transform();
+
+    auto  output = _fft.output();
+    float energies[BandsNum];
+    for (int b = 0; b < BandsNum; ++b)
+    {
+        float energy = 0;
+        for (int bin = _bandBins[b]; bin < _bandBins[b + 1]; ++bin)
+        {
+            energy += output[bin * 2] * output[bin * 2] + output[bin * 2 + 1] * output[bin * 2 + 1];
+        }
+        energies[b] = energy;
+    }
+
+    uint32_t bits = 0;
+    for (int b = 0; b < BandsNum - 1; ++b)
+    {
+        auto difference = energies[b] - energies[b + 1];
+        bits           |= (uint32_t)(difference - _previous[b] > 0) << b;
+        _previous[b]    = difference;
+    }
+
+    // the first window only sets the differences to compare with
+    if (_hasPrevious)
+    {
+        _fingerprint.frames.push_back(bits);
+    }
+    _hasPrevious = true;
+}
+
+//
+// Sidecar
+//
+
+bool saveFingerprint(const char* filename, const Fingerprint& fingerprint)
+{
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    FingerprintHeader header = {};
+    memcpy(header.magic, FingerprintMagic, sizeof(FingerprintMagic));
+    header.version    = FingerprintVersion;
+    header.sampleRate = fingerprint.sampleRate;
+    header.hopSize    = fingerprint.hopSize;
+    header.framesNum  = fingerprint.frames.size();
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(fingerprint.frames.data(), sizeof(uint32_t), fingerprint.frames.size(), file) == fingerprint.frames.size();
+
+    return fclose(file) == 0 && ok;
+}
+
+bool loadFingerprint(const char* filename, Fingerprint& fingerprint)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    // framesNum must fit what the file holds before anything is sized by it
+    int64_t fileSize = -1;
+    if (seekFile(file, 0, SEEK_END) == 0)
+    {
+        fileSize = tellFile(file);
+    }
+
+    FingerprintHeader header;
+    bool ok = fileSize >= (int64_t)sizeof(header) && seekFile(file, 0, SEEK_SET) == 0 &&
+              fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, FingerprintMagic, sizeof(FingerprintMagic)) == 0 &&
+              header.version == FingerprintVersion &&
+              header.framesNum <= INT32_MAX &&
+              header.framesNum * sizeof(uint32_t) <= (uint64_t)fileSize - sizeof(header);
+    if (ok)
+    {
+        fingerprint.sampleRate = header.sampleRate;
+        fingerprint.hopSize    = header.hopSize;
+        fingerprint.frames.resize(header.framesNum);
+        ok = fread(fingerprint.frames.data(), sizeof(uint32_t), header.framesNum, file) == header.framesNum;
+    }
+
+    fclose(file);
+    return ok;
+}
+
+//
+// Matching
+//
+
+int64_t hammingDistance(const uint32_t* a, const uint32_t* b, int n)
+{
+    int64_t distance = 0;
+    int     i        = 0;
+
+#if defined(HAS_AVX2)
+    // nibble lookup with vpshufb, byte counts summed by vpsadbw (Mula, Kurz, Lemire)
+    const auto lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const auto nibble = _mm256_set1_epi8(0x0f);
+    auto       sum    = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8)
+    {
+        auto x      = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                       _mm256_loadu_si256((const __m256i*)(b + i)));
+        auto counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(x, nibble)),
+                                      _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble)));
+        sum         = _mm256_add_epi64(sum, _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+    }
+    distance += _mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) +
+                _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3);
+#elif defined(HAS_SSE2)
+    // SWAR bit counts per byte, summed by psadbw
+    const auto m1  = _mm_set1_epi8(0x55);
+    const auto m2  = _mm_set1_epi8(0x33);
+    const auto m4  = _mm_set1_epi8(0x0f);
+    auto       sum = _mm_setzero_si128();
+    for (; i + 4 <= n; i += 4)
+    {
+        auto x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+        x      = _mm_sub_epi8(x, _mm_and_si128(_mm_srli_epi16(x, 1), m1));
+        x      = _mm_add_epi8(_mm_and_si128(x, m2), _mm_and_si128(_mm_srli_epi16(x, 2), m2));
+        x      = _mm_and_si128(_mm_add_epi8(x, _mm_srli_epi16(x, 4)), m4);
+        sum    = _mm_add_epi64(sum, _mm_sad_epu8(x, _mm_setzero_si128()));
+    }
+    distance += _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#endif
+
+    for (; i < n; ++i)
+    {
+        distance += std::popcount(a[i] ^ b[i]);
+    }
+    return distance;
+}
+
+size_t FingerprintCatalog::add(const Fingerprint& fingerprint)
+{
+    _entries.push_back({ _frames.size(), (int)fingerprint.frames.size() });
+    _frames.insert(_frames.end(), fingerprint.frames.begin(), fingerprint.frames.end());
+    return _entries.size() - 1;
+}
+
+std::vector<FingerprintMatch> FingerprintCatalog::match(const Fingerprint& query, float maxBitErrorRate) const
+{
+    std::vector<FingerprintMatch> matches;
+
+    auto queryFrames = query.frames.data();
+    auto queryCount  = (int)query.frames.size();
+    for (size_t index = 0; index < _entries.size(); ++index)
+    {
+        auto& entry      = _entries[index];
+        auto  frames     = _frames.data() + entry.start;
+        auto  minOverlap = std::max(1, (std::min(queryCount, entry.count) + 1) / 2);
+
+        FingerprintMatch best    = { index, maxBitErrorRate, 0 };
+        bool             isFound = false;
+        for (int offset = -_maxOffsetFrames; offset <= _maxOffsetFrames; ++offset)
+        {
+            auto queryStart = std::max(0, -offset);
+            auto start      = std::max(0, offset);
+            auto overlap    = std::min(queryCount - queryStart, entry.count - start);
+            if (overlap < minOverlap)
+            {
+                continue;
+            }
+
+            // bounded by the best alignment so far
+            auto    maxErrors = (int64_t)(best.bitErrorRate * 32 * overlap);
+            int64_t errors    = 0;
+            for (int i = 0; i < overlap && errors <= maxErrors; i += MatchBlock)
+            {
+                errors += hammingDistance(queryFrames + queryStart + i, frames + start + i, std::min(MatchBlock, overlap - i));
+            }
+
+            if (errors <= maxErrors)
+            {
+                best    = { index, (float)errors / (32.0f * overlap), offset };
+                isFound = true;
+            }
+        }
+
+        if (isFound)
+        {
+            matches.push_back(best);
+        }
+    }
+
+    std::sort(matches.begin(), matches.end(),
+              [](auto& a, auto& b) { return a.bitErrorRate < b.bitErrorRate; });
+    return matches;
+}
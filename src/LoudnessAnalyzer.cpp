@@ -0,0 +1,405 @@
+extern "C"
+{
+#include <libavutil/channel_layout.h>
+}
+
+#include "LoudnessAnalyzer.hpp"
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+constexpr double AbsoluteGate      = -70.0; // LUFS
+constexpr double IntegratedGate    = -10.0; // LU below ungated loudness
+constexpr double RangeGate         = -20.0; // LU below ungated short-term loudness
+constexpr double ReplayGainTarget  = -18.0; // LUFS
+constexpr int    TruePeakTapsCount = 12;
+
+// ITU-R BS.1770-4 Annex 2 4x oversampling filter, TruePeakTaps[tap][phase]
+alignas(16) constexpr float TruePeakTaps[TruePeakTapsCount][4] =
+{
+    {  0.0017089843750f, -0.0291748046875f, -0.0189208984375f, -0.0083007812500f },
+    {  0.0109863281250f,  0.0292968750000f,  0.0330810546875f,  0.0148925781250f },
+    { -0.0196533203125f, -0.0517578125000f, -0.0582275390625f, -0.0266113281250f },
+    {  0.0332031250000f,  0.0891113281250f,  0.1015625000000f,  0.0476074218750f },
+    { -0.0594482421875f, -0.1665039062500f, -0.2003173828125f, -0.1022949218750f },
+    {  0.1373291015625f,  0.4650878906250f,  0.7797851562500f,  0.9721679687500f },
+    {  0.9721679687500f,  0.7797851562500f,  0.4650878906250f,  0.1373291015625f },
+    { -0.1022949218750f, -0.2003173828125f, -0.1665039062500f, -0.0594482421875f },
+    {  0.0476074218750f,  0.1015625000000f,  0.0891113281250f,  0.0332031250000f },
+    { -0.0266113281250f, -0.0582275390625f, -0.0517578125000f, -0.0196533203125f },
+    {  0.0148925781250f,  0.0330810546875f,  0.0292968750000f,  0.0109863281250f },
+    { -0.0083007812500f, -0.0189208984375f, -0.0291748046875f,  0.0017089843750f },
+};
+
+static double energyToLoudness(double energy)
+{
+    return -0.691 + 10 * std::log10(energy);
+}
+
+static double loudnessToEnergy(double loudness)
+{
+    return std::pow(10.0, (loudness + 0.691) / 10);
+}
+
+static double toDecibel(float amplitude)
+{
+    return 20 * std::log10(amplitude);
+}
+
+// BS.1770-4 channel weights: LFE is not measured, surrounds are weighted +1.5 dB.
+static std::vector<double> channelWeights(const AVChannelLayout& layout)
+{
+    std::vector<double> weights(layout.nb_channels, 1.0);
+    for (int ch = 0; ch < layout.nb_channels; ++ch)
+    {
+        switch (av_channel_layout_channel_from_index(&layout, ch))
+        {
+        case AV_CHAN_LOW_FREQUENCY:
+        case AV_CHAN_LOW_FREQUENCY_2:
+            weights[ch] = 0.0;
+            break;
+        case AV_CHAN_SIDE_LEFT:
+        case AV_CHAN_SIDE_RIGHT:
+        case AV_CHAN_BACK_LEFT:
+        case AV_CHAN_BACK_RIGHT:
+        case AV_CHAN_SIDE_SURROUND_LEFT:
+        case AV_CHAN_SIDE_SURROUND_RIGHT:
+            weights[ch] = 1.41;
+            break;
+        default:
+            break;
+        }
+    }
+    return weights;
+}
+
+// Run both K-weighting stages over one channel and return the sum of squares.
+static double kWeightChannel(const float* x, int samples, const auto& f, auto& s)
+{
+    double sum = 0;
+    for (int i = 0; i < samples; ++i)
+    {
+        double in    = x[i];
+        double shelf = f.shelfB0 * in + s.shelfZ1;
+        s.shelfZ1    = f.shelfB1 * in - f.shelfA1 * shelf + s.shelfZ2;
+        s.shelfZ2    = f.shelfB2 * in - f.shelfA2 * shelf;
+
+        // high pass numerator is 1, -2, 1
+        double out   = shelf + s.highPassZ1;
+        s.highPassZ1 = -2 * shelf - f.highPassA1 * out + s.highPassZ2;
+        s.highPassZ2 = shelf - f.highPassA2 * out;
+
+        sum += out * out;
+    }
+    return sum;
+}
+
+#ifdef HAS_SSE2
+// Same as kWeightChannel for two channels at once, one per double lane.
+static void kWeightChannelPair(const float* x0, const float* x1, int samples,
+                               const auto& f, auto& s0, auto& s1, double& sum0, double& sum1)
+{
+    auto b0  = _mm_set1_pd(f.shelfB0);
+    auto b1  = _mm_set1_pd(f.shelfB1);
+    auto b2  = _mm_set1_pd(f.shelfB2);
+    auto a1  = _mm_set1_pd(f.shelfA1);
+    auto a2  = _mm_set1_pd(f.shelfA2);
+    auto ha1 = _mm_set1_pd(f.highPassA1);
+    auto ha2 = _mm_set1_pd(f.highPassA2);
+    auto two = _mm_set1_pd(2.0);
+
+    auto z1  = _mm_set_pd(s1.shelfZ1, s0.shelfZ1);
+    auto z2  = _mm_set_pd(s1.shelfZ2, s0.shelfZ2);
+    auto hz1 = _mm_set_pd(s1.highPassZ1, s0.highPassZ1);
+    auto hz2 = _mm_set_pd(s1.highPassZ2, s0.highPassZ2);
+    auto sum = _mm_setzero_pd();
+
+    for (int i = 0; i < samples; ++i)
+    {
+        auto in    = _mm_set_pd(x1[i], x0[i]);
+        auto shelf = _mm_add_pd(_mm_mul_pd(b0, in), z1);
+        z1         = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1, in), _mm_mul_pd(a1, shelf)), z2);
+        z2         = _mm_sub_pd(_mm_mul_pd(b2, in), _mm_mul_pd(a2, shelf));
+
+        auto out = _mm_add_pd(shelf, hz1);
+        hz1      = _mm_sub_pd(_mm_sub_pd(hz2, _mm_mul_pd(two, shelf)), _mm_mul_pd(ha1, out));
+        hz2      = _mm_sub_pd(shelf, _mm_mul_pd(ha2, out));
+
+        sum = _mm_add_pd(sum, _mm_mul_pd(out, out));
+    }
+
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, z1);  s0.shelfZ1    = lanes[0]; s1.shelfZ1    = lanes[1];
+    _mm_store_pd(lanes, z2);  s0.shelfZ2    = lanes[0]; s1.shelfZ2    = lanes[1];
+    _mm_store_pd(lanes, hz1); s0.highPassZ1 = lanes[0]; s1.highPassZ1 = lanes[1];
+    _mm_store_pd(lanes, hz2); s0.highPassZ2 = lanes[0]; s1.highPassZ2 = lanes[1];
+    _mm_store_pd(lanes, sum); sum0 = lanes[0];          sum1 = lanes[1];
+}
+#endif
+
+static float absPeak(const float* x, int samples)
+{
+    float peak = 0;
+    int   i    = 0;
+#ifdef HAS_SSE2
+    auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    auto peak4   = _mm_setzero_ps();
+    for (; i + 4 <= samples; i += 4)
+    {
+        peak4 = _mm_max_ps(peak4, _mm_and_ps(_mm_loadu_ps(x + i), absMask));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, peak4);
+    peak = std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+#endif
+    for (; i < samples; ++i)
+    {
+        peak = std::max(peak, std::abs(x[i]));
+    }
+    return peak;
+}
+
+// Peak of the 4x oversampled signal, input holds TruePeakTapsCount - 1
+// samples of history before the samples to measure.
+static float truePeak(const float* input, int samples)
+{
+    float peak = 0;
+    input += TruePeakTapsCount - 1;
+
+#ifdef HAS_SSE2
+    // all four phases of one input sample at once
+    auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    auto peak4   = _mm_setzero_ps();
+    for (int i = 0; i < samples; ++i)
+    {
+        auto phases = _mm_setzero_ps();
+        for (int k = 0; k < TruePeakTapsCount; ++k)
+        {
+            phases = _mm_add_ps(phases, _mm_mul_ps(_mm_load_ps(TruePeakTaps[k]), _mm_set1_ps(input[i - k])));
+        }
+        peak4 = _mm_max_ps(peak4, _mm_and_ps(phases, absMask));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, peak4);
+    peak = std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+#else
+    for (int i = 0; i < samples; ++i)
+    {
+        for (int p = 0; p < 4; ++p)
+        {
+            float y = 0;
+            for (int k = 0; k < TruePeakTapsCount; ++k)
+            {
+                y += TruePeakTaps[k][p] * input[i - k];
+            }
+            peak = std::max(peak, std::abs(y));
+        }
+    }
+#endif
+
+    return peak;
+}
+
+void LoudnessAnalyzer::setChannelLayout(const AVChannelLayout& layout)
+{
+    _layoutWeights = channelWeights(layout);
+}
+
+void LoudnessAnalyzer::begin(int sampleRate, int channelsNum)
+{
+    using std::numbers::pi;
+
+    // BS.1770 pre-filter, analog prototypes bilinear transformed for sampleRate
+    double f0 = 1681.974450955533;
+    double g  = 3.999843853973347;
+    double q  = 0.7071752369554196;
+    double k  = std::tan(pi * f0 / sampleRate);
+    double vh = std::pow(10.0, g / 20);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1 + k / q + k * k;
+
+    _filter.shelfB0 = (vh + vb * k / q + k * k) / a0;
+    _filter.shelfB1 = 2 * (k * k - vh) / a0;
+    _filter.shelfB2 = (vh - vb * k / q + k * k) / a0;
+    _filter.shelfA1 = 2 * (k * k - 1) / a0;
+    _filter.shelfA2 = (1 - k / q + k * k) / a0;
+
+    // RLB high pass
+    f0 = 38.13547087602444;
+    q  = 0.5003270373238773;
+    k  = std::tan(pi * f0 / sampleRate);
+    a0 = 1 + k / q + k * k;
+
+    _filter.highPassA1 = 2 * (k * k - 1) / a0;
+    _filter.highPassA2 = (1 - k / q + k * k) / a0;
+
+    _channelsNum = channelsNum;
+    if ((int)_layoutWeights.size() == channelsNum)
+    {
+        _channelWeights = _layoutWeights;
+    }
+    else
+    {
+        AVChannelLayout layout;
+        av_channel_layout_default(&layout, channelsNum);
+        _channelWeights = channelWeights(layout);
+        av_channel_layout_uninit(&layout);
+    }
+    _layoutWeights.clear();
+
+    _states.assign(channelsNum, KState{});
+    _sumOfSquares.assign(channelsNum, 0.0);
+    _truePeakInputs.assign(channelsNum, std::vector<float>(TruePeakTapsCount - 1, 0.0f));
+
+    _subBlockSize   = sampleRate / 10;
+    _subBlockFill   = 0;
+    _subBlocksCount = 0;
+    _momentaryEnergies.clear();
+    _shortTermEnergies.clear();
+    _samplePeak = 0;
+    _truePeak   = 0;
+    _result     = {};
+}
+
+void LoudnessAnalyzer::process(const float* const* channels, int samples)
+{
+    measurePeaks(channels, samples);
+
+    // split at 100 ms sub-block boundaries
+    for (int offset = 0; offset < samples;)
+    {
+        auto count = std::min(samples - offset, _subBlockSize - _subBlockFill);
+        filterSubBlock(channels, offset, count);
+
+        offset        += count;
+        _subBlockFill += count;
+        if (_subBlockFill == _subBlockSize)
+        {
+            finishSubBlock();
+        }
+    }
+}
+
+void LoudnessAnalyzer::filterSubBlock(const float* const* channels, int offset, int samples)
+{
+    int ch = 0;
+#ifdef HAS_SSE2
+    for (; ch + 2 <= _channelsNum; ch += 2)
+    {
+        double sum0, sum1;
+        kWeightChannelPair(channels[ch] + offset, channels[ch + 1] + offset, samples,
+                           _filter, _states[ch], _states[ch + 1], sum0, sum1);
+        _sumOfSquares[ch]     += sum0;
+        _sumOfSquares[ch + 1] += sum1;
+    }
+#endif
+    for (; ch < _channelsNum; ++ch)
+    {
+        _sumOfSquares[ch] += kWeightChannel(channels[ch] + offset, samples, _filter, _states[ch]);
+    }
+}
+
+void LoudnessAnalyzer::finishSubBlock()
+{
+    double energy = 0;
+    for (int ch = 0; ch < _channelsNum; ++ch)
+    {
+        energy += _channelWeights[ch] * _sumOfSquares[ch] / _subBlockSize;
+        _sumOfSquares[ch] = 0;
+    }
+    _subBlockFill = 0;
+
+    _recentSubBlocks[_subBlocksCount % SubBlocksPerShortTerm] = energy;
+    ++_subBlocksCount;
+
+    // Blocks of 400 ms and 3 s, both hopping every 100 ms.
+    auto meanOfLast = [this](int count)
+    {
+        double sum = 0;
+        for (int i = 1; i <= count; ++i)
+        {
+            sum += _recentSubBlocks[(_subBlocksCount - i) % SubBlocksPerShortTerm];
+        }
+        return sum / count;
+    };
+
+    if (_subBlocksCount >= SubBlocksPerMomentary)
+    {
+        _momentaryEnergies.push_back(meanOfLast(SubBlocksPerMomentary));
+    }
+    if (_subBlocksCount >= SubBlocksPerShortTerm)
+    {
+        _shortTermEnergies.push_back(meanOfLast(SubBlocksPerShortTerm));
+    }
+}
+
+void LoudnessAnalyzer::measurePeaks(const float* const* channels, int samples)
+{
+    for (int ch = 0; ch < _channelsNum; ++ch)
+    {
+        _samplePeak = std::max(_samplePeak, absPeak(channels[ch], samples));
+
+        auto& input = _truePeakInputs[ch];
+        input.insert(input.end(), channels[ch], channels[ch] + samples);
+        _truePeak = std::max(_truePeak, truePeak(input.data(), samples));
+
+        // keep history for the next call
+        input.erase(input.begin(), input.end() - (TruePeakTapsCount - 1));
+    }
+}
+
+void LoudnessAnalyzer::end()
+{
+    auto absoluteGate = loudnessToEnergy(AbsoluteGate);
+
+    // Mean energy of the blocks above gate.
+    auto gatedMean = [](const std::vector<double>& energies, double gate)
+    {
+        double sum   = 0;
+        size_t count = 0;
+        for (auto energy : energies)
+        {
+            if (energy > gate)
+            {
+                sum += energy;
+                ++count;
+            }
+        }
+        return count ? sum / count : 0.0;
+    };
+
+    // integrated loudness, absolute then relative gating
+    auto ungated  = gatedMean(_momentaryEnergies, absoluteGate);
+    auto relative = std::max(absoluteGate, ungated * std::pow(10.0, IntegratedGate / 10));
+    auto gated    = gatedMean(_momentaryEnergies, relative);
+    _result.integrated = gated > 0 ? energyToLoudness(gated) : -INFINITY;
+
+    // loudness range, 10th to 95th percentile of gated short-term loudness
+    ungated  = gatedMean(_shortTermEnergies, absoluteGate);
+    relative = std::max(absoluteGate, ungated * std::pow(10.0, RangeGate / 10));
+
+    std::vector<double> loudness;
+    for (auto energy : _shortTermEnergies)
+    {
+        if (energy > relative)
+        {
+            loudness.push_back(energyToLoudness(energy));
+        }
+    }
+    if (loudness.empty())
+    {
+        _result.range = 0;
+    }
+    else
+    {
+        std::sort(loudness.begin(), loudness.end());
+        auto last     = loudness.size() - 1;
+        _result.range = loudness[(size_t)std::lround(last * 0.95)] - loudness[(size_t)std::lround(last * 0.10)];
+    }
+
+    _result.samplePeak = toDecibel(_samplePeak);
+    _result.truePeak   = toDecibel(std::max(_truePeak, _samplePeak));
+    _result.replayGain = ReplayGainTarget - _result.integrated;
+}
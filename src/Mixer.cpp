@@ -0,0 +1,162 @@
+extern "C"
+{
+#include <libavutil/error.h>
+}
+
+#include "Mixer.hpp"
+#include "PcmKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include <string.h>
+
+//
+// StreamDecoderSource
+//
+
+int StreamDecoderSource::read(float* out, int samples)
+{
+    auto ret = _decoder.fill((uint8_t*)out, samples * _decoder.blockAlign());
+    return ret < 0 ? ret : ret / _decoder.blockAlign();
+}
+
+//
+// Mixer
+//
+
+Mixer::Mixer(int sampleRate, int blockSamples)
+    : _sampleRate(sampleRate)
+    , _blockSamples(blockSamples)
+    , _scratch((size_t)blockSamples * 2)
+{
+}
+
+int Mixer::add(MixerSource* source, float gain, float pan)
+{
+    if (!source || source->sampleRate() != _sampleRate ||
+        (source->channelsNum() != 1 && source->channelsNum() != 2))
+    {
+        return AVERROR(EINVAL);
+    }
+
+    auto slot = std::find_if(_streams.begin(), _streams.end(), [](const Stream& s) { return !s.source; });
+    if (slot == _streams.end())
+    {
+        if (_streams.size() == (1u << SlotBits))
+        {
+            return AVERROR(EINVAL);
+        }
+        slot = _streams.emplace(_streams.end());
+    }
+
+    slot->source     = source;
+    slot->generation = (slot->generation + 1) & GenerationMask;
+    slot->gain       = gain;
+    slot->pan        = std::clamp(pan, -1.0f, 1.0f);
+    updateGains(*slot);
+    ++_streamsNum;
+    return slot->generation << SlotBits | (int)(slot - _streams.begin());
+}
+
+bool Mixer::remove(int stream)
+{
+    auto found = find(stream);
+    if (!found)
+    {
+        return false;
+    }
+    removeSlot(*found);
+    return true;
+}
+
+bool Mixer::setGain(int stream, float gain)
+{
+    auto found = find(stream);
+    if (!found)
+    {
+        return false;
+    }
+    found->gain = gain;
+    updateGains(*found);
+    return true;
+}
+
+bool Mixer::setPan(int stream, float pan)
+{
+    auto found = find(stream);
+    if (!found)
+    {
+        return false;
+    }
+    found->pan = std::clamp(pan, -1.0f, 1.0f);
+    updateGains(*found);
+    return true;
+}
+
+Mixer::Stream* Mixer::find(int stream)
+{
+    auto slot = (size_t)(stream & ((1 << SlotBits) - 1));
+    if (stream < 0 || slot >= _streams.size())
+    {
+        return nullptr;
+    }
+
+    auto& found = _streams[slot];
+    return found.source && found.generation == stream >> SlotBits ? &found : nullptr;
+}
+
+void Mixer::removeSlot(Stream& stream)
+{
+    stream.source = nullptr;
+    --_streamsNum;
+}
+
+void Mixer::updateGains(Stream& stream)
+{
+    if (stream.source->channelsNum() == 1)
+    {
+        // -3 dB per side at the center
+        auto angle       = (stream.pan + 1.0f) * std::numbers::pi_v<float> / 4;
+        stream.gainLeft  = stream.gain * std::cos(angle);
+        stream.gainRight = stream.gain * std::sin(angle);
+    }
+    else
+    {
+        stream.gainLeft  = stream.gain * std::min(1.0f, 1.0f - stream.pan);
+        stream.gainRight = stream.gain * std::min(1.0f, 1.0f + stream.pan);
+    }
+}
+
+int Mixer::mix(float* out)
+{
+    memset(out, 0, (size_t)_blockSamples * 2 * sizeof(float));
+
+    for (auto& stream : _streams)
+    {
+        if (!stream.source)
+        {
+            continue;
+        }
+
+        int filled = 0;
+        while (filled < _blockSamples)
+        {
+            auto ret = stream.source->read(_scratch.data() + filled * stream.source->channelsNum(),
+                                           _blockSamples - filled);
+            if (ret <= 0)
+            {
+                break;
+            }
+            filled += ret;
+        }
+
+        mixStereo(_scratch.data(), stream.source->channelsNum(), filled, stream.gainLeft, stream.gainRight, out);
+        if (filled < _blockSamples)
+        {
+            removeSlot(stream);
+        }
+    }
+    return _streamsNum;
+}
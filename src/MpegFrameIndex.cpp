@@ -0,0 +1,173 @@
+#include "MpegFrameIndex.hpp"
+#include "FileIo.hpp"
+
+#include <algorithm>
+
+#include <string.h>
+
+constexpr size_t ChunkSize = 1 << 16;
+
+// Layer III frames take main data from up to MaxReservoirBytes before their
+// header (the bit reservoir), and the output of a granule overlaps with the
+// previous one. So a frame needs OverlapFrames decoded whole before it, and
+// those need enough frames before them to fill the reservoir.
+constexpr size_t OverlapFrames     = 2;   // MPEG-2 has one granule per frame
+constexpr int    MaxReservoirBytes = 511; // 9 bits main_data_begin of MPEG-1
+constexpr int    MaxFrameOverhead  = 38;  // header, crc and MPEG-1 stereo side info
+
+// kbps by [MPEG-1, MPEG-2/2.5][layer - 1][bitrate index]
+static const int Bitrates[2][3][15] =
+{
+    {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+        { 0, 32, 48, 56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 384 },
+        { 0, 32, 40, 48,  56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320 },
+    },
+    {
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+        { 0,  8, 16, 24, 32, 40, 48,  56,  64,  80,  96, 112, 128, 144, 160 },
+        { 0,  8, 16, 24, 32, 40, 48,  56,  64,  80,  96, 112, 128, 144, 160 },
+    },
+};
+
+static const int SampleRates[3] = { 44100, 48000, 32000 }; // MPEG-1
+
+bool parseMpegFrameHeader(const uint8_t* p, MpegFrameHeader& header)
+{
+    if (p[0] != 0xff || (p[1] & 0xe0) != 0xe0)
+    {
+        return false;
+    }
+
+    auto version      = (p[1] >> 3) & 3; // 0: MPEG-2.5, 1: reserved, 2: MPEG-2, 3: MPEG-1
+    auto layerBits    = (p[1] >> 1) & 3; // 0: reserved, 1: III, 2: II, 3: I
+    auto bitrateIndex = p[2] >> 4;
+    auto rateIndex    = (p[2] >> 2) & 3;
+    auto padding      = (p[2] >> 1) & 1;
+    auto channelMode  = p[3] >> 6;
+    if (version == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3)
+    {
+        return false;
+    }
+
+    auto isMpeg1 = version == 3;
+    auto layer   = 4 - layerBits;
+    auto bitrate = Bitrates[isMpeg1 ? 0 : 1][layer - 1][bitrateIndex] * 1000;
+    auto rate    = SampleRates[rateIndex] >> (isMpeg1 ? 0 : version == 2 ? 1 : 2);
+
+    header.layer       = layer;
+    header.sampleRate  = rate;
+    header.channelsNum = channelMode == 3 ? 1 : 2;
+    switch (layer)
+    {
+    case 1:
+        header.frameSize  = (12 * bitrate / rate + padding) * 4;
+        header.samplesNum = 384;
+        break;
+    case 2:
+        header.frameSize  = 144 * bitrate / rate + padding;
+        header.samplesNum = 1152;
+        break;
+    default:
+        header.frameSize  = (isMpeg1 ? 144 : 72) * bitrate / rate + padding;
+        header.samplesNum = isMpeg1 ? 1152 : 576;
+        break;
+    }
+    return true;
+}
+
+static bool isSameStream(const MpegFrameHeader& a, const MpegFrameHeader& b)
+{
+    return a.layer == b.layer && a.sampleRate == b.sampleRate && a.channelsNum == b.channelsNum;
+}
+
+bool MpegFrameIndex::build(FILE* file, int64_t dataStart)
+{
+    _frames.clear();
+    _header     = {};
+    _samplesNum = 0;
+
+    seekFile(file, 0, SEEK_END);
+    int64_t fileSize = tellFile(file);
+
+    std::vector<uint8_t> chunk(ChunkSize);
+    int64_t              chunkStart = 0;
+    int64_t              chunkSize  = 0;
+
+    // the 4 bytes at pos, nullptr near the end of file
+    auto bytesAt = [&](int64_t pos) -> const uint8_t*
+    {
+        if (pos < chunkStart || pos + 4 > chunkStart + chunkSize)
+        {
+            seekFile(file, pos, SEEK_SET);
+            chunkStart = pos;
+            chunkSize  = (int64_t)fread(chunk.data(), 1, chunk.size(), file);
+            if (chunkSize < 4)
+            {
+                return nullptr;
+            }
+        }
+        return chunk.data() + (pos - chunkStart);
+    };
+
+    MpegFrameHeader header, next;
+    for (auto pos = dataStart; auto p = bytesAt(pos);)
+    {
+        if (!parseMpegFrameHeader(p, header) || (!_frames.empty() && !isSameStream(header, _header)))
+        {
+            ++pos;
+            continue;
+        }
+
+        // a lone header is a sync pattern inside frame data,
+        // unless the frame ends the file or an ID3v1 tag follows it
+        auto endPos = pos + header.frameSize;
+        auto q      = bytesAt(endPos);
+        auto isLast = q ? memcmp(q, "TAG", 3) == 0 : endPos <= fileSize;
+        if (!isLast && !(q && parseMpegFrameHeader(q, next) && isSameStream(next, header)))
+        {
+            ++pos;
+            continue;
+        }
+
+        if (_frames.empty())
+        {
+            _header = header;
+        }
+        _frames.push_back({ pos, _samplesNum, header.frameSize });
+        _samplesNum += header.samplesNum;
+        pos = endPos;
+    }
+
+    return !_frames.empty();
+}
+
+size_t MpegFrameIndex::frameOf(int64_t sample) const
+{
+    if (sample >= _samplesNum)
+    {
+        return _frames.size();
+    }
+
+    auto it = std::upper_bound(_frames.begin(), _frames.end(), sample,
+                               [](int64_t s, const Frame& frame) { return s < frame.firstSample; });
+    return it - _frames.begin() - 1;
+}
+
+size_t MpegFrameIndex::preRollStart(size_t frame) const
+{
+    frame      = std::min(frame, _frames.size());
+    auto start = frame > OverlapFrames ? frame - OverlapFrames : 0;
+    if (_header.layer != 3)
+    {
+        return start;
+    }
+
+    int reservoirBytes = 0;
+    while (start > 0 && reservoirBytes < MaxReservoirBytes)
+    {
+        --start;
+        reservoirBytes += _frames[start].size - MaxFrameOverhead;
+    }
+    return start;
+}
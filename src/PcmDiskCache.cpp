@@ -0,0 +1,354 @@
+extern "C"
+{
+#include <libavutil/file.h>
+}
+
+#include "PcmDiskCache.hpp"
+#include "Xxh64.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+constexpr uint16_t WavFormatPcm   = 1;
+constexpr uint16_t WavFormatFloat = 3;
+
+template <typename T>
+static T get(const uint8_t* p)
+{
+    T value;
+    memcpy(&value, p, sizeof(T)); // wav is little endian, so is every target
+    return value;
+}
+
+struct WavInfo
+{
+    uint16_t formatTag;
+    uint16_t channelsNum;
+    uint32_t sampleRate;
+    uint16_t bitsPerSample;
+    size_t   dataOffset;
+    uint64_t dataSize;
+};
+
+// Walk the chunks of a RIFF or RF64 wav up to the data chunk.
+static bool parseWav(const uint8_t* p, size_t size, WavInfo& info)
+{
+    if (size < 12 || (memcmp(p, "RIFF", 4) != 0 && memcmp(p, "RF64", 4) != 0) || memcmp(p + 8, "WAVE", 4) != 0)
+    {
+        return false;
+    }
+
+    uint64_t ds64DataSize = 0;
+    bool     hasFormat    = false;
+    for (size_t pos = 12; pos + 8 <= size;)
+    {
+        auto id        = p + pos;
+        auto chunkSize = (uint64_t)get<uint32_t>(p + pos + 4);
+        auto body      = p + pos + 8;
+
+        if (memcmp(id, "data", 4) == 0)
+        {
+            info.dataOffset = pos + 8;
+            info.dataSize   = chunkSize == UINT32_MAX ? ds64DataSize : chunkSize;
+            return hasFormat && info.dataOffset + info.dataSize <= size;
+        }
+        if (pos + 8 + chunkSize > size)
+        {
+            return false;
+        }
+
+        if (memcmp(id, "ds64", 4) == 0 && chunkSize >= 24)
+        {
+            ds64DataSize = get<uint64_t>(body + 8);
+        }
+        else if (memcmp(id, "fmt ", 4) == 0 && chunkSize >= 16)
+        {
+            info.formatTag     = get<uint16_t>(body);
+            info.channelsNum   = get<uint16_t>(body + 2);
+            info.sampleRate    = get<uint32_t>(body + 4);
+            info.bitsPerSample = get<uint16_t>(body + 14);
+            hasFormat          = true;
+        }
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    return false;
+}
+
+//
+// CachedPcm
+//
+
+CachedPcm::~CachedPcm()
+{
+    close();
+}
+
+bool CachedPcm::open(const char* filename)
+{
+    close();
+
+    if (av_file_map(filename, &_fileBuffer, &_fileSize, 0, nullptr) < 0)
+    {
+        _fileBuffer = nullptr;
+        return false;
+    }
+
+    WavInfo info;
+    if (!parseWav(_fileBuffer, _fileSize, info) || info.channelsNum == 0)
+    {
+        close();
+        return false;
+    }
+
+    if (info.formatTag == WavFormatPcm && info.bitsPerSample == 16)
+    {
+        _format = PcmSampleFormat::Int16;
+    }
+    else if (info.formatTag == WavFormatFloat && info.bitsPerSample == 32)
+    {
+        _format = PcmSampleFormat::Float32;
+    }
+    else
+    {
+        close();
+        return false;
+    }
+
+    _data        = _fileBuffer + info.dataOffset;
+    _sampleRate  = info.sampleRate;
+    _channelsNum = info.channelsNum;
+    _samplesNum  = info.dataSize / (info.channelsNum * info.bitsPerSample / 8);
+    return true;
+}
+
+void CachedPcm::close()
+{
+    if (_fileBuffer)
+    {
+        av_file_unmap(_fileBuffer, _fileSize);
+        _fileBuffer = nullptr;
+        _fileSize   = 0;
+    }
+    _data       = nullptr;
+    _samplesNum = 0;
+}
+
+int64_t CachedPcm::readFloat(int64_t start, int64_t count, float* out) const
+{
+    start = std::clamp<int64_t>(start, 0, _samplesNum);
+    count = std::clamp<int64_t>(count, 0, _samplesNum - start);
+
+    auto valuesNum = (size_t)count * _channelsNum;
+    if (_format == PcmSampleFormat::Float32)
+    {
+        // wav files of other writers don't always align the data chunk
+        memcpy(out, _data + (size_t)start * _channelsNum * sizeof(float), valuesNum * sizeof(float));
+    }
+    else
+    {
+        auto in = (const int16_t*)_data + (size_t)start * _channelsNum;
+        for (size_t i = 0; i < valuesNum; ++i)
+        {
+            out[i] = in[i] * (1.0f / 32767); // interleaveS16 scales by 32767
+        }
+    }
+    return count;
+}
+
+//
+// PcmCacheWriter
+//
+
+class PcmCacheWriter : public FrameTap
+{
+public:
+    PcmCacheWriter(PcmDiskCache& cache, std::string entry)
+        : _cache(cache)
+        , _entry(std::move(entry))
+        , _tempPath(cache.tempPath(_entry))
+        , _writer(std::make_unique<PcmFileWriter>(_tempPath, PcmContainer::Wav, cache._format))
+    {
+    }
+
+    ~PcmCacheWriter()
+    {
+        // neither end() nor abort() was reached
+        if (_writer)
+        {
+            _writer.reset();
+            std::error_code ec;
+            std::filesystem::remove(_tempPath, ec);
+        }
+    }
+
+    void begin(int sampleRate, int channelsNum) override { _writer->begin(sampleRate, channelsNum); }
+    void process(const float* const* channels, int samples) override { _writer->process(channels, samples); }
+
+    void end() override { finish(true); }
+    void abort() override { finish(false); }
+
+private:
+    // only a whole track becomes an entry
+    void finish(bool isComplete)
+    {
+        _writer->end();
+        auto ok = isComplete && _writer->ok();
+        _writer.reset();
+
+        if (ok)
+        {
+            _cache.commit(_tempPath, _entry);
+        }
+        else
+        {
+            std::error_code ec;
+            std::filesystem::remove(_tempPath, ec);
+        }
+    }
+
+    PcmDiskCache&                  _cache;
+    std::string                    _entry;
+    std::string                    _tempPath;
+    std::unique_ptr<PcmFileWriter> _writer;
+};
+
+//
+// PcmDiskCache
+//
+
+PcmDiskCache::PcmDiskCache(std::string dir, uint64_t maxBytes, PcmSampleFormat format)
+    : _dir(std::move(dir))
+    , _maxBytes(maxBytes)
+    , _format(format)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(_dir, ec);
+}
+
+std::string PcmDiskCache::entryPath(const char* filename) const
+{
+    std::error_code ec;
+    auto path = std::filesystem::absolute(filename, ec);
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+    {
+        return {};
+    }
+    auto time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+    {
+        return {};
+    }
+
+    // a changed file gets a new entry, the old one ages out
+    auto    identity = path.string();
+    int64_t ticks    = time.time_since_epoch().count();
+    Xxh64   hash;
+    hash.update(identity.data(), identity.size());
+    hash.update(&size, sizeof(size));
+    hash.update(&ticks, sizeof(ticks));
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.wav", (unsigned long long)hash.digest());
+    return (std::filesystem::path(_dir) / name).string();
+}
+
+std::string PcmDiskCache::tempPath(const std::string& entry)
+{
+    // concurrent decodes of the same file must not share a temporary
+    return entry + "." + std::to_string(_tempCount++) + ".tmp";
+}
+
+bool PcmDiskCache::open(const char* filename, CachedPcm& pcm)
+{
+    auto entry = entryPath(filename);
+    if (entry.empty() || !pcm.open(entry.c_str()))
+    {
+        ++_misses;
+        return false;
+    }
+
+    // the modification time of an entry is its last use, for evict()
+    std::error_code ec;
+    std::filesystem::last_write_time(entry, std::filesystem::file_time_type::clock::now(), ec);
+    ++_hits;
+    return true;
+}
+
+std::unique_ptr<FrameTap> PcmDiskCache::writer(const char* filename)
+{
+    auto entry = entryPath(filename);
+    if (entry.empty())
+    {
+        return nullptr;
+    }
+    return std::make_unique<PcmCacheWriter>(*this, std::move(entry));
+}
+
+void PcmDiskCache::commit(const std::string& tempPath, const std::string& entry)
+{
+    std::error_code ec;
+    std::filesystem::rename(tempPath, entry, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tempPath, ec);
+        return;
+    }
+    ++_stores;
+    evict();
+}
+
+void PcmDiskCache::evict()
+{
+    struct Entry
+    {
+        std::filesystem::path           path;
+        uint64_t                        size;
+        std::filesystem::file_time_type lastUse;
+    };
+
+    std::lock_guard lock(_evictMutex);
+
+    std::vector<Entry> entries;
+    uint64_t           totalSize = 0;
+    std::error_code    ec;
+    for (auto& file : std::filesystem::directory_iterator(_dir, ec))
+    {
+        if (file.path().extension() != ".wav")
+        {
+            continue;
+        }
+        auto size    = file.file_size(ec);
+        auto lastUse = file.last_write_time(ec);
+        if (!ec)
+        {
+            entries.push_back({ file.path(), size, lastUse });
+            totalSize += size;
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+    for (auto& entry : entries)
+    {
+        if (totalSize <= _maxBytes)
+        {
+            break;
+        }
+        if (std::filesystem::remove(entry.path, ec))
+        {
+            totalSize -= entry.size;
+            ++_evictions;
+        }
+    }
+}
+
+PcmCacheCounters PcmDiskCache::counters() const
+{
+    return { _hits, _misses, _stores, _evictions };
+}
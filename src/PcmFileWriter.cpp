@@ -0,0 +1,262 @@
+#include "PcmFileWriter.hpp"
+#include "PcmKernels.hpp"
+
+#include <algorithm>
+#include <new>
+
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+constexpr size_t BlockSize      = 4 << 20;
+constexpr size_t BlockAlignment = 4096; // what O_DIRECT asks for
+constexpr size_t MaxFrameBytes  = 64 * sizeof(float);
+constexpr size_t MaxWavHeader   = 128;
+
+constexpr uint16_t WavFormatPcm   = 1;
+constexpr uint16_t WavFormatFloat = 3;
+
+static uint8_t* put(uint8_t* p, const char (&tag)[5])
+{
+    memcpy(p, tag, 4);
+    return p + 4;
+}
+
+template <typename T>
+static uint8_t* put(uint8_t* p, T value)
+{
+    memcpy(p, &value, sizeof(T)); // wav is little endian, so is every target
+    return p + sizeof(T);
+}
+
+// RIFF header with a 28 byte JUNK chunk, which becomes the ds64 chunk
+// of RF64 when the sizes don't fit 32 bits. The 18 byte fmt chunk of float
+// is followed by a 2 byte JUNK chunk, so samples start 4 byte aligned.
+// Return header size.
+static size_t buildWavHeader(uint8_t* out, int sampleRate, int channelsNum, PcmSampleFormat format, uint64_t dataSize)
+{
+    auto isFloat       = format == PcmSampleFormat::Float32;
+    auto bitsPerSample = (uint16_t)(isFloat ? 32 : 16);
+    auto blockAlign    = (uint16_t)(channelsNum * bitsPerSample / 8);
+    auto fmtSize       = (uint32_t)(isFloat ? 18 : 16); // non PCM formats carry cbSize
+    auto padSize       = (uint32_t)(isFloat ? 2 : 0);
+    auto headerSize    = 12 + (8 + 28) + (8 + fmtSize) + (padSize ? 8 + padSize : 0) + 8;
+    auto riffSize      = headerSize - 8 + dataSize;
+    auto isRf64        = riffSize > UINT32_MAX;
+
+    auto p = out;
+    p = put(p, isRf64 ? "RF64" : "RIFF");
+    p = put(p, (uint32_t)(isRf64 ? UINT32_MAX : riffSize));
+    p = put(p, "WAVE");
+
+    p = put(p, isRf64 ? "ds64" : "JUNK");
+    p = put(p, (uint32_t)28);
+    p = put(p, (uint64_t)(isRf64 ? riffSize : 0));
+    p = put(p, (uint64_t)(isRf64 ? dataSize : 0));
+    p = put(p, (uint64_t)(isRf64 ? dataSize / blockAlign : 0));
+    p = put(p, (uint32_t)0); // table length
+
+    p = put(p, "fmt ");
+    p = put(p, fmtSize);
+    p = put(p, isFloat ? WavFormatFloat : WavFormatPcm);
+    p = put(p, (uint16_t)channelsNum);
+    p = put(p, (uint32_t)sampleRate);
+    p = put(p, (uint32_t)(sampleRate * blockAlign));
+    p = put(p, blockAlign);
+    p = put(p, bitsPerSample);
+    if (isFloat)
+    {
+        p = put(p, (uint16_t)0);
+    }
+
+    if (padSize)
+    {
+        p = put(p, "JUNK");
+        p = put(p, padSize);
+        p = put(p, (uint16_t)0);
+    }
+
+    p = put(p, "data");
+    p = put(p, (uint32_t)(isRf64 ? UINT32_MAX : dataSize));
+
+    return p - out;
+}
+
+PcmFileWriter::PcmFileWriter(std::string filename, PcmContainer container, PcmSampleFormat format, bool directIo)
+    : _filename(std::move(filename))
+    , _container(container)
+    , _format(format)
+    , _directIo(directIo)
+{
+}
+
+PcmFileWriter::~PcmFileWriter()
+{
+    closeFile();
+    if (_buffer)
+    {
+        operator delete(_buffer, std::align_val_t(BlockAlignment));
+    }
+}
+
+bool PcmFileWriter::openFile()
+{
+#ifdef __linux__
+    auto flags = O_WRONLY | O_CREAT | O_TRUNC;
+    _fd = _directIo ? open(_filename.c_str(), flags | O_DIRECT, 0644) : -1;
+    // not every file system supports O_DIRECT
+    if (_fd < 0)
+    {
+        _fd = open(_filename.c_str(), flags, 0644);
+    }
+    return _fd >= 0;
+#else
+    _file = fopen(_filename.c_str(), "wb");
+    // blocks are already large, skip the stdio copy
+    return _file && setvbuf(_file, nullptr, _IONBF, 0) == 0;
+#endif
+}
+
+bool PcmFileWriter::writeBlock(const uint8_t* data, size_t size)
+{
+#ifdef __linux__
+    while (size > 0)
+    {
+        auto len = write(_fd, data, size);
+        if (len < 0)
+        {
+            return false;
+        }
+        data += len;
+        size -= len;
+    }
+    return true;
+#else
+    return fwrite(data, 1, size, _file) == size;
+#endif
+}
+
+bool PcmFileWriter::writeHeader()
+{
+    uint8_t header[MaxWavHeader];
+    auto    size = buildWavHeader(header, _sampleRate, _channelsNum, _format, _fileSize - _headerSize);
+
+#ifdef __linux__
+    // unaligned, so not through O_DIRECT
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) & ~O_DIRECT);
+    return pwrite(_fd, header, size, 0) == (ssize_t)size;
+#else
+    return fseek(_file, 0, SEEK_SET) == 0 && fwrite(header, 1, size, _file) == size;
+#endif
+}
+
+void PcmFileWriter::closeFile()
+{
+#ifdef __linux__
+    if (_fd >= 0)
+    {
+        _ok = close(_fd) == 0 && _ok;
+        _fd = -1;
+    }
+#else
+    if (_file)
+    {
+        _ok   = fclose(_file) == 0 && _ok;
+        _file = nullptr;
+    }
+#endif
+}
+
+void PcmFileWriter::begin(int sampleRate, int channelsNum)
+{
+    _sampleRate  = sampleRate;
+    _channelsNum = channelsNum;
+    _frameBytes  = channelsNum * (_format == PcmSampleFormat::Float32 ? sizeof(float) : sizeof(int16_t));
+    _fileSize    = 0;
+
+    _ok = channelsNum > 0 && (size_t)_frameBytes <= MaxFrameBytes && openFile();
+    if (!_ok)
+    {
+        return;
+    }
+
+    // a frame may spill past the block, it moves to the next one
+    if (!_buffer)
+    {
+        _buffer = (uint8_t*)operator new(BlockSize + MaxFrameBytes, std::align_val_t(BlockAlignment));
+    }
+
+    // reserve the header in the first block, patched in end()
+    _headerSize = _container == PcmContainer::Wav
+                ? buildWavHeader(_buffer, sampleRate, channelsNum, _format, 0)
+                : 0;
+    _bufferFill = _headerSize;
+}
+
+void PcmFileWriter::process(const float* const* channels, int samples)
+{
+    if (!_ok)
+    {
+        return;
+    }
+
+    for (int offset = 0; offset < samples;)
+    {
+        // whole frames up to the end of the block, at least one
+        auto space = (BlockSize - _bufferFill + _frameBytes - 1) / _frameBytes;
+        auto count = (int)std::min<size_t>(samples - offset, space);
+
+        auto out = _buffer + _bufferFill;
+        if (_format == PcmSampleFormat::Float32)
+        {
+            interleaveFloat(channels, _channelsNum, offset, count, (float*)out);
+        }
+        else
+        {
+            interleaveS16(channels, _channelsNum, offset, count, (int16_t*)out);
+        }
+        offset      += count;
+        _bufferFill += (size_t)count * _frameBytes;
+
+        if (_bufferFill >= BlockSize)
+        {
+            _ok = writeBlock(_buffer, BlockSize);
+            if (!_ok)
+            {
+                return;
+            }
+            _fileSize += BlockSize;
+
+            _bufferFill -= BlockSize;
+            memcpy(_buffer, _buffer + BlockSize, _bufferFill);
+        }
+    }
+}
+
+void PcmFileWriter::end()
+{
+    if (!_ok)
+    {
+        closeFile();
+        return;
+    }
+
+#ifdef __linux__
+    // the tail is not a whole aligned block
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) & ~O_DIRECT);
+#endif
+
+    _ok = writeBlock(_buffer, _bufferFill);
+    _fileSize  += _bufferFill;
+    _bufferFill = 0;
+
+    if (_ok && _container == PcmContainer::Wav)
+    {
+        _ok = writeHeader();
+    }
+
+    closeFile();
+}
@@ -0,0 +1,60 @@
+#include "PcmHash.hpp"
+#include "PcmKernels.hpp"
+
+#include <algorithm>
+
+void PcmHasher::begin(int sampleRate, int channelsNum)
+{
+    _channelsNum   = channelsNum;
+    _windowSamples = (int64_t)sampleRate * _windowSeconds;
+    _windowFill    = 0;
+
+    _hash               = {};
+    _hash.windowSeconds = _windowSeconds;
+
+    // the format is part of the identity
+    int32_t format[] = { sampleRate, channelsNum };
+    _trackState.reset();
+    _trackState.update(format, sizeof(format));
+    _windowState.reset();
+}
+
+void PcmHasher::process(const float* const* channels, int samples)
+{
+    // split at window boundaries
+    auto hasWindows = _windowSamples > 0;
+    for (int offset = 0; offset < samples;)
+    {
+        auto count = hasWindows ? (int)std::min<int64_t>(samples - offset, _windowSamples - _windowFill)
+                                : samples - offset;
+        _quantized.resize((size_t)count * _channelsNum);
+        interleaveS16(channels, _channelsNum, offset, count, _quantized.data());
+
+        auto bytes = _quantized.size() * sizeof(int16_t);
+        _trackState.update(_quantized.data(), bytes);
+        offset += count;
+        if (!hasWindows)
+        {
+            continue;
+        }
+
+        _windowState.update(_quantized.data(), bytes);
+        _windowFill += count;
+        if (_windowFill == _windowSamples)
+        {
+            _hash.windows.push_back(_windowState.digest());
+            _windowState.reset();
+            _windowFill = 0;
+        }
+    }
+}
+
+void PcmHasher::end()
+{
+    if (_windowFill > 0)
+    {
+        _hash.windows.push_back(_windowState.digest());
+        _windowFill = 0;
+    }
+    _hash.track = _trackState.digest();
+}
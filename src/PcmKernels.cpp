@@ -0,0 +1,318 @@
+#include "PcmKernels.hpp"
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+constexpr float S16Scale         = 32767.0f;
+constexpr int   MatrixMaxOutputs = 8; // 7.1
+
+void interleaveFloat(const float* const* channels, int channelsNum, int offset, int samples, float* out)
+{
+    int i = 0;
+
+#ifdef HAS_SSE2
+    if (channelsNum == 2)
+    {
+        auto left  = channels[0] + offset;
+        auto right = channels[1] + offset;
+        for (; i + 4 <= samples; i += 4)
+        {
+            auto l = _mm_loadu_ps(left + i);
+            auto r = _mm_loadu_ps(right + i);
+            _mm_storeu_ps(out + i * 2,     _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+        }
+    }
+#endif
+
+    for (int ch = 0; ch < channelsNum; ++ch)
+    {
+        auto in = channels[ch] + offset;
+        for (int j = i; j < samples; ++j)
+        {
+            out[j * channelsNum + ch] = in[j];
+        }
+    }
+}
+
+void interleaveS16(const float* const* channels, int channelsNum, int offset, int samples, int16_t* out)
+{
+    int i = 0;
+
+#ifdef HAS_SSE2
+    if (channelsNum == 2)
+    {
+        auto left  = channels[0] + offset;
+        auto right = channels[1] + offset;
+        auto scale = _mm_set1_ps(S16Scale);
+        auto lo    = _mm_set1_ps(-1.0f);
+        auto hi    = _mm_set1_ps(1.0f);
+        for (; i + 4 <= samples; i += 4)
+        {
+            auto l = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(left + i), lo), hi), scale));
+            auto r = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(right + i), lo), hi), scale));
+            _mm_storeu_si128((__m128i*)(out + i * 2),
+                             _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r)));
+        }
+    }
+#endif
+
+    for (int ch = 0; ch < channelsNum; ++ch)
+    {
+        auto in = channels[ch] + offset;
+        for (int j = i; j < samples; ++j)
+        {
+            out[j * channelsNum + ch] = (int16_t)std::lrint(std::clamp(in[j], -1.0f, 1.0f) * S16Scale);
+        }
+    }
+}
+
+void mixStereo(const float* in, int inChannelsNum, int samples, float gainLeft, float gainRight, float* out)
+{
+    int i = 0;
+
+    if (inChannelsNum == 2)
+    {
+#if defined(HAS_AVX2)
+        auto gains = _mm256_setr_ps(gainLeft, gainRight, gainLeft, gainRight, gainLeft, gainRight, gainLeft, gainRight);
+        for (; i + 4 <= samples; i += 4)
+        {
+            auto sum = _mm256_add_ps(_mm256_loadu_ps(out + i * 2), _mm256_mul_ps(_mm256_loadu_ps(in + i * 2), gains));
+            _mm256_storeu_ps(out + i * 2, sum);
+        }
+#elif defined(HAS_SSE2)
+        auto gains = _mm_setr_ps(gainLeft, gainRight, gainLeft, gainRight);
+        for (; i + 2 <= samples; i += 2)
+        {
+            auto sum = _mm_add_ps(_mm_loadu_ps(out + i * 2), _mm_mul_ps(_mm_loadu_ps(in + i * 2), gains));
+            _mm_storeu_ps(out + i * 2, sum);
+        }
+#endif
+        for (; i < samples; ++i)
+        {
+            out[i * 2]     += in[i * 2]     * gainLeft;
+            out[i * 2 + 1] += in[i * 2 + 1] * gainRight;
+        }
+        return;
+    }
+
+#if defined(HAS_AVX2)
+    auto gains = _mm256_setr_ps(gainLeft, gainRight, gainLeft, gainRight, gainLeft, gainRight, gainLeft, gainRight);
+    for (; i + 8 <= samples; i += 8)
+    {
+        auto m  = _mm256_loadu_ps(in + i);
+        auto lo = _mm256_unpacklo_ps(m, m); // 0 0 1 1 | 4 4 5 5
+        auto hi = _mm256_unpackhi_ps(m, m); // 2 2 3 3 | 6 6 7 7
+        auto a  = _mm256_permute2f128_ps(lo, hi, 0x20);
+        auto b  = _mm256_permute2f128_ps(lo, hi, 0x31);
+        _mm256_storeu_ps(out + i * 2,     _mm256_add_ps(_mm256_loadu_ps(out + i * 2),     _mm256_mul_ps(a, gains)));
+        _mm256_storeu_ps(out + i * 2 + 8, _mm256_add_ps(_mm256_loadu_ps(out + i * 2 + 8), _mm256_mul_ps(b, gains)));
+    }
+#elif defined(HAS_SSE2)
+    auto gains = _mm_setr_ps(gainLeft, gainRight, gainLeft, gainRight);
+    for (; i + 4 <= samples; i += 4)
+    {
+        auto m = _mm_loadu_ps(in + i);
+        _mm_storeu_ps(out + i * 2,     _mm_add_ps(_mm_loadu_ps(out + i * 2),     _mm_mul_ps(_mm_unpacklo_ps(m, m), gains)));
+        _mm_storeu_ps(out + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(out + i * 2 + 4), _mm_mul_ps(_mm_unpackhi_ps(m, m), gains)));
+    }
+#endif
+    for (; i < samples; ++i)
+    {
+        out[i * 2]     += in[i] * gainLeft;
+        out[i * 2 + 1] += in[i] * gainRight;
+    }
+}
+
+void interleaveMatrix(const float* const* channels, int channelsNum, int offset, int samples,
+                      const float* matrix, int outChannelsNum, float* out)
+{
+    int i = 0;
+
+    // 8 or 4 samples of every output channel at a time, stored by unpacking
+    // for stereo and lane by lane for the other layouts
+#if defined(HAS_AVX2)
+    if (outChannelsNum <= MatrixMaxOutputs)
+    {
+        for (; i + 8 <= samples; i += 8)
+        {
+            __m256 sums[MatrixMaxOutputs];
+            for (int o = 0; o < outChannelsNum; ++o)
+            {
+                sums[o] = _mm256_setzero_ps();
+                for (int c = 0; c < channelsNum; ++c)
+                {
+                    if (auto gain = matrix[o * channelsNum + c]; gain != 0.0f)
+                    {
+                        auto in = _mm256_loadu_ps(channels[c] + offset + i);
+                        sums[o] = _mm256_add_ps(sums[o], _mm256_mul_ps(in, _mm256_set1_ps(gain)));
+                    }
+                }
+            }
+
+            if (outChannelsNum == 2)
+            {
+                auto lo = _mm256_unpacklo_ps(sums[0], sums[1]); // l0 r0 l1 r1 | l4 r4 l5 r5
+                auto hi = _mm256_unpackhi_ps(sums[0], sums[1]); // l2 r2 l3 r3 | l6 r6 l7 r7
+                _mm256_storeu_ps(out + i * 2,     _mm256_permute2f128_ps(lo, hi, 0x20));
+                _mm256_storeu_ps(out + i * 2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+            }
+            else if (outChannelsNum == 1)
+            {
+                _mm256_storeu_ps(out + i, sums[0]);
+            }
+            else
+            {
+                alignas(32) float lanes[MatrixMaxOutputs][8];
+                for (int o = 0; o < outChannelsNum; ++o)
+                {
+                    _mm256_store_ps(lanes[o], sums[o]);
+                }
+                for (int j = 0; j < 8; ++j)
+                {
+                    for (int o = 0; o < outChannelsNum; ++o)
+                    {
+                        out[(i + j) * outChannelsNum + o] = lanes[o][j];
+                    }
+                }
+            }
+        }
+    }
+#elif defined(HAS_SSE2)
+    if (outChannelsNum <= MatrixMaxOutputs)
+    {
+        for (; i + 4 <= samples; i += 4)
+        {
+            __m128 sums[MatrixMaxOutputs];
+            for (int o = 0; o < outChannelsNum; ++o)
+            {
+                sums[o] = _mm_setzero_ps();
+                for (int c = 0; c < channelsNum; ++c)
+                {
+                    if (auto gain = matrix[o * channelsNum + c]; gain != 0.0f)
+                    {
+                        auto in = _mm_loadu_ps(channels[c] + offset + i);
+                        sums[o] = _mm_add_ps(sums[o], _mm_mul_ps(in, _mm_set1_ps(gain)));
+                    }
+                }
+            }
+
+            if (outChannelsNum == 2)
+            {
+                _mm_storeu_ps(out + i * 2,     _mm_unpacklo_ps(sums[0], sums[1]));
+                _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(sums[0], sums[1]));
+            }
+            else if (outChannelsNum == 1)
+            {
+                _mm_storeu_ps(out + i, sums[0]);
+            }
+            else
+            {
+                alignas(16) float lanes[MatrixMaxOutputs][4];
+                for (int o = 0; o < outChannelsNum; ++o)
+                {
+                    _mm_store_ps(lanes[o], sums[o]);
+                }
+                for (int j = 0; j < 4; ++j)
+                {
+                    for (int o = 0; o < outChannelsNum; ++o)
+                    {
+                        out[(i + j) * outChannelsNum + o] = lanes[o][j];
+                    }
+                }
+            }
+        }
+    }
+#endif
+
+    for (; i < samples; ++i)
+    {
+        for (int o = 0; o < outChannelsNum; ++o)
+        {
+            float sum = 0;
+            for (int c = 0; c < channelsNum; ++c)
+            {
+                sum += matrix[o * channelsNum + c] * channels[c][offset + i];
+            }
+            out[i * outChannelsNum + o] = sum;
+        }
+    }
+}
+
+int findFirstAbove(const float* samples, int n, float threshold)
+{
+    int i = 0;
+
+#if defined(HAS_AVX2)
+    auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    auto limit   = _mm256_set1_ps(threshold);
+    for (; i + 8 <= n; i += 8)
+    {
+        auto above = _mm256_cmp_ps(_mm256_and_ps(_mm256_loadu_ps(samples + i), absMask), limit, _CMP_GT_OQ);
+        if (auto mask = (unsigned)_mm256_movemask_ps(above))
+        {
+            return i + std::countr_zero(mask);
+        }
+    }
+#elif defined(HAS_SSE2)
+    auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    auto limit   = _mm_set1_ps(threshold);
+    for (; i + 4 <= n; i += 4)
+    {
+        auto above = _mm_cmpgt_ps(_mm_and_ps(_mm_loadu_ps(samples + i), absMask), limit);
+        if (auto mask = (unsigned)_mm_movemask_ps(above))
+        {
+            return i + std::countr_zero(mask);
+        }
+    }
+#endif
+
+    for (; i < n; ++i)
+    {
+        if (std::fabs(samples[i]) > threshold)
+        {
+            return i;
+        }
+    }
+    return n;
+}
+
+int findLastAbove(const float* samples, int n, float threshold)
+{
+    int i = n; // samples [i, n) are at or below threshold
+
+#if defined(HAS_AVX2)
+    auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    auto limit   = _mm256_set1_ps(threshold);
+    for (; i >= 8; i -= 8)
+    {
+        auto above = _mm256_cmp_ps(_mm256_and_ps(_mm256_loadu_ps(samples + i - 8), absMask), limit, _CMP_GT_OQ);
+        if (auto mask = (unsigned)_mm256_movemask_ps(above))
+        {
+            return i - 8 + (31 - std::countl_zero(mask));
+        }
+    }
+#elif defined(HAS_SSE2)
+    auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    auto limit   = _mm_set1_ps(threshold);
+    for (; i >= 4; i -= 4)
+    {
+        auto above = _mm_cmpgt_ps(_mm_and_ps(_mm_loadu_ps(samples + i - 4), absMask), limit);
+        if (auto mask = (unsigned)_mm_movemask_ps(above))
+        {
+            return i - 4 + (31 - std::countl_zero(mask));
+        }
+    }
+#endif
+
+    for (; i > 0; --i)
+    {
+        if (std::fabs(samples[i - 1]) > threshold)
+        {
+            return i - 1;
+        }
+    }
+    return -1;
+}
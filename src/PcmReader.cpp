@@ -0,0 +1,203 @@
+#include "PcmReader.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include <string.h>
+
+//
+// PcmBlockCache
+//
+
+PcmBlockCache::Block PcmBlockCache::find(const void* owner, int64_t index)
+{
+    std::lock_guard lock(_mutex);
+    auto it = _lookup.find({ owner, index });
+    if (it == _lookup.end())
+    {
+        return nullptr;
+    }
+
+    _entries.splice(_entries.begin(), _entries, it->second);
+    return it->second->block;
+}
+
+void PcmBlockCache::insert(const void* owner, int64_t index, Block block)
+{
+    std::lock_guard lock(_mutex);
+    Key key = { owner, index };
+    if (auto it = _lookup.find(key); it != _lookup.end())
+    {
+        _bytes -= sizeOf(it->second->block);
+        _entries.erase(it->second);
+        _lookup.erase(it);
+    }
+
+    _bytes += sizeOf(block);
+    _entries.push_front({ key, std::move(block) });
+    _lookup[key] = _entries.begin();
+
+    // keep the newest one even when it alone is over the limit
+    while (_bytes > _maxBytes && _entries.size() > 1)
+    {
+        auto& oldest = _entries.back();
+        _bytes -= sizeOf(oldest.block);
+        _lookup.erase(oldest.key);
+        _entries.pop_back();
+    }
+}
+
+void PcmBlockCache::erase(const void* owner)
+{
+    std::lock_guard lock(_mutex);
+    for (auto it = _entries.begin(); it != _entries.end();)
+    {
+        if (it->key.owner == owner)
+        {
+            _bytes -= sizeOf(it->block);
+            _lookup.erase(it->key);
+            it = _entries.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+size_t PcmBlockCache::bytes() const
+{
+    std::lock_guard lock(_mutex);
+    return _bytes;
+}
+
+//
+// PcmReader
+//
+
+PcmReader::PcmReader(PcmBlockCache* cache)
+{
+    if (!cache)
+    {
+        _ownCache = std::make_unique<PcmBlockCache>();
+        cache     = _ownCache.get();
+    }
+    _cache = cache;
+}
+
+PcmReader::~PcmReader()
+{
+    close();
+}
+
+int PcmReader::open(const char* filename)
+{
+    close();
+    return _decoder.open(filename);
+}
+
+void PcmReader::close()
+{
+    _cache->erase(this);
+    _decoder.close();
+}
+
+int64_t PcmReader::blockStart(int64_t block) const
+{
+    auto& index = _decoder.index();
+    auto  frame = (size_t)block * BlockFrames;
+    return frame < index.size() ? index[frame].firstSample : index.samplesNum();
+}
+
+int PcmReader::loadBlock(int64_t block, PcmBlockCache::Block& out)
+{
+    if ((out = _cache->find(this, block)))
+    {
+        ++_stats.blockHits;
+        return 0;
+    }
+    ++_stats.blockMisses;
+
+    auto& index = _decoder.index();
+    auto  start = blockStart(block);
+    auto  end   = blockStart(block + 1);
+
+    // Reading on from the previous block needs no seek and no pre-roll.
+    int ret;
+    if (_decoder.position() != start)
+    {
+        auto preRollFrame = index.preRollStart((size_t)block * BlockFrames);
+        _stats.preRollSamples += start - index[preRollFrame].firstSample;
+        _stats.decodedSamples += start - index[preRollFrame].firstSample;
+        if ((ret = _decoder.seek(start)) < 0)
+        {
+            return ret;
+        }
+    }
+
+    auto samples = std::make_shared<std::vector<float>>((size_t)(end - start) * channelsNum());
+    auto size    = (int)(samples->size() * sizeof(float));
+    if ((ret = _decoder.fill((uint8_t*)samples->data(), size)) < 0)
+    {
+        return ret;
+    }
+
+    // a damaged stream may decode to fewer samples than indexed
+    samples->resize(ret / sizeof(float));
+    _stats.decodedSamples += end - start;
+
+    _cache->insert(this, block, samples);
+    out = std::move(samples);
+    return 0;
+}
+
+int64_t PcmReader::read(int64_t start, int64_t end, float* out)
+{
+    start = std::clamp<int64_t>(start, 0, samplesNum());
+    end   = std::clamp<int64_t>(end, start, samplesNum());
+
+    auto& index      = _decoder.index();
+    auto  clockStart = std::chrono::steady_clock::now();
+    auto  misses     = _stats.blockMisses;
+
+    // blocks holding start and end - 1
+    auto firstBlock = (int64_t)(index.frameOf(start) / BlockFrames);
+    auto lastBlock  = end > start ? (int64_t)(index.frameOf(end - 1) / BlockFrames) : firstBlock - 1;
+
+    int64_t copied = 0;
+    for (auto block = firstBlock; block <= lastBlock; ++block)
+    {
+        PcmBlockCache::Block samples;
+        if (auto ret = loadBlock(block, samples); ret < 0)
+        {
+            return ret;
+        }
+
+        auto blockBegin = blockStart(block);
+        auto from       = std::max(start, blockBegin) - blockBegin;
+        auto to         = std::min(end, blockStart(block + 1)) - blockBegin;
+
+        // what a damaged block lacks reads as silence, so out[i] stays sample start + i
+        auto decodedTo = std::clamp<int64_t>(samples->size() / channelsNum(), from, to);
+        memcpy(out + copied * channelsNum(), samples->data() + from * channelsNum(),
+               (size_t)(decodedTo - from) * channelsNum() * sizeof(float));
+        memset(out + (copied + decodedTo - from) * channelsNum(), 0,
+               (size_t)(to - decodedTo) * channelsNum() * sizeof(float));
+        copied += to - from;
+    }
+
+    auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - clockStart).count();
+    ++_stats.reads;
+    if (_stats.blockMisses == misses)
+    {
+        ++_stats.hitReads;
+        _stats.hitReadMs += ms;
+    }
+    else
+    {
+        _stats.missReadMs += ms;
+    }
+    _stats.maxReadMs = std::max(_stats.maxReadMs, ms);
+
+    return copied;
+}
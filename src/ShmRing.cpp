@@ -0,0 +1,431 @@
+#ifdef __linux__
+
+extern "C"
+{
+#include <libavutil/error.h>
+}
+
+#include "PcmKernels.hpp"
+#include "ShmRing.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <new>
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+constexpr uint32_t RingMagic   = 0x53524e47; // "SRNG"
+constexpr uint32_t RingVersion = 1;
+constexpr size_t   HeaderSize  = 4096;       // a page, the data starts page aligned
+constexpr size_t   RecordAlign = 64;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free);
+
+// Positions count bytes since creation, a side sleeping on a sequence
+// sets its waiting flag first, so the other side only wakes it when needed.
+struct ShmRingHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+
+    alignas(64) std::atomic<uint64_t> writePos;
+    std::atomic<uint32_t>             writeSeq;
+    std::atomic<uint32_t>             readerWaiting;
+    std::atomic<uint32_t>             writerClosed;
+
+    alignas(64) std::atomic<uint64_t> readPos;
+    std::atomic<uint32_t>             readSeq;
+    std::atomic<uint32_t>             writerWaiting;
+};
+
+static_assert(sizeof(ShmRingHeader) <= HeaderSize);
+
+struct ShmRecordHeader
+{
+    ShmRecordKind kind;
+    uint32_t      samples;
+    uint32_t      sampleRate;
+    uint32_t      channelsNum;
+    int64_t       timestampNs;
+    uint64_t      size; // of the record, header included
+};
+
+static_assert(sizeof(ShmRecordHeader) % 16 == 0);
+
+static int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// milliseconds left until deadlineNs, -1 for no deadline
+static int msUntil(int64_t deadlineNs)
+{
+    return deadlineNs < 0 ? -1 : (int)std::max<int64_t>(0, (deadlineNs - nowNs()) / 1000000);
+}
+
+static size_t recordSize(size_t payload)
+{
+    return (sizeof(ShmRecordHeader) + payload + RecordAlign - 1) & ~(RecordAlign - 1);
+}
+
+// until woken, timed out, or word no longer holds expected
+static void futexWait(std::atomic<uint32_t>& word, uint32_t expected, int timeoutMs)
+{
+    timespec  timeout;
+    timespec* pTimeout = nullptr;
+    if (timeoutMs >= 0)
+    {
+        timeout.tv_sec  = timeoutMs / 1000;
+        timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+        pTimeout        = &timeout;
+    }
+    syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT, expected, pTimeout, nullptr, 0);
+}
+
+static void futexWake(std::atomic<uint32_t>& word)
+{
+    syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// Map the header and the data, followed by the data again, so a record
+// crossing the end of the ring is contiguous in memory.
+static uint8_t* mapRing(int fd, size_t capacity)
+{
+    auto total = HeaderSize + 2 * capacity;
+    auto base  = (uint8_t*)mmap(nullptr, total, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    if (mmap(base, HeaderSize + capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + HeaderSize + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, HeaderSize) == MAP_FAILED)
+    {
+        munmap(base, total);
+        return nullptr;
+    }
+    return base;
+}
+
+//
+// ShmRingWriter
+//
+
+ShmRingWriter::~ShmRingWriter()
+{
+    close();
+}
+
+int ShmRingWriter::create(const char* name, size_t capacity, int maxWaitMs)
+{
+    close();
+
+    _capacity  = std::bit_ceil(std::max(capacity, HeaderSize));
+    _maxWaitMs = maxWaitMs;
+    if (name)
+    {
+        _name = name;
+        _fd   = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    }
+    else
+    {
+        _fd = memfd_create("pcm-ring", 0);
+    }
+    if (_fd < 0)
+    {
+        auto ret = AVERROR(errno);
+        _name.clear();
+        return ret;
+    }
+
+    uint8_t* base = nullptr;
+    if (ftruncate(_fd, HeaderSize + _capacity) < 0 || !(base = mapRing(_fd, _capacity)))
+    {
+        auto ret = AVERROR(errno);
+        close();
+        return ret;
+    }
+
+    _header = new (base) ShmRingHeader{};
+    _data   = base + HeaderSize;
+
+    _header->capacity = _capacity;
+    _header->version  = RingVersion;
+    std::atomic_thread_fence(std::memory_order_release);
+    _header->magic    = RingMagic;
+    return 0;
+}
+
+void ShmRingWriter::close()
+{
+    if (_header)
+    {
+        _header->writerClosed = 1;
+        _header->writeSeq.fetch_add(1);
+        futexWake(_header->writeSeq);
+        munmap(_header, HeaderSize + 2 * _capacity);
+        _header = nullptr;
+        _data   = nullptr;
+    }
+    if (_fd >= 0)
+    {
+        ::close(_fd);
+        _fd = -1;
+    }
+    if (!_name.empty())
+    {
+        shm_unlink(_name.c_str()); // attached readers keep their mapping
+        _name.clear();
+    }
+}
+
+uint8_t* ShmRingWriter::reserve(size_t size)
+{
+    if (!_header)
+    {
+        return nullptr; // create() failed or wasn't called
+    }
+
+    auto deadline = _maxWaitMs < 0 ? -1 : nowNs() + (int64_t)_maxWaitMs * 1000000;
+    while (true)
+    {
+        auto seq      = _header->readSeq.load();
+        auto writePos = _header->writePos.load(std::memory_order_relaxed);
+        if (writePos + size - _header->readPos.load() <= _capacity)
+        {
+            return _data + (writePos & (_capacity - 1));
+        }
+
+        auto timeoutMs = msUntil(deadline);
+        if (timeoutMs == 0)
+        {
+            return nullptr;
+        }
+
+        _header->writerWaiting = 1;
+        if (writePos + size - _header->readPos.load() <= _capacity)
+        {
+            _header->writerWaiting = 0;
+            continue;
+        }
+        futexWait(_header->readSeq, seq, timeoutMs);
+    }
+}
+
+void ShmRingWriter::publish(size_t size)
+{
+    _header->writePos.fetch_add(size);
+    _header->writeSeq.fetch_add(1);
+    if (_header->readerWaiting.exchange(0))
+    {
+        futexWake(_header->writeSeq);
+    }
+}
+
+void ShmRingWriter::begin(int sampleRate, int channelsNum)
+{
+    _sampleRate  = sampleRate;
+    _channelsNum = channelsNum;
+
+    auto size = recordSize(0);
+    if (auto p = reserve(size))
+    {
+        *(ShmRecordHeader*)p = { ShmRecordKind::Begin, 0, (uint32_t)sampleRate, (uint32_t)channelsNum, nowNs(), size };
+        publish(size);
+    }
+}
+
+void ShmRingWriter::process(const float* const* channels, int samples)
+{
+    if (!_header)
+    {
+        ++_dropped; // no ring to size the records by
+        return;
+    }
+
+    // a record takes at most half of the ring, so the reader can hold one
+    auto frameSize  = (size_t)_channelsNum * sizeof(float);
+    auto maxSamples = (int)((_capacity / 2 - sizeof(ShmRecordHeader)) / frameSize);
+
+    for (int offset = 0; offset < samples;)
+    {
+        auto count = std::min(samples - offset, maxSamples);
+        auto size  = recordSize(count * frameSize);
+        auto p     = reserve(size);
+        if (!p)
+        {
+            ++_dropped;
+            offset += count;
+            continue;
+        }
+
+        // the one conversion, straight into the shared memory
+        interleaveFloat(channels, _channelsNum, offset, count, (float*)(p + sizeof(ShmRecordHeader)));
+        *(ShmRecordHeader*)p = { ShmRecordKind::Samples, (uint32_t)count, (uint32_t)_sampleRate,
+                                 (uint32_t)_channelsNum, nowNs(), size };
+        publish(size);
+        offset += count;
+    }
+}
+
+void ShmRingWriter::end()
+{
+    auto size = recordSize(0);
+    if (auto p = reserve(size))
+    {
+        *(ShmRecordHeader*)p = { ShmRecordKind::End, 0, (uint32_t)_sampleRate, (uint32_t)_channelsNum, nowNs(), size };
+        publish(size);
+    }
+}
+
+//
+// ShmRingReader
+//
+
+ShmRingReader::~ShmRingReader()
+{
+    close();
+}
+
+int ShmRingReader::open(const char* name)
+{
+    auto fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        return AVERROR(errno);
+    }
+    auto ret = openFd(fd);
+    ::close(fd);
+    return ret;
+}
+
+int ShmRingReader::openFd(int fd)
+{
+    close();
+
+    _fd = dup(fd);
+    if (_fd < 0)
+    {
+        return AVERROR(errno);
+    }
+
+    // the capacity first, from the header alone
+    auto header = (ShmRingHeader*)mmap(nullptr, HeaderSize, PROT_READ, MAP_SHARED, _fd, 0);
+    if (header == MAP_FAILED)
+    {
+        auto ret = AVERROR(errno);
+        close();
+        return ret;
+    }
+    auto isValid = header->magic == RingMagic && header->version == RingVersion;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    _capacity = header->capacity;
+    munmap(header, HeaderSize);
+    if (!isValid)
+    {
+        close();
+        return AVERROR_INVALIDDATA;
+    }
+
+    auto base = mapRing(_fd, _capacity);
+    if (!base)
+    {
+        auto ret = AVERROR(errno);
+        close();
+        return ret;
+    }
+    _header = (ShmRingHeader*)base;
+    _data   = base + HeaderSize;
+    return 0;
+}
+
+void ShmRingReader::close()
+{
+    if (_header)
+    {
+        munmap(_header, HeaderSize + 2 * _capacity);
+        _header = nullptr;
+        _data   = nullptr;
+    }
+    if (_fd >= 0)
+    {
+        ::close(_fd);
+        _fd = -1;
+    }
+    _pending = 0;
+}
+
+int ShmRingReader::next(ShmRingBlock& block, int timeoutMs)
+{
+    release();
+
+    auto deadline = timeoutMs < 0 ? -1 : nowNs() + (int64_t)timeoutMs * 1000000;
+    auto readPos  = _header->readPos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto seq = _header->writeSeq.load();
+        if (_header->writePos.load() != readPos)
+        {
+            break;
+        }
+        if (_header->writerClosed)
+        {
+            return AVERROR_EOF;
+        }
+
+        auto leftMs = msUntil(deadline);
+        if (leftMs == 0)
+        {
+            return 0;
+        }
+
+        _header->readerWaiting = 1;
+        if (_header->writePos.load() != readPos)
+        {
+            _header->readerWaiting = 0;
+            break;
+        }
+        futexWait(_header->writeSeq, seq, leftMs);
+    }
+
+    auto p      = _data + (readPos & (_capacity - 1));
+    auto record = (const ShmRecordHeader*)p;
+
+    block.kind        = record->kind;
+    block.sampleRate  = (int)record->sampleRate;
+    block.channelsNum = (int)record->channelsNum;
+    block.samples     = (int)record->samples;
+    block.timestampNs = record->timestampNs;
+    block.data        = (const float*)(p + sizeof(ShmRecordHeader));
+    _pending          = record->size;
+    return 1;
+}
+
+void ShmRingReader::release()
+{
+    if (_pending == 0)
+    {
+        return;
+    }
+
+    _header->readPos.fetch_add(_pending);
+    _pending = 0;
+    _header->readSeq.fetch_add(1);
+    if (_header->writerWaiting.exchange(0))
+    {
+        futexWake(_header->readSeq);
+    }
+}
+
+#endif
@@ -0,0 +1,240 @@
+#include "Silence.hpp"
+#include "PcmKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+LoudRange findLoudRange(const float* const* channels, int channelsNum, int samples, float threshold)
+{
+    LoudRange range = { samples, -1 };
+    for (int ch = 0; ch < channelsNum; ++ch)
+    {
+        // the other channels only need to look before the first loud sample found so far
+        range.first = std::min(range.first, findFirstAbove(channels[ch], range.first, threshold));
+    }
+    if (range.first == samples)
+    {
+        return range;
+    }
+
+    for (int ch = 0; ch < channelsNum; ++ch)
+    {
+        auto from = std::max(range.last + 1, range.first);
+        auto last = findLastAbove(channels[ch] + from, samples - from, threshold);
+        if (last >= 0)
+        {
+            range.last = from + last;
+        }
+    }
+    return range;
+}
+
+//
+// SilenceDetector
+//
+
+void SilenceDetector::begin(int sampleRate, int channelsNum)
+{
+    _threshold   = dbToGain(_options.thresholdDb);
+    _minSilence  = (int64_t)_options.minSilenceMs * sampleRate / 1000;
+    _channelsNum = channelsNum;
+    _position    = 0;
+    _run         = 0;
+    _result      = { {}, -1, 0, 0 };
+}
+
+void SilenceDetector::process(const float* const* channels, int samples)
+{
+    auto range = findLoudRange(channels, _channelsNum, samples, _threshold);
+    if (range.first == samples)
+    {
+        _run += samples;
+    }
+    else
+    {
+        _run += range.first;
+        closeRun(_position + range.first);
+        if (_result.audioStart < 0)
+        {
+            _result.audioStart = _position + range.first;
+        }
+        _result.audioEnd = _position + range.last + 1;
+        _run             = samples - 1 - range.last;
+    }
+    _position += samples;
+}
+
+void SilenceDetector::end()
+{
+    closeRun(_position);
+    if (_result.audioStart < 0)
+    {
+        _result.audioStart = 0;
+        _result.audioEnd   = 0;
+    }
+    _result.samplesNum = _position;
+}
+
+void SilenceDetector::closeRun(int64_t runEnd)
+{
+    if (_run > 0 && _run >= _minSilence)
+    {
+        _result.regions.push_back({ runEnd - _run, runEnd });
+    }
+    _run = 0;
+}
+
+//
+// SilenceSkipper
+//
+
+void SilenceSkipper::begin(int sampleRate, int channelsNum)
+{
+    _threshold   = dbToGain(_options.thresholdDb);
+    _minSilence  = (int64_t)_options.minSilenceMs * sampleRate / 1000;
+    _channelsNum = channelsNum;
+    _run         = 0;
+    _skipped     = 0;
+    _isAudible   = false;
+}
+
+int SilenceSkipper::keep(const float* const* channels, int samples, SampleRange ranges[2])
+{
+    auto range     = findLoudRange(channels, _channelsNum, samples, _threshold);
+    auto rangesNum = 0;
+    auto kept      = 0;
+
+    // what is left of minSilence for the silent run continuing into this frame
+    auto headEnd = _isAudible ? (int)std::clamp<int64_t>(_minSilence - _run, 0, range.first) : 0;
+    if (headEnd > 0)
+    {
+        ranges[rangesNum++] = { 0, headEnd };
+        kept               += headEnd;
+    }
+
+    if (range.first == samples)
+    {
+        _run += samples;
+    }
+    else
+    {
+        // the loud part, and the start of the silence behind it
+        auto tail = samples - 1 - range.last;
+        auto end  = range.last + 1 + (int)std::min<int64_t>(tail, _minSilence);
+        if (rangesNum > 0 && headEnd == range.first)
+        {
+            ranges[0].count = end;
+        }
+        else
+        {
+            ranges[rangesNum++] = { range.first, end - range.first };
+        }
+        kept      += end - range.first;
+        _run       = tail;
+        _isAudible = true;
+    }
+
+    _skipped += samples - kept;
+    return rangesNum;
+}
+
+//
+// SilenceSkipTap
+//
+
+void SilenceSkipTap::begin(int sampleRate, int channelsNum)
+{
+    _threshold = dbToGain(_options.thresholdDb);
+    _isAudible = false;
+    _skipped   = 0;
+    _held.assign(channelsNum, {});
+    _channels.resize(channelsNum);
+    _next.begin(sampleRate, channelsNum);
+}
+
+void SilenceSkipTap::process(const float* const* channels, int samples)
+{
+    auto range = findLoudRange(channels, (int)_channels.size(), samples, _threshold);
+    if (range.first == samples)
+    {
+        if (_isAudible)
+        {
+            hold(channels, 0, samples);
+        }
+        else
+        {
+            _skipped += samples; // intro
+        }
+        return;
+    }
+
+    // the pause behind the last audio was one inside the track
+    auto start = 0;
+    if (_isAudible)
+    {
+        flush();
+    }
+    else
+    {
+        start     = range.first;
+        _skipped += start;
+    }
+
+    for (size_t ch = 0; ch < _channels.size(); ++ch)
+    {
+        _channels[ch] = channels[ch] + start;
+    }
+    _next.process(_channels.data(), range.last + 1 - start);
+
+    hold(channels, range.last + 1, samples - 1 - range.last);
+    _isAudible = true;
+}
+
+void SilenceSkipTap::end()
+{
+    drop(); // outro
+    _next.end();
+}
+
+void SilenceSkipTap::abort()
+{
+    drop();
+    _next.abort();
+}
+
+void SilenceSkipTap::hold(const float* const* channels, int offset, int count)
+{
+    for (size_t ch = 0; ch < _held.size(); ++ch)
+    {
+        _held[ch].insert(_held[ch].end(), channels[ch] + offset, channels[ch] + offset + count);
+    }
+}
+
+void SilenceSkipTap::flush()
+{
+    if (_held.empty() || _held[0].empty())
+    {
+        return;
+    }
+    for (size_t ch = 0; ch < _held.size(); ++ch)
+    {
+        _channels[ch] = _held[ch].data();
+    }
+    _next.process(_channels.data(), (int)_held[0].size());
+    for (auto& held : _held)
+    {
+        held.clear();
+    }
+}
+
+void SilenceSkipTap::drop()
+{
+    if (!_held.empty())
+    {
+        _skipped += _held[0].size();
+    }
+    for (auto& held : _held)
+    {
+        held.clear();
+    }
+}
@@ -0,0 +1,82 @@
+extern "C"
+{
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+#include "Spectral.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+//
+// RealFft
+//
+
+RealFft::~RealFft()
+{
+    release();
+}
+
+int RealFft::init(int size)
+{
+    release();
+
+    float scale = 1.0f;
+    if (auto ret = av_tx_init(&_tx, &_txFn, AV_TX_FLOAT_RDFT, 0, size, &scale, 0); ret < 0)
+    {
+        return ret;
+    }
+    _input  = (float*)av_malloc(size * sizeof(float));
+    _output = (float*)av_malloc((size / 2 + 1) * 2 * sizeof(float));
+    if (!_input || !_output)
+    {
+        release();
+        return AVERROR(ENOMEM);
+    }
+    _size = size;
+    return 0;
+}
+
+void RealFft::release()
+{
+    av_tx_uninit(&_tx);
+    av_freep(&_input);
+    av_freep(&_output);
+    _size = 0;
+}
+
+//
+// Bands
+//
+
+std::vector<float> hannWindow(int size)
+{
+    std::vector<float> window(size);
+    for (int i = 0; i < size; ++i)
+    {
+        window[i] = (float)(0.5 - 0.5 * std::cos(2 * std::numbers::pi * i / size));
+    }
+    return window;
+}
+
+std::vector<int> logBandBins(int fftSize, int sampleRate, int bandsNum, double minHz, double maxHz)
+{
+    auto nyquist = sampleRate / 2.0;
+    auto binHz   = (double)sampleRate / fftSize;
+    maxHz        = std::clamp(maxHz, 2 * binHz, nyquist);
+    minHz        = std::clamp(minHz, binHz, maxHz / 2);
+
+    std::vector<int> bins(bandsNum + 1);
+    for (int b = 0; b <= bandsNum; ++b)
+    {
+        auto edge = minHz * std::pow(maxHz / minHz, (double)b / bandsNum);
+        bins[b]   = std::clamp((int)std::lround(edge / binHz), 1, fftSize / 2 + 1);
+        if (b > 0)
+        {
+            bins[b] = std::max(bins[b], std::min(bins[b - 1] + 1, fftSize / 2 + 1));
+        }
+    }
+    return bins;
+}
@@ -0,0 +1,201 @@
+#include "SpectrumAnalyzer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+
+#include <string.h>
+
+constexpr int   RingWindows = 16;     // fftSize blocks the ring holds
+constexpr float PowerFloor  = 1e-12f; // -120 dB, for silent bands
+
+SpectrumAnalyzer::SpectrumAnalyzer(const SpectrumOptions& options) : _options(options)
+{
+    _options.fftSize  = std::max(16, _options.fftSize);
+    _options.hopSize  = std::clamp(_options.hopSize, 1, _options.fftSize);
+    _options.bandsNum = std::max(1, _options.bandsNum);
+
+    // no reader yet, later begin() calls reset through the writer side
+    _spectra.fill({ std::vector<float>(_options.bandsNum, 10 * std::log10(PowerFloor)), 0, 0 });
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    stop();
+}
+
+void SpectrumAnalyzer::begin(int sampleRate, int channelsNum)
+{
+    stop();
+
+    auto fftSize = _options.fftSize;
+    _channelsNum = channelsNum;
+    _error       = 0;
+
+    if (auto ret = _fft.init(fftSize); ret < 0)
+    {
+        _error = ret;
+        return;
+    }
+
+    // Hann, scaled so the bands of a full scale sine sum to 1
+    _window            = hannWindow(fftSize);
+    double windowPower = 0;
+    for (auto w : _window)
+    {
+        windowPower += (double)w * w;
+    }
+    _powerScale = (float)(4.0 / (fftSize * windowPower));
+
+    auto binHz = (double)sampleRate / fftSize;
+    _bandBins  = logBandBins(fftSize, sampleRate, _options.bandsNum, _options.minFrequency, sampleRate / 2.0);
+    _bandFrequencies.resize(_options.bandsNum);
+    for (int b = 0; b < _options.bandsNum; ++b)
+    {
+        _bandFrequencies[b] = (float)(_bandBins[b] * binHz);
+    }
+
+    _history.assign(fftSize, 0.0f);
+    _ring.assign(std::bit_ceil((size_t)fftSize * RingWindows), 0.0f);
+    _ringMask       = (int64_t)_ring.size() - 1;
+    _written        = 0;
+    _read           = 0;
+    _droppedSamples = 0;
+    _analyses       = 0;
+    _busyNs         = 0;
+
+    // the analyzer thread is stopped, this thread is the writer until it starts
+    auto& reset = _spectra.back();
+    std::fill(reset.bands.begin(), reset.bands.end(), 10 * std::log10(PowerFloor));
+    reset.position = 0;
+    reset.sequence = 0;
+    _spectra.publish();
+
+    _isStopping = false;
+    _thread     = std::thread(&SpectrumAnalyzer::analyzerLoop, this);
+}
+
+void SpectrumAnalyzer::process(const float* const* channels, int samples)
+{
+    if (!_thread.joinable())
+    {
+        return;
+    }
+
+    auto written = _written.load(std::memory_order_relaxed);
+    auto space   = (int64_t)_ring.size() - (written - _read.load(std::memory_order_acquire));
+    auto count   = (int)std::min<int64_t>(samples, space);
+    if (count < samples)
+    {
+        _droppedSamples.fetch_add(samples - count, std::memory_order_relaxed);
+    }
+
+    auto gain = 1.0f / _channelsNum;
+    for (int i = 0; i < count; ++i)
+    {
+        float sum = 0;
+        for (int ch = 0; ch < _channelsNum; ++ch)
+        {
+            sum += channels[ch][i];
+        }
+        _ring[(written + i) & _ringMask] = sum * gain;
+    }
+
+    _written.store(written + count, std::memory_order_release);
+    _wakeups.fetch_add(1, std::memory_order_release);
+    _wakeups.notify_one();
+}
+
+void SpectrumAnalyzer::end()
+{
+    stop();
+}
+
+void SpectrumAnalyzer::stop()
+{
+    if (_thread.joinable())
+    {
+        _isStopping = true;
+        _wakeups.fetch_add(1, std::memory_order_release);
+        _wakeups.notify_one();
+        _thread.join();
+    }
+
+    _fft.release();
+}
+
+const SpectrumFrame& SpectrumAnalyzer::latest()
+{
+    _spectra.update();
+    return _spectra.front();
+}
+
+SpectrumStats SpectrumAnalyzer::stats() const
+{
+    return { _analyses.load(), _droppedSamples.load(), _busyNs.load() / 1e9 };
+}
+
+void SpectrumAnalyzer::analyzerLoop()
+{
+    auto fftSize = _options.fftSize;
+    auto hopSize = _options.hopSize;
+    auto read    = _read.load(std::memory_order_relaxed);
+    while (true)
+    {
+        // read the wakeup count first, a write after the check bumps it
+        auto wakeups = _wakeups.load(std::memory_order_acquire);
+        auto written = _written.load(std::memory_order_acquire);
+        if (written - read < hopSize)
+        {
+            if (_isStopping.load(std::memory_order_acquire))
+            {
+                return;
+            }
+            _wakeups.wait(wakeups, std::memory_order_acquire);
+            continue;
+        }
+
+        // slide the history by a hop
+        memmove(_history.data(), _history.data() + hopSize, (fftSize - hopSize) * sizeof(float));
+        for (int i = 0; i < hopSize; ++i)
+        {
+            _history[fftSize - hopSize + i] = _ring[(read + i) & _ringMask];
+        }
+        read += hopSize;
+        _read.store(read, std::memory_order_release);
+
+        analyze(read);
+    }
+}
+
+void SpectrumAnalyzer::analyze(int64_t position)
+{
+    auto start   = std::chrono::steady_clock::now();
+    auto fftSize = _options.fftSize;
+
+    auto input = _fft.input();
+    for (int i = 0; i < fftSize; ++i)
+    {
+        input[i] = _history[i] * _window[i];
+    }
+    _fft.transform();
+
+    auto  output = _fft.output();
+    auto& frame  = _spectra.back();
+    for (int b = 0; b < _options.bandsNum; ++b)
+    {
+        float power = 0;
+        for (int bin = _bandBins[b]; bin < _bandBins[b + 1]; ++bin)
+        {
+            power += output[bin * 2] * output[bin * 2] + output[bin * 2 + 1] * output[bin * 2 + 1];
+        }
+        frame.bands[b] = 10 * std::log10(std::max(power * _powerScale, PowerFloor));
+    }
+    frame.position = position;
+    frame.sequence = _analyses.fetch_add(1, std::memory_order_relaxed) + 1;
+    _spectra.publish();
+
+    _busyNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(),
+                      std::memory_order_relaxed);
+}
@@ -0,0 +1,242 @@
+#include "StreamDecoder.hpp"
+#include "DecoderSetup.hpp"
+#include "FileIo.hpp"
+#include "PcmKernels.hpp"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <string.h>
+
+constexpr int BufferSize   = 20480; // file read size
+constexpr int RefillThresh = 4096;
+
+StreamDecoder::~StreamDecoder()
+{
+    close();
+}
+
+int StreamDecoder::open(const char* filename)
+{
+    close();
+
+    _file = fopen(filename, "rb");
+    if (!_file)
+    {
+        return AVERROR(errno);
+    }
+    if (!_index.build(_file, getID3TagEnd(_file)))
+    {
+        close();
+        return AVERROR_INVALIDDATA;
+    }
+
+    int ret;
+    _decoder = avcodec_find_decoder(AV_CODEC_ID_MP3);
+    if (!_decoder)
+    {
+        close();
+        return AVERROR_DECODER_NOT_FOUND;
+    }
+    _decCtx = avcodec_alloc_context3(_decoder);
+    _parser = av_parser_init(_decoder->id);
+    _pkt    = av_packet_alloc();
+    _frame  = av_frame_alloc();
+    if (!_decCtx || !_parser || !_pkt || !_frame)
+    {
+        close();
+        return AVERROR(ENOMEM);
+    }
+    if ((ret = openDecoder(_decCtx, _decoder)) < 0)
+    {
+        close();
+        return ret;
+    }
+
+    _input.resize(BufferSize + RefillThresh + AV_INPUT_BUFFER_PADDING_SIZE);
+    resetInput();
+    seekFile(_file, _index[0].offset, SEEK_SET);
+    return 0;
+}
+
+void StreamDecoder::close()
+{
+    av_frame_free(&_frame);
+    av_packet_free(&_pkt);
+    av_parser_close(_parser);
+    _parser = nullptr;
+    avcodec_free_context(&_decCtx);
+    if (_file)
+    {
+        fclose(_file);
+        _file = nullptr;
+    }
+}
+
+void StreamDecoder::resetInput()
+{
+    _data        = _input.data();
+    _readSize    = 0;
+    _eof         = false;
+    _drained     = false;
+    _pcmOffset   = 0;
+    _skipSamples = 0;
+    _position    = 0;
+    _pcm.clear();
+}
+
+int StreamDecoder::fill(uint8_t* buffer, int size)
+{
+    int ret = 0;
+    while (pendingSize() < size && (ret = decodeMore()) > 0)
+    {
+    }
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    auto storeSize = std::min(size, pendingSize());
+    memcpy(buffer, _pcm.data() + _pcmOffset, storeSize);
+    _pcmOffset += storeSize;
+    _position  += storeSize / blockAlign();
+
+    if (_pcmOffset * 2 >= _pcm.size())
+    {
+        _pcm.erase(_pcm.begin(), _pcm.begin() + _pcmOffset);
+        _pcmOffset = 0;
+    }
+    return storeSize;
+}
+
+int StreamDecoder::seek(int64_t samplePos)
+{
+    if (!_decCtx)
+    {
+        return AVERROR(EINVAL);
+    }
+
+    // the parser and the decoder hold data of the old position
+    av_parser_close(_parser);
+    _parser = av_parser_init(_decoder->id);
+    if (!_parser)
+    {
+        return AVERROR(ENOMEM);
+    }
+    avcodec_flush_buffers(_decCtx);
+    resetInput();
+
+    samplePos = std::clamp<int64_t>(samplePos, 0, _index.samplesNum());
+    _position = samplePos;
+
+    auto frame = _index.frameOf(samplePos);
+    if (frame == _index.size())
+    {
+        _eof     = true;
+        _drained = true;
+        return 0;
+    }
+
+    auto start   = _index.preRollStart(frame);
+    _skipSamples = samplePos - _index[start].firstSample;
+    return seekFile(_file, _index[start].offset, SEEK_SET) == 0 ? 0 : AVERROR(errno);
+}
+
+// parse one packet and decode it, return 0 once the decoder is drained
+int StreamDecoder::decodeMore()
+{
+    if (_drained)
+    {
+        return 0;
+    }
+
+    // keep enough input for the parser to find a whole frame
+    if (_readSize < RefillThresh && !_eof)
+    {
+        memmove(_input.data(), _data, _readSize);
+        _data = _input.data();
+        _readSize += fread(_data + _readSize, 1, BufferSize - _readSize, _file);
+        _eof = feof(_file) != 0;
+        if (ferror(_file))
+        {
+            return AVERROR(EIO);
+        }
+    }
+
+    // empty input flushes the parser, then the decoder
+    auto ret = av_parser_parse2(_parser, _decCtx, &_pkt->data, &_pkt->size,
+                                _data, (int)_readSize,
+                                AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+    if (ret < 0)
+    {
+        return ret;
+    }
+    _data += ret;
+    _readSize -= ret;
+
+    if (_pkt->size)
+    {
+        ret = sendPacket(_pkt);
+    }
+    else if (_readSize == 0 && _eof)
+    {
+        ret      = sendPacket(nullptr);
+        _drained = true;
+    }
+    return ret < 0 ? ret : 1;
+}
+
+int StreamDecoder::sendPacket(AVPacket* pkt)
+{
+    // skip corrupt packets like the players do
+    auto ret = avcodec_send_packet(_decCtx, pkt);
+    if (ret < 0)
+    {
+        return ret == AVERROR_INVALIDDATA ? 0 : ret;
+    }
+
+    while ((ret = avcodec_receive_frame(_decCtx, _frame)) >= 0)
+    {
+        ret = storeFrame(_frame);
+        av_frame_unref(_frame);
+        if (ret < 0)
+        {
+            return ret;
+        }
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+int StreamDecoder::storeFrame(const AVFrame* frame)
+{
+    auto fmt = (AVSampleFormat)frame->format;
+    if (av_get_packed_sample_fmt(fmt) != AV_SAMPLE_FMT_FLT)
+    {
+        return AVERROR(EINVAL);
+    }
+
+    // drop the pre-roll in front of the seek position
+    auto skipCount = (int)std::min<int64_t>(_skipSamples, frame->nb_samples);
+    auto count     = frame->nb_samples - skipCount;
+    _skipSamples  -= skipCount;
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    auto channelsNum = frame->ch_layout.nb_channels;
+    auto storeSize   = _pcm.size();
+    _pcm.resize(storeSize + (size_t)count * channelsNum * sizeof(float));
+
+    auto out = (float*)(_pcm.data() + storeSize);
+    if (av_sample_fmt_is_planar(fmt))
+    {
+        interleaveFloat((const float* const*)frame->extended_data, channelsNum, skipCount, count, out);
+    }
+    else
+    {
+        memcpy(out, (const float*)frame->data[0] + (size_t)skipCount * channelsNum,
+               (size_t)count * channelsNum * sizeof(float));
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "TeeTap.hpp"
+
+#include <algorithm>
+
+#include <string.h>
+
+//
+// PcmBlockPool
+//
+
+// Blocks come back here when the last sink releases them, so once the queues
+// are full a steady decode reuses their sample buffers. Only the small
+// shared_ptr control block is still allocated per block.
+class PcmBlockPool : public std::enable_shared_from_this<PcmBlockPool>
+{
+public:
+    std::shared_ptr<PcmBlock> acquire()
+    {
+        PcmBlock* block = nullptr;
+        {
+            std::lock_guard lock(_mutex);
+            if (!_free.empty())
+            {
+                block = _free.back().release();
+                _free.pop_back();
+            }
+        }
+        if (!block)
+        {
+            block = new PcmBlock;
+        }
+
+        return std::shared_ptr<PcmBlock>(block, [pool = shared_from_this()](PcmBlock* b) {
+            std::lock_guard lock(pool->_mutex);
+            pool->_free.emplace_back(b);
+        });
+    }
+
+private:
+    std::mutex                             _mutex;
+    std::vector<std::unique_ptr<PcmBlock>> _free;
+};
+
+//
+// TeeTap
+//
+
+TeeTap::TeeTap()
+    : _pool(std::make_shared<PcmBlockPool>())
+{
+}
+
+TeeTap::~TeeTap()
+{
+    for (auto& sink : _sinks)
+    {
+        {
+            std::lock_guard lock(sink->mutex);
+            sink->stop = true;
+        }
+        sink->itemCond.notify_one();
+        sink->thread.join();
+    }
+}
+
+int TeeTap::addSink(FrameTap* sink, size_t queueBlocks, OverflowPolicy policy)
+{
+    auto& added        = _sinks.emplace_back(std::make_unique<Sink>());
+    added->tap         = sink;
+    added->queueBlocks = std::max<size_t>(queueBlocks, 1);
+    added->policy      = policy;
+    added->thread      = std::thread([this, s = added.get()] { sinkLoop(*s); });
+    return (int)_sinks.size() - 1;
+}
+
+void TeeTap::begin(int sampleRate, int channelsNum)
+{
+    _channelsNum = channelsNum;
+    for (auto& sink : _sinks)
+    {
+        push(*sink, { nullptr, sampleRate, channelsNum, false });
+    }
+}
+
+void TeeTap::process(const float* const* channels, int samples)
+{
+    // the only copy, whatever the number of sinks
+    auto block = _pool->acquire();
+    block->samples.resize((size_t)samples * _channelsNum);
+    block->channels.resize(_channelsNum);
+    block->samplesNum = samples;
+    for (int ch = 0; ch < _channelsNum; ++ch)
+    {
+        auto plane = block->samples.data() + (size_t)ch * samples;
+        memcpy(plane, channels[ch], samples * sizeof(float));
+        block->channels[ch] = plane;
+    }
+
+    std::shared_ptr<const PcmBlock> shared = std::move(block);
+    for (auto& sink : _sinks)
+    {
+        push(*sink, { shared });
+    }
+}
+
+void TeeTap::end()
+{
+    for (auto& sink : _sinks)
+    {
+        push(*sink, { nullptr, 0, 0, true });
+    }
+}
+
+void TeeTap::abort()
+{
+    for (auto& sink : _sinks)
+    {
+        push(*sink, { nullptr, 0, 0, true, true });
+    }
+}
+
+void TeeTap::push(Sink& sink, Item item)
+{
+    std::unique_lock lock(sink.mutex);
+    if (item.block && sink.queuedBlocks >= sink.queueBlocks)
+    {
+        switch (sink.policy)
+        {
+        case OverflowPolicy::Block:
+            sink.spaceCond.wait(lock, [&] { return sink.queuedBlocks < sink.queueBlocks; });
+            break;
+
+        case OverflowPolicy::DropOldest:
+        {
+            auto oldest = std::find_if(sink.queue.begin(), sink.queue.end(), [](const Item& i) { return i.block; });
+            sink.queue.erase(oldest);
+            --sink.queuedBlocks;
+            ++sink.stats.dropped;
+            break;
+        }
+
+        case OverflowPolicy::DropNewest:
+            ++sink.stats.dropped;
+            return;
+        }
+    }
+
+    if (item.block)
+    {
+        ++sink.queuedBlocks;
+        sink.stats.maxQueued = std::max<int64_t>(sink.stats.maxQueued, sink.queuedBlocks);
+    }
+    sink.queue.push_back(std::move(item));
+    lock.unlock();
+    sink.itemCond.notify_one();
+}
+
+void TeeTap::sinkLoop(Sink& sink)
+{
+    std::unique_lock lock(sink.mutex);
+    while (true)
+    {
+        sink.itemCond.wait(lock, [&] { return sink.stop || !sink.queue.empty(); });
+        if (sink.queue.empty())
+        {
+            return; // stopped
+        }
+
+        auto item    = std::move(sink.queue.front());
+        auto isBlock = item.block != nullptr;
+        sink.queue.pop_front();
+        if (isBlock)
+        {
+            --sink.queuedBlocks;
+        }
+        sink.isBusy = true;
+        lock.unlock();
+        sink.spaceCond.notify_all();
+
+        if (isBlock)
+        {
+            sink.tap->process(item.block->channels.data(), item.block->samplesNum);
+        }
+        else if (item.isAborted)
+        {
+            sink.tap->abort();
+        }
+        else if (item.isEnd)
+        {
+            sink.tap->end();
+        }
+        else
+        {
+            sink.tap->begin(item.sampleRate, item.channelsNum);
+        }
+        item.block.reset(); // back to the pool outside the lock
+
+        lock.lock();
+        sink.isBusy = false;
+        if (isBlock)
+        {
+            ++sink.stats.blocks;
+        }
+        if (sink.queue.empty())
+        {
+            sink.spaceCond.notify_all(); // for drain()
+        }
+    }
+}
+
+void TeeTap::drain()
+{
+    for (auto& sink : _sinks)
+    {
+        std::unique_lock lock(sink->mutex);
+        sink->spaceCond.wait(lock, [&] { return sink->queue.empty() && !sink->isBusy; });
+    }
+}
+
+TeeSinkStats TeeTap::stats(int sink) const
+{
+    std::lock_guard lock(_sinks[sink]->mutex);
+    return _sinks[sink]->stats;
+}
@@ -0,0 +1,379 @@
+#include "TempoAnalyzer.hpp"
+#include "Spectral.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include <string.h>
+
+constexpr float Compression       = 100.0f; // band value is log(1 + Compression * magnitude)
+constexpr float PeakWindowSeconds = 0.03f;  // an onset is the largest flux within this on each side,
+constexpr float MeanWindowSeconds = 0.1f;   // above the local mean, from this much before it
+constexpr float PeakDelta         = 0.3f;   // by this many standard deviations,
+constexpr float MinOnsetGap       = 0.03f;  // and this many seconds after the previous one
+constexpr float PriorBpm          = 120.0f; // center of the tempo weighting
+constexpr float PriorOctaves      = 1.0f;   // its standard deviation
+constexpr int   PeriodMultiples   = 4;      // autocorrelation peaks fitted to refine the beat period
+
+//
+// FluxWorkspace
+//
+
+// Transform, scratch and band layout for one set of options and sample rate.
+// Every decoding thread keeps them, so a batch sets up the transform once per
+// worker instead of once per track.
+struct FluxWorkspace
+{
+    int users = 0; // analyzers between begin() and end(), only an unused one is set up again
+
+    RealFft            fft;
+    std::vector<float> window;
+    std::vector<int>   bandBins; // bandsNum + 1 bin edges
+    float              magnitudeScale = 0;
+
+    TempoOptions options    = {};
+    int          sampleRate = 0;
+
+    bool matches(const TempoOptions& o, int rate) const
+    {
+        return fft.isReady() && rate == sampleRate && o.fftSize == options.fftSize && o.bandsNum == options.bandsNum &&
+               o.minFrequency == options.minFrequency && o.maxFrequency == options.maxFrequency;
+    }
+
+    int setup(const TempoOptions& o, int rate)
+    {
+        if (matches(o, rate))
+        {
+            return 0;
+        }
+        if (auto ret = fft.init(o.fftSize); ret < 0)
+        {
+            return ret;
+        }
+
+        // Hann, scaled so a full scale sine has magnitude 1
+        window           = hannWindow(o.fftSize);
+        double windowSum = 0;
+        for (auto w : window)
+        {
+            windowSum += w;
+        }
+        magnitudeScale = (float)(2 / windowSum);
+
+        bandBins = logBandBins(o.fftSize, rate, o.bandsNum, o.minFrequency, o.maxFrequency);
+
+        options    = o;
+        sampleRate = rate;
+        return 0;
+    }
+};
+
+// Analyzers with other options may be live on the same thread, as the taps of
+// one decode, so a workspace in use is shared only when it matches and never
+// set up again. Workspaces are allocated one by one to keep their addresses.
+static thread_local std::vector<std::unique_ptr<FluxWorkspace>> threadWorkspaces;
+
+static FluxWorkspace* acquireWorkspace(const TempoOptions& options, int sampleRate, int& error)
+{
+    auto& workspaces = threadWorkspaces;
+    auto  found      = std::find_if(workspaces.begin(), workspaces.end(),
+                                    [&](auto& w) { return w->matches(options, sampleRate); });
+    if (found == workspaces.end())
+    {
+        found = std::find_if(workspaces.begin(), workspaces.end(), [](auto& w) { return w->users == 0; });
+    }
+    if (found == workspaces.end())
+    {
+        found = workspaces.insert(workspaces.end(), std::make_unique<FluxWorkspace>());
+    }
+
+    if ((error = (*found)->setup(options, sampleRate)) < 0)
+    {
+        return nullptr;
+    }
+    ++(*found)->users;
+    return found->get();
+}
+
+//
+// TempoAnalyzer
+//
+
+TempoAnalyzer::TempoAnalyzer(const TempoOptions& options) : _options(options)
+{
+    _options.fftSize  = std::max(16, _options.fftSize);
+    _options.hopSize  = std::clamp(_options.hopSize, 1, _options.fftSize);
+    _options.bandsNum = std::max(1, _options.bandsNum);
+    _options.minBpm   = std::max(1.0f, _options.minBpm);
+    _options.maxBpm   = std::max(_options.minBpm, _options.maxBpm);
+}
+
+void TempoAnalyzer::begin(int sampleRate, int channelsNum)
+{
+    _result              = {};
+    _result.envelopeRate = (float)sampleRate / _options.hopSize;
+    _channelsNum         = channelsNum;
+    _envelope.clear();
+
+    if (_workspace)
+    {
+        --_workspace->users;
+    }
+    if (!(_workspace = acquireWorkspace(_options, sampleRate, _error)))
+    {
+        return;
+    }
+
+    // the first window ends after hopSize samples
+    _history.assign(_options.fftSize, 0.0f);
+    _fill = _options.fftSize - _options.hopSize;
+    _previous.assign(_options.bandsNum, 0.0f);
+}
+
+void TempoAnalyzer::process(const float* const* channels, int samples)
+{
+    if (!_workspace)
+    {
+        return;
+    }
+
+    auto fftSize = _options.fftSize;
+    auto hopSize = _options.hopSize;
+    auto gain    = 1.0f / _channelsNum;
+    for (int offset = 0; offset < samples;)
+    {
+        auto count = std::min(samples - offset, fftSize - _fill);
+        auto mono  = _history.data() + _fill;
+        for (int i = 0; i < count; ++i)
+        {
+            mono[i] = channels[0][offset + i] * gain;
+        }
+        for (int ch = 1; ch < _channelsNum; ++ch)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                mono[i] += channels[ch][offset + i] * gain;
+            }
+        }
+        offset += count;
+        _fill  += count;
+
+        if (_fill == fftSize)
+        {
+            analyzeWindow();
+            memmove(_history.data(), _history.data() + hopSize, (fftSize - hopSize) * sizeof(float));
+            _fill = fftSize - hopSize;
+        }
+    }
+}
+
+void TempoAnalyzer::end()
+{
+    if (!_workspace)
+    {
+        return;
+    }
+    --_workspace->users;
+    _workspace = nullptr;
+
+    // only the result stays, a batch keeps one analyzer per track
+    std::vector<float>().swap(_history);
+    std::vector<float>().swap(_previous);
+
+    // running sums for the local means of both passes
+    std::vector<double> sums(_envelope.size() + 1, 0.0);
+    for (size_t n = 0; n < _envelope.size(); ++n)
+    {
+        sums[n + 1] = sums[n] + _envelope[n];
+    }
+
+    findOnsets(_envelope, sums);
+    estimateTempo(_envelope, sums);
+
+    if (_options.keepEnvelope)
+    {
+        _result.envelope = std::move(_envelope);
+    }
+    std::vector<float>().swap(_envelope);
+}
+
+void TempoAnalyzer::analyzeWindow()
+{
+    auto& workspace = *_workspace;
+    auto  fftSize   = _options.fftSize;
+
+    auto input = workspace.fft.input();
+    for (int i = 0; i < fftSize; ++i)
+    {
+        input[i] = _history[i] * workspace.window[i];
+    }
+    workspace.fft.transform();
+
+    auto  output = workspace.fft.output();
+    float flux   = 0;
+    for (int b = 0; b < _options.bandsNum; ++b)
+    {
+        float power = 0;
+        for (int bin = workspace.bandBins[b]; bin < workspace.bandBins[b + 1]; ++bin)
+        {
+            power += output[bin * 2] * output[bin * 2] + output[bin * 2 + 1] * output[bin * 2 + 1];
+        }
+        auto value   = std::log1p(Compression * workspace.magnitudeScale * std::sqrt(power));
+        flux        += std::max(0.0f, value - _previous[b]);
+        _previous[b] = value;
+    }
+    // nothing to compare the first window with
+    _envelope.push_back(_envelope.empty() ? 0.0f : flux);
+}
+
+// Peak picking after Dixon, "Onset Detection Revisited" (2006): a local
+// maximum that stands out from the mean before it, on the normalized envelope.
+void TempoAnalyzer::findOnsets(const std::vector<float>& envelope, const std::vector<double>& sums)
+{
+    auto size = (int)envelope.size();
+    if (size == 0)
+    {
+        return;
+    }
+
+    double mean     = sums[size] / size;
+    double variance = 0;
+    for (auto value : envelope)
+    {
+        variance += (value - mean) * (value - mean);
+    }
+    auto deviation = std::sqrt(variance / size);
+    if (deviation == 0)
+    {
+        return;
+    }
+
+    auto rate       = _result.envelopeRate;
+    auto peakWindow = std::max(1, (int)std::lround(PeakWindowSeconds * rate));
+    auto meanWindow = std::max(1, (int)std::lround(MeanWindowSeconds * rate));
+    auto minGap     = std::max(1, (int)std::lround(MinOnsetGap * rate));
+    auto threshold  = PeakDelta * deviation;
+
+    // window n covers the samples up to (n + 1) * hopSize, the onset is placed at its middle
+    auto hopSize    = (int64_t)_options.hopSize;
+    auto halfWindow = (int64_t)_options.fftSize / 2;
+
+    int last = -minGap;
+    for (int n = 0; n < size; ++n)
+    {
+        auto from = std::max(0, n - peakWindow);
+        auto to   = std::min(size, n + peakWindow + 1);
+        if (n - last < minGap || *std::max_element(envelope.begin() + from, envelope.begin() + to) != envelope[n])
+        {
+            continue;
+        }
+
+        auto meanFrom  = std::max(0, n - meanWindow);
+        auto localMean = (sums[to] - sums[meanFrom]) / (to - meanFrom);
+        if (envelope[n] >= localMean + threshold)
+        {
+            _result.onsets.push_back(std::max<int64_t>(0, (n + 1) * hopSize - halfWindow));
+            last = n;
+        }
+    }
+}
+
+// Autocorrelation of the envelope less its local mean and rectified, weighted
+// by a log normal around PriorBpm (Ellis, "Beat Tracking by Dynamic
+// Programming", 2007). The period is refined between lags by a parabola
+// through each of the peaks at its first PeriodMultiples multiples.
+void TempoAnalyzer::estimateTempo(const std::vector<float>& envelope, const std::vector<double>& sums)
+{
+    auto rate   = _result.envelopeRate;
+    auto size   = (int)envelope.size();
+    auto minLag = std::max(1, (int)std::floor(rate * 60 / _options.maxBpm));
+    auto maxLag = (int)std::ceil(rate * 60 / _options.minBpm);
+    if (size < 2 * (maxLag + 2))
+    {
+        return;
+    }
+
+    auto meanWindow = std::max(1, (int)std::lround(MeanWindowSeconds * rate));
+
+    std::vector<float> detrended(size);
+    for (int n = 0; n < size; ++n)
+    {
+        auto from    = std::max(0, n - meanWindow);
+        auto to      = std::min(size, n + meanWindow + 1);
+        detrended[n] = std::max(0.0f, envelope[n] - (float)((sums[to] - sums[from]) / (to - from)));
+    }
+
+    // computed on demand, -1 until then
+    std::vector<double> correlations(std::max(maxLag + 2, std::min(size / 2, PeriodMultiples * (maxLag + 1))), -1.0);
+    auto at = [&](int lag)
+    {
+        if (correlations[lag] < 0)
+        {
+            double sum = 0;
+            for (int n = 0; n + lag < size; ++n)
+            {
+                sum += detrended[n] * detrended[n + lag];
+            }
+            correlations[lag] = sum / (size - lag);
+        }
+        return correlations[lag];
+    };
+
+    auto energy = at(0);
+    if (energy == 0)
+    {
+        return;
+    }
+
+    auto   priorLag  = rate * 60 / PriorBpm;
+    int    bestLag   = minLag;
+    double bestScore = -1;
+    for (int lag = minLag; lag <= maxLag; ++lag)
+    {
+        auto octaves = std::log2(lag / priorLag) / PriorOctaves;
+        auto score   = at(lag) * std::exp(-0.5 * octaves * octaves);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestLag   = lag;
+        }
+    }
+
+    // climb to the peak nearest to lag, then place it between lags
+    auto lastLag = (int)correlations.size() - 2;
+    auto refine  = [&](int lag)
+    {
+        while (lag < lastLag && at(lag + 1) > at(lag))
+        {
+            ++lag;
+        }
+        while (lag > 1 && at(lag - 1) > at(lag))
+        {
+            --lag;
+        }
+        auto before = at(lag - 1);
+        auto after  = at(lag + 1);
+        auto curve  = before - 2 * at(lag) + after;
+        return curve < 0 ? lag + std::clamp(0.5 * (before - after) / curve, -0.5, 0.5) : (double)lag;
+    };
+
+    // least squares fit of k * period to the peak near each multiple k
+    auto period = refine(bestLag);
+    auto fitSum = period;
+    auto kSum   = 1.0;
+    for (int k = 2; k <= PeriodMultiples; ++k)
+    {
+        auto lag = (int)std::lround(k * period);
+        if (lag > lastLag)
+        {
+            break;
+        }
+        fitSum += k * refine(lag);
+        kSum   += k * k;
+    }
+    period = fitSum / kSum;
+
+    _result.bpm        = (float)(rate * 60 / period);
+    _result.confidence = (float)std::clamp(at((int)std::lround(period)) / energy, 0.0, 1.0);
+}
@@ -0,0 +1,166 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+// which pool and worker the current thread belongs to
+static thread_local ThreadPool* t_pool        = nullptr;
+static thread_local size_t      t_workerIndex = 0;
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    threadCount = std::max<size_t>(threadCount, 1);
+
+    _workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        _workers.emplace_back(std::make_unique<Worker>());
+    }
+
+    // start threads after all deques exist, workers steal from each other
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        _workers[i]->thread = std::thread(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(_sleepMutex);
+        _stop = true;
+    }
+    _sleepCond.notify_all();
+
+    for (auto& worker : _workers)
+    {
+        worker->thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(Task task)
+{
+    // Tasks submitted from a worker stay on its own deque (hot in cache),
+    // others are spread round-robin.
+    auto index = t_pool == this ? t_workerIndex
+                                : _nextQueue.fetch_add(1, std::memory_order_relaxed) % _workers.size();
+
+    // count the task before it can be popped, a worker decrements right after popping
+    {
+        std::lock_guard sleepLock(_sleepMutex);
+        ++_pendingCount;
+
+        std::lock_guard lock(_workers[index]->mutex);
+        _workers[index]->tasks.push_back(std::move(task));
+    }
+    _sleepCond.notify_one();
+}
+
+bool ThreadPool::popTask(size_t index, Task& task)
+{
+    // own deque, newest first
+    {
+        auto& self = *_workers[index];
+        std::lock_guard lock(self.mutex);
+        if (!self.tasks.empty())
+        {
+            task = std::move(self.tasks.back());
+            self.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // steal oldest task of other workers
+    for (size_t i = 1; i < _workers.size(); ++i)
+    {
+        auto& victim = *_workers[(index + i) % _workers.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index)
+{
+    t_pool        = this;
+    t_workerIndex = index;
+
+    Task task;
+    while (true)
+    {
+        if (popTask(index, task))
+        {
+            --_pendingCount;
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock lock(_sleepMutex);
+        _sleepCond.wait(lock, [this] { return _stop || _pendingCount > 0; });
+        if (_stop && _pendingCount == 0)
+        {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallelFor(int count, int maxSlots, const Job& job)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    // Helpers may still be queued after the last job is done,
+    // so the shared state must outlive this call.
+    struct State
+    {
+        Job                     job;
+        int                     count;
+        std::atomic<int>        nextJob  = 0;
+        std::atomic<int>        doneJobs = 0;
+        std::atomic<int>        nextSlot = 1; // slot 0 is the caller
+        std::mutex              mutex;
+        std::condition_variable doneCond;
+    };
+
+    auto state   = std::make_shared<State>();
+    state->job   = job;
+    state->count = count;
+
+    auto run = [](State& s, int slot)
+    {
+        for (int i = s.nextJob++; i < s.count; i = s.nextJob++)
+        {
+            s.job(i, slot);
+            if (++s.doneJobs == s.count)
+            {
+                std::lock_guard lock(s.mutex);
+                s.doneCond.notify_all();
+            }
+        }
+    };
+
+    auto helperCount = std::min({ count, maxSlots, (int)_workers.size() + 1 }) - 1;
+    for (int i = 0; i < helperCount; ++i)
+    {
+        submit([state, run] { run(*state, state->nextSlot++); });
+    }
+
+    run(*state, 0);
+
+    std::unique_lock lock(state->mutex);
+    state->doneCond.wait(lock, [&] { return state->doneJobs == count; });
+}
@@ -0,0 +1,349 @@
+extern "C"
+{
+#include <libavutil/file.h>
+}
+
+#include "WaveformPeaks.hpp"
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <stdio.h>
+#include <string.h>
+
+//
+// Sidecar Layout
+//
+// PeaksHeader, PeaksLevel * levelCount, then the bins of every level,
+// PeakBin[binCount][channelsNum].
+//
+
+constexpr char     PeaksMagic[4] = { 'W', 'F', 'P', 'K' };
+constexpr uint32_t PeaksVersion  = 1;
+
+struct PeaksHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t sampleRate;
+    uint32_t channelsNum;
+    uint64_t totalSamples;
+    uint32_t levelCount;
+    uint32_t reserved;
+};
+
+struct PeaksLevel
+{
+    uint64_t binSize;
+    uint64_t binCount;
+    uint64_t offset; // from file start
+};
+
+constexpr float Infinity       = std::numeric_limits<float>::infinity();
+constexpr int   DefaultBinSize = 256; // when no valid bin size is given
+
+// Fold samples into accumulator.
+static void reduceSamples(const float* x, int samples, auto& acc)
+{
+    auto   min = acc.min;
+    auto   max = acc.max;
+    double sum = 0;
+    int    i   = 0;
+
+#ifdef HAS_SSE2
+    if (samples >= 4)
+    {
+        auto min4 = _mm_set1_ps(min);
+        auto max4 = _mm_set1_ps(max);
+        auto sum4 = _mm_setzero_ps();
+        for (; i + 4 <= samples; i += 4)
+        {
+            auto v = _mm_loadu_ps(x + i);
+            min4   = _mm_min_ps(min4, v);
+            max4   = _mm_max_ps(max4, v);
+            sum4   = _mm_add_ps(sum4, _mm_mul_ps(v, v));
+        }
+
+        alignas(16) float lanes[3][4];
+        _mm_store_ps(lanes[0], min4);
+        _mm_store_ps(lanes[1], max4);
+        _mm_store_ps(lanes[2], sum4);
+        min = std::min({ lanes[0][0], lanes[0][1], lanes[0][2], lanes[0][3] });
+        max = std::max({ lanes[1][0], lanes[1][1], lanes[1][2], lanes[1][3] });
+        sum = (double)lanes[2][0] + lanes[2][1] + lanes[2][2] + lanes[2][3];
+    }
+#endif
+
+    for (; i < samples; ++i)
+    {
+        min  = std::min(min, x[i]);
+        max  = std::max(max, x[i]);
+        sum += x[i] * x[i];
+    }
+
+    acc.min           = min;
+    acc.max           = max;
+    acc.sumOfSquares += sum;
+    acc.count        += samples;
+}
+
+WaveformBuilder::WaveformBuilder(std::vector<int> binSizes)
+{
+    // an empty bin would never close, process() needs at least one level
+    std::erase_if(binSizes, [](int binSize) { return binSize <= 0; });
+    if (binSizes.empty())
+    {
+        binSizes = { DefaultBinSize };
+    }
+
+    // a level closes a bin after a whole number of bins of the one before,
+    // so every size is rounded up to a multiple of its predecessor
+    std::sort(binSizes.begin(), binSizes.end());
+    for (auto binSize : binSizes)
+    {
+        int64_t size = binSize;
+        if (!_levels.empty())
+        {
+            auto previous = _levels.back().binSize;
+            size          = (size + previous - 1) / previous * previous;
+            if (size == previous)
+            {
+                continue;
+            }
+        }
+        auto& level   = _levels.emplace_back();
+        level.binSize = size;
+    }
+}
+
+void WaveformBuilder::begin(int sampleRate, int channelsNum)
+{
+    _sampleRate   = sampleRate;
+    _channelsNum  = channelsNum;
+    _totalSamples = 0;
+
+    for (auto& level : _levels)
+    {
+        level.fill = 0;
+        level.accumulators.assign(channelsNum, Accumulator{ Infinity, -Infinity, 0, 0 });
+        level.bins.clear();
+    }
+}
+
+void WaveformBuilder::process(const float* const* channels, int samples)
+{
+    auto& finest = _levels[0];
+
+    // split at finest bin boundaries
+    for (int offset = 0; offset < samples;)
+    {
+        auto count = (int)std::min<int64_t>(samples - offset, finest.binSize - finest.fill);
+        for (int ch = 0; ch < _channelsNum; ++ch)
+        {
+            reduceSamples(channels[ch] + offset, count, finest.accumulators[ch]);
+        }
+
+        offset      += count;
+        finest.fill += count;
+        if (finest.fill == finest.binSize)
+        {
+            closeBin(0);
+        }
+    }
+
+    _totalSamples += samples;
+}
+
+void WaveformBuilder::closeBin(size_t index)
+{
+    auto& level = _levels[index];
+    auto  next  = index + 1 < _levels.size() ? &_levels[index + 1] : nullptr;
+
+    for (auto& acc : level.accumulators)
+    {
+        level.bins.push_back(PeakBin{ acc.min, acc.max, (float)std::sqrt(acc.sumOfSquares / acc.count) });
+
+        if (next)
+        {
+            auto& parent = next->accumulators[&acc - level.accumulators.data()];
+            parent.min           = std::min(parent.min, acc.min);
+            parent.max           = std::max(parent.max, acc.max);
+            parent.sumOfSquares += acc.sumOfSquares;
+            parent.count        += acc.count;
+        }
+
+        acc = Accumulator{ Infinity, -Infinity, 0, 0 };
+    }
+
+    if (next)
+    {
+        next->fill += level.fill;
+        if (next->fill == next->binSize)
+        {
+            closeBin(index + 1);
+        }
+    }
+    level.fill = 0;
+}
+
+void WaveformBuilder::end()
+{
+    // close the last partial bins, each one feeds the next level
+    for (size_t i = 0; i < _levels.size(); ++i)
+    {
+        if (_levels[i].fill > 0)
+        {
+            closeBin(i);
+        }
+    }
+}
+
+bool WaveformBuilder::save(const char* filename) const
+{
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    PeaksHeader header = {};
+    memcpy(header.magic, PeaksMagic, sizeof(PeaksMagic));
+    header.version      = PeaksVersion;
+    header.sampleRate   = _sampleRate;
+    header.channelsNum  = _channelsNum;
+    header.totalSamples = _totalSamples;
+    header.levelCount   = (uint32_t)_levels.size();
+
+    std::vector<PeaksLevel> table;
+    uint64_t offset = sizeof(PeaksHeader) + sizeof(PeaksLevel) * _levels.size();
+    for (auto& level : _levels)
+    {
+        table.push_back(PeaksLevel{ (uint64_t)level.binSize, level.bins.size() / _channelsNum, offset });
+        offset += level.bins.size() * sizeof(PeakBin);
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(table.data(), sizeof(PeaksLevel), table.size(), file) == table.size();
+    for (auto& level : _levels)
+    {
+        ok = ok && fwrite(level.bins.data(), sizeof(PeakBin), level.bins.size(), file) == level.bins.size();
+    }
+
+    return fclose(file) == 0 && ok;
+}
+
+WaveformPeaks::~WaveformPeaks()
+{
+    close();
+}
+
+bool WaveformPeaks::open(const char* filename)
+{
+    close();
+
+    if (av_file_map(filename, &_fileBuffer, &_fileSize, 0, nullptr) < 0)
+    {
+        _fileBuffer = nullptr;
+        return false;
+    }
+
+    auto header = (const PeaksHeader*)_fileBuffer;
+    if (_fileSize < sizeof(PeaksHeader) ||
+        memcmp(header->magic, PeaksMagic, sizeof(PeaksMagic)) != 0 ||
+        header->version != PeaksVersion ||
+        header->channelsNum == 0 ||
+        _fileSize < sizeof(PeaksHeader) + sizeof(PeaksLevel) * header->levelCount)
+    {
+        close();
+        return false;
+    }
+
+    _sampleRate   = header->sampleRate;
+    _channelsNum  = header->channelsNum;
+    _totalSamples = header->totalSamples;
+
+    auto table = (const PeaksLevel*)(_fileBuffer + sizeof(PeaksHeader));
+    auto binsSize = (uint64_t)_channelsNum * sizeof(PeakBin); // of one bin of every channel
+    for (uint32_t i = 0; i < header->levelCount; ++i)
+    {
+        // written so that a hostile table can't overflow the bounds check
+        if (table[i].binSize == 0 || table[i].binSize > INT64_MAX ||
+            table[i].offset > _fileSize || table[i].offset % alignof(PeakBin) != 0 ||
+            table[i].binCount > (_fileSize - table[i].offset) / binsSize)
+        {
+            close();
+            return false;
+        }
+        _levels.push_back(Level{ (int64_t)table[i].binSize, (int64_t)table[i].binCount,
+                                 (const PeakBin*)(_fileBuffer + table[i].offset) });
+    }
+
+    return !_levels.empty();
+}
+
+void WaveformPeaks::close()
+{
+    if (_fileBuffer)
+    {
+        av_file_unmap(_fileBuffer, _fileSize);
+        _fileBuffer = nullptr;
+        _fileSize   = 0;
+    }
+    _levels.clear();
+}
+
+void WaveformPeaks::query(int channel, int64_t startSample, int64_t endSample, std::span<PeakBin> columns) const
+{
+    if (columns.empty() || _levels.empty())
+    {
+        return;
+    }
+
+    startSample = std::clamp<int64_t>(startSample, 0, _totalSamples);
+    endSample   = std::clamp<int64_t>(endSample, startSample, _totalSamples);
+
+    // coarsest level still at or below one column
+    auto samplesPerColumn = (double)(endSample - startSample) / columns.size();
+    auto level            = &_levels[0];
+    for (auto& candidate : _levels)
+    {
+        if (candidate.binSize <= samplesPerColumn)
+        {
+            level = &candidate;
+        }
+    }
+
+    for (size_t column = 0; column < columns.size(); ++column)
+    {
+        auto beg = startSample + (int64_t)(samplesPerColumn * column);
+        auto end = startSample + (int64_t)(samplesPerColumn * (column + 1));
+
+        auto firstBin = std::min(beg / level->binSize, level->binCount);
+        auto lastBin  = std::min(std::max((end + level->binSize - 1) / level->binSize, firstBin + 1),
+                                 level->binCount);
+
+        PeakBin result  = { 0, 0, 0 };
+        double  squares = 0;
+        bool    hasBins = firstBin < lastBin;
+        if (hasBins)
+        {
+            result.min = Infinity;
+            result.max = -Infinity;
+        }
+        for (auto bin = firstBin; bin < lastBin; ++bin)
+        {
+            auto& peak  = level->bins[bin * _channelsNum + channel];
+            result.min  = std::min(result.min, peak.min);
+            result.max  = std::max(result.max, peak.max);
+            squares    += (double)peak.rms * peak.rms;
+        }
+        if (hasBins)
+        {
+            result.rms = (float)std::sqrt(squares / (lastBin - firstBin));
+        }
+
+        columns[column] = result;
+    }
+}
@@ -0,0 +1,142 @@
+#include "Xxh64.hpp"
+
+#include <string.h>
+
+constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+static uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+// little endian loads, as the reference implementation reads them
+static uint64_t read64(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t xxhRound(uint64_t acc, uint64_t input)
+{
+    acc += input * Prime2;
+    acc  = rotl(acc, 31);
+    return acc * Prime1;
+}
+
+static uint64_t mergeRound(uint64_t acc, uint64_t value)
+{
+    acc ^= xxhRound(0, value);
+    return acc * Prime1 + Prime4;
+}
+
+void Xxh64::reset(uint64_t seed)
+{
+    _seed       = seed;
+    _acc[0]     = seed + Prime1 + Prime2;
+    _acc[1]     = seed + Prime2;
+    _acc[2]     = seed;
+    _acc[3]     = seed - Prime1;
+    _totalSize  = 0;
+    _bufferSize = 0;
+}
+
+void Xxh64::update(const void* data, size_t size)
+{
+    auto p   = (const uint8_t*)data;
+    auto end = p + size;
+
+    _totalSize += size;
+
+    // not enough for a stripe yet
+    if (_bufferSize + size < 32)
+    {
+        memcpy(_buffer + _bufferSize, p, size);
+        _bufferSize += size;
+        return;
+    }
+
+    // complete the buffered stripe
+    if (_bufferSize)
+    {
+        auto fill = 32 - _bufferSize;
+        memcpy(_buffer + _bufferSize, p, fill);
+        p += fill;
+        for (int i = 0; i < 4; ++i)
+        {
+            _acc[i] = xxhRound(_acc[i], read64(_buffer + i * 8));
+        }
+        _bufferSize = 0;
+    }
+
+    // whole stripes straight from the input
+    uint64_t acc0 = _acc[0], acc1 = _acc[1], acc2 = _acc[2], acc3 = _acc[3];
+    for (; p + 32 <= end; p += 32)
+    {
+        acc0 = xxhRound(acc0, read64(p));
+        acc1 = xxhRound(acc1, read64(p + 8));
+        acc2 = xxhRound(acc2, read64(p + 16));
+        acc3 = xxhRound(acc3, read64(p + 24));
+    }
+    _acc[0] = acc0; _acc[1] = acc1; _acc[2] = acc2; _acc[3] = acc3;
+
+    memcpy(_buffer, p, end - p);
+    _bufferSize = end - p;
+}
+
+uint64_t Xxh64::digest() const
+{
+    uint64_t h;
+    if (_totalSize >= 32)
+    {
+        h = rotl(_acc[0], 1) + rotl(_acc[1], 7) + rotl(_acc[2], 12) + rotl(_acc[3], 18);
+        for (auto acc : _acc)
+        {
+            h = mergeRound(h, acc);
+        }
+    }
+    else
+    {
+        h = _seed + Prime5;
+    }
+    h += _totalSize;
+
+    // tail
+    auto p   = _buffer;
+    auto end = _buffer + _bufferSize;
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= xxhRound(0, read64(p));
+        h  = rotl(h, 27) * Prime1 + Prime4;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= read32(p) * Prime1;
+        h  = rotl(h, 23) * Prime2 + Prime3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        h ^= *p * Prime5;
+        h  = rotl(h, 11) * Prime1;
+    }
+
+    // avalanche
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file dsp chain benchmark
+ * @example benchDsp.cpp
+ *
+ * Decode a fixture, then run it through a DspChain in main.cpp's block size:
+ * a gain pushing it 6 dB hot and changing every BlocksPerGainChange blocks,
+ * a four stage EQ and the limiter. Report the cost of every effect in ns per
+ * sample, the real time factor of the chain and whether the limiter held the
+ * output below its threshold.
+ */
+
+#include "DspChain.hpp"
+#include "Fixtures.hpp"
+#include "StreamDecoder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include <stdio.h>
+
+constexpr int   StreamingBufferSize = 65536; // as main.cpp
+constexpr int   BlocksPerGainChange = 8;
+constexpr float ThresholdDb         = -1.0f;
+
+void benchDsp()
+{
+    auto path = fixturePath(FixtureDefault);
+
+    StreamDecoder decoder;
+    if (decoder.open(path.c_str()) < 0)
+    {
+        fprintf(stderr, "Could not open %s\n", path.c_str());
+        return;
+    }
+
+    std::vector<float> pcm((size_t)decoder.index().samplesNum() * decoder.channelsNum());
+    auto size = decoder.fill((uint8_t*)pcm.data(), (int)(pcm.size() * sizeof(float)));
+    if (size < 0)
+    {
+        fprintf(stderr, "Could not decode %s\n", path.c_str());
+        return;
+    }
+    auto channelsNum = decoder.channelsNum();
+    auto samplesNum  = size / decoder.blockAlign();
+    auto blockSize   = StreamingBufferSize / decoder.blockAlign();
+
+    SmoothedGain  gain(6.0f);
+    BiquadCascade eq;
+    eq.addStage(BiquadType::HighPass,  30,    0.707f);
+    eq.addStage(BiquadType::LowShelf,  120,   0.707f, 3.0f);
+    eq.addStage(BiquadType::Peaking,   2500,  1.0f,  -2.0f);
+    eq.addStage(BiquadType::HighShelf, 10000, 0.707f, 2.0f);
+    Limiter limiter(ThresholdDb);
+
+    DspChain chain;
+    chain.add(&gain);
+    chain.add(&eq);
+    chain.add(&limiter);
+    chain.prepare(decoder.sampleRate(), channelsNum, blockSize);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int offset = 0, block = 0; offset < samplesNum; offset += blockSize, ++block)
+    {
+        if (block % BlocksPerGainChange == 0)
+        {
+            gain.setGainDb(block / BlocksPerGainChange % 2 ? 3.0f : 6.0f);
+        }
+        chain.process(pcm.data() + (size_t)offset * channelsNum, std::min(blockSize, samplesNum - offset));
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    float peak = 0;
+    for (int i = 0; i < samplesNum * channelsNum; ++i)
+    {
+        peak = std::max(peak, std::fabs(pcm[i]));
+    }
+
+    printf("%d Hz, %d channels, %d samples per block\n", decoder.sampleRate(), channelsNum, blockSize);
+    printf("%-10s %12s\n", "effect", "ns/sample");
+    for (auto& cost : chain.costs())
+    {
+        printf("%-10s %12.2f\n", cost.name, cost.nsPerSample);
+    }
+    printf("chain: %.0fx real time, latency %d samples\n",
+           (double)samplesNum / decoder.sampleRate() / seconds, chain.latencySamples());
+    printf("peak %.2f dBFS, threshold %.2f dBFS, deepest gain reduction %.2f dB\n",
+           20 * std::log10(std::max(peak, 1e-9f)), ThresholdDb, 20 * std::log10(limiter.minGain()));
+}
@@ -0,0 +1,129 @@
+/**
+ * @file multi-stream mixing benchmark
+ * @example benchMixer.cpp
+ *
+ * Mix growing numbers of streams of a fixture on one thread with Mixer,
+ * every stream at its own position, gain and pan. For each count, report
+ * how much faster than real time the mix runs and so how many such streams
+ * fit in real time on one core:
+ * - decode and mix, every stream a StreamDecoder
+ * - mix only, every stream replaying audio decoded beforehand
+ */
+
+#include "Fixtures.hpp"
+#include "Mixer.hpp"
+#include "StreamDecoder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+constexpr int    MixBlockSamples = 1024;
+constexpr double MixSeconds      = 5.0;
+constexpr int    StreamCounts[]  = { 1, 16, 64, 256 };
+constexpr double StaggerSeconds  = 0.37; // between stream start positions
+
+static void exitIf(bool b, std::string_view msg)
+{
+    if (b)
+    {
+        fprintf(stderr, "%s\n", msg.data());
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Loops over audio decoded beforehand, so only the mixing is timed.
+class MemorySource : public MixerSource
+{
+public:
+    MemorySource(const std::vector<float>& pcm, int sampleRate, int channelsNum, int64_t start)
+        : _pcm(pcm), _sampleRate(sampleRate), _channelsNum(channelsNum)
+        , _samplesNum((int64_t)pcm.size() / channelsNum), _position(start % _samplesNum) {}
+
+    int sampleRate()  const override { return _sampleRate; }
+    int channelsNum() const override { return _channelsNum; }
+
+    int read(float* out, int samples) override
+    {
+        auto count = (int)std::min<int64_t>(samples, _samplesNum - _position);
+        memcpy(out, _pcm.data() + _position * _channelsNum, (size_t)count * _channelsNum * sizeof(float));
+        _position = (_position + count) % _samplesNum;
+        return count;
+    }
+
+private:
+    const std::vector<float>& _pcm;
+    int                       _sampleRate;
+    int                       _channelsNum;
+    int64_t                   _samplesNum;
+    int64_t                   _position;
+};
+
+// Mix MixSeconds of sources, return times faster than real time.
+static double runMix(int sampleRate, std::vector<MixerSource*> sources)
+{
+    Mixer mixer(sampleRate, MixBlockSamples);
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        auto pan = sources.size() > 1 ? -1.0f + 2.0f * i / (sources.size() - 1) : 0.0f;
+        exitIf(mixer.add(sources[i], 1.0f / sources.size(), pan) < 0, "Could not add a stream");
+    }
+
+    std::vector<float> out((size_t)MixBlockSamples * 2);
+    auto               blocksNum = (int)(MixSeconds * sampleRate / MixBlockSamples);
+    auto               start     = std::chrono::steady_clock::now();
+    for (int i = 0; i < blocksNum; ++i)
+    {
+        exitIf(mixer.mix(out.data()) < (int)sources.size(), "A stream ended early");
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (double)blocksNum * MixBlockSamples / sampleRate / seconds;
+}
+
+void benchMixer()
+{
+    auto path = fixturePath(FixtureDefault);
+
+    StreamDecoder reference;
+    exitIf(reference.open(path.c_str()) < 0, "Could not open the fixture");
+    auto sampleRate  = reference.sampleRate();
+    auto channelsNum = reference.channelsNum();
+    auto stagger     = (int64_t)(StaggerSeconds * sampleRate);
+
+    std::vector<float> pcm((size_t)reference.index().samplesNum() * channelsNum);
+    auto               size = reference.fill((uint8_t*)pcm.data(), (int)(pcm.size() * sizeof(float)));
+    exitIf(size <= 0, "Could not decode the fixture");
+    pcm.resize(size / sizeof(float));
+
+    // every decoding stream must last MixSeconds from its start
+    auto startSpan = (int64_t)(pcm.size() / channelsNum) - (int64_t)(MixSeconds * sampleRate) - MixBlockSamples;
+    exitIf(startSpan <= 0, "The fixture is too short");
+
+    printf("%8s %14s %14s %14s %14s\n", "streams", "decode x rt", "streams/core", "mix x rt", "streams/core");
+    for (auto streamsNum : StreamCounts)
+    {
+        std::vector<std::unique_ptr<StreamDecoder>>       decoders;
+        std::vector<std::unique_ptr<StreamDecoderSource>> decoderSources;
+        std::vector<std::unique_ptr<MemorySource>>        memorySources;
+        std::vector<MixerSource*>                         decoding, replaying;
+        for (int i = 0; i < streamsNum; ++i)
+        {
+            auto  start   = i * stagger % startSpan;
+            auto& decoder = decoders.emplace_back(std::make_unique<StreamDecoder>());
+            exitIf(decoder->open(path.c_str()) < 0 || decoder->seek(start) < 0, "Could not open a stream");
+            decoding.push_back(decoderSources.emplace_back(std::make_unique<StreamDecoderSource>(*decoder)).get());
+            replaying.push_back(memorySources.emplace_back(
+                std::make_unique<MemorySource>(pcm, sampleRate, channelsNum, start)).get());
+        }
+
+        auto decodeFactor = runMix(sampleRate, decoding);
+        auto mixFactor    = runMix(sampleRate, replaying);
+        printf("%8d %14.1f %14.0f %14.1f %14.0f\n", streamsNum,
+               decodeFactor, decodeFactor * streamsNum, mixFactor, mixFactor * streamsNum);
+    }
+}
@@ -0,0 +1,103 @@
+/**
+ * @file generator pipeline benchmark
+ * @example benchPipeline.cpp
+ *
+ * Decode a fixture into output blocks of testStreamPlay's buffer sizes, with
+ * the hand-written loop of StreamDecoder::fill() and with the generator stages
+ * of DecodePipeline, and report the time of each, the pipeline overhead and
+ * whether both hand out the same bytes. The frame index StreamDecoder builds
+ * on open is left out of its time.
+ */
+
+#include "DecodePipeline.hpp"
+#include "Fixtures.hpp"
+#include "StreamDecoder.hpp"
+#include "Xxh64.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <stdio.h>
+
+constexpr int BlockSizes[] = { 4096, 65536 };
+constexpr int Runs         = 5;
+
+struct RunResult
+{
+    double   ms;
+    uint64_t hash;
+    bool     ok;
+};
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static RunResult runLoop(const char* filename, int blockSize)
+{
+    StreamDecoder decoder;
+    if (decoder.open(filename) < 0)
+    {
+        return { 0, 0, false };
+    }
+
+    std::vector<uint8_t> block(blockSize);
+    Xxh64                hash;
+    int                  size;
+
+    auto start = std::chrono::steady_clock::now();
+    while ((size = decoder.fill(block.data(), blockSize)) > 0)
+    {
+        hash.update(block.data(), size);
+    }
+    return { msSince(start), hash.digest(), size == 0 };
+}
+
+static RunResult runPipeline(const char* filename, int blockSize)
+{
+    Xxh64 hash;
+    int   error = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto block : decodeBlocks(filename, blockSize, error))
+    {
+        hash.update(block.data(), block.size());
+    }
+    return { msSince(start), hash.digest(), error == 0 };
+}
+
+// fastest of Runs
+template <typename Run>
+static RunResult best(Run run)
+{
+    auto result = run();
+    for (int i = 1; i < Runs && result.ok; ++i)
+    {
+        auto next  = run();
+        result.ms  = std::min(result.ms, next.ms);
+        result.ok &= next.ok && next.hash == result.hash;
+    }
+    return result;
+}
+
+void benchPipeline()
+{
+    auto path = fixturePath(FixtureDefault);
+
+    printf("%8s %10s %12s %10s %6s\n", "block", "loop ms", "pipeline ms", "overhead", "same");
+    for (auto blockSize : BlockSizes)
+    {
+        auto loop     = best([&] { return runLoop(path.c_str(), blockSize); });
+        auto pipeline = best([&] { return runPipeline(path.c_str(), blockSize); });
+        if (!loop.ok || !pipeline.ok)
+        {
+            fprintf(stderr, "Could not decode %s\n", path.c_str());
+            return;
+        }
+
+        printf("%8d %10.2f %12.2f %9.1f%% %6s\n", blockSize, loop.ms, pipeline.ms,
+               (pipeline.ms / loop.ms - 1) * 100, loop.hash == pipeline.hash ? "yes" : "no");
+    }
+}
@@ -0,0 +1,500 @@
+/**
+ * @file playback latency benchmark
+ * @example benchPlayback.cpp
+ *
+ * Drive the streaming player of testStreamPlay.cpp (StreamDecoder and
+ * MaxBufferCount rotating buffers of StreamingBufferSize bytes) against a sink
+ * that plays on a fixed clock instead of an audio device. For each buffer
+ * setting, with and without busy threads competing for the cores, report:
+ * - time from play to the first submitted block and to the first audible tick
+ * - time from seek to the first audible tick, marked * above SeekTargetMs
+ * - steady state output latency, from submit to start of playing, and its jitter
+ * - underruns, ticks the sink could not fill
+ *
+ * Startup is also timed apart, from open to the first decoded frame, for
+ * main.cpp's full probe against FastStartInput.
+ */
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/file.h>
+}
+
+#include "DecoderSetup.hpp"
+#include "FastStart.hpp"
+#include "Fixtures.hpp"
+#include "StreamDecoder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int    TickMs           = 10;  // device period
+constexpr double PlaySeconds      = 3.0; // decoded before the seek
+constexpr double SeekFraction     = 0.5;
+constexpr double AfterSeekSeconds = 1.0;
+constexpr double SeekTargetMs     = 20.0; // local files
+
+struct BufferSetting
+{
+    int streamingBufferSize;
+    int maxBufferCount;
+};
+
+constexpr BufferSetting BufferSettings[] =
+{
+    { 4096, 2 }, { 4096, 3 }, { 16384, 3 }, { 65536, 3 },
+};
+
+// busy threads per hardware thread
+constexpr int ContentionFactors[] = { 0, 1, 2 };
+
+constexpr int StartupRuns = 20;
+
+struct PlaybackStats
+{
+    double firstBlockMs;
+    double firstAudioMs;
+    double seekMs;
+    double latencyMs; // mean of the steady state
+    double jitterMs;  // standard deviation of the latency
+    int    underruns;
+};
+
+static void exitIf(bool b, std::string_view msg)
+{
+    if (b)
+    {
+        fprintf(stderr, "%s\n", msg.data());
+        exit(EXIT_FAILURE);
+    }
+}
+
+static double toMs(Clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+//
+// Sink
+//
+
+// Stands in for the source voice: every TickMs it plays one period of bytes
+// from the queued blocks, on an absolute schedule, so a late tick never
+// shifts the following ones and each run sees the same clock.
+class ClockedSink
+{
+public:
+    explicit ClockedSink(int maxBufferCount) : _maxBufferCount(maxBufferCount), _warmupBlocks(maxBufferCount) {}
+
+    ~ClockedSink() { stop(); }
+
+    void play()
+    {
+        _start  = Clock::now();
+        _thread = std::thread([this] { clockLoop(); });
+    }
+
+    void setFormat(int bytesPerSecond, int blockAlign)
+    {
+        std::lock_guard lock(_mutex);
+        _tickBytes = bytesPerSecond * TickMs / 1000 / blockAlign * blockAlign;
+        _device.resize(_tickBytes);
+    }
+
+    // wait like for the BufferEnd callback, until a buffer of the rotation is free
+    void waitForFreeBuffer()
+    {
+        std::unique_lock lock(_mutex);
+        _cv.wait(lock, [this] { return (int)_blocks.size() < _maxBufferCount; });
+    }
+
+    void submit(const uint8_t* data, int size)
+    {
+        std::lock_guard lock(_mutex);
+        _blocks.push_back({ data, size, 0, Clock::now() });
+    }
+
+    // drop the queued blocks, as FlushSourceBuffers before a seek
+    void flush()
+    {
+        std::lock_guard lock(_mutex);
+        _blocks.clear();
+        _seekPending  = true;
+        _seekTime     = Clock::now();
+        _warmupBlocks = _maxBufferCount;
+        _cv.notify_all();
+    }
+
+    // play out the queue and stop the clock
+    void finish()
+    {
+        {
+            std::unique_lock lock(_mutex);
+            _ended = true;
+            _cv.wait(lock, [this] { return _blocks.empty(); });
+        }
+        stop();
+    }
+
+    PlaybackStats stats(Clock::time_point play, Clock::time_point firstBlock) const
+    {
+        PlaybackStats stats = {};
+        stats.firstBlockMs = toMs(firstBlock - play);
+        stats.firstAudioMs = toMs(_firstAudio - play);
+        stats.seekMs       = toMs(_seekAudio - _seekTime);
+        stats.underruns    = _underruns;
+
+        if (!_latencies.empty())
+        {
+            double sum = 0, sumSquares = 0;
+            for (auto latency : _latencies)
+            {
+                sum += latency;
+                sumSquares += latency * latency;
+            }
+            auto n          = (double)_latencies.size();
+            stats.latencyMs = sum / n;
+            stats.jitterMs  = std::sqrt(std::max(0.0, sumSquares / n - stats.latencyMs * stats.latencyMs));
+        }
+        return stats;
+    }
+
+private:
+    struct Block
+    {
+        const uint8_t*    data;
+        int               size;
+        int               played;
+        Clock::time_point submitted;
+    };
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _stopping = true;
+        }
+        if (_thread.joinable())
+        {
+            _thread.join();
+        }
+    }
+
+    void clockLoop()
+    {
+        for (int64_t tick = 1; ; ++tick)
+        {
+            std::this_thread::sleep_until(_start + std::chrono::milliseconds(TickMs) * tick);
+
+            std::lock_guard lock(_mutex);
+            if (_stopping)
+            {
+                return;
+            }
+            playTick(Clock::now());
+            _cv.notify_all();
+        }
+    }
+
+    void playTick(Clock::time_point now)
+    {
+        auto remainingSize = _tickBytes;
+        while (remainingSize > 0 && !_blocks.empty())
+        {
+            auto& block = _blocks.front();
+            if (block.played == 0)
+            {
+                startBlock(block, now);
+            }
+
+            auto size = std::min(remainingSize, block.size - block.played);
+            memcpy(_device.data() + _tickBytes - remainingSize, block.data + block.played, size);
+            block.played  += size;
+            remainingSize -= size;
+
+            if (block.played == block.size)
+            {
+                _blocks.pop_front();
+            }
+        }
+
+        // waiting for the first block after play or seek is measured apart
+        if (remainingSize > 0 && _tickBytes > 0 && _audible && !_seekPending && !_ended)
+        {
+            ++_underruns;
+        }
+    }
+
+    void startBlock(const Block& block, Clock::time_point now)
+    {
+        if (!_audible)
+        {
+            _audible    = true;
+            _firstAudio = now;
+        }
+        if (_seekPending)
+        {
+            _seekPending = false;
+            _seekAudio   = now;
+        }
+
+        // the first blocks only fill up the queue
+        if (_warmupBlocks > 0)
+        {
+            --_warmupBlocks;
+        }
+        else
+        {
+            _latencies.push_back(toMs(now - block.submitted));
+        }
+    }
+
+    int                     _maxBufferCount;
+    Clock::time_point       _start;
+    std::thread             _thread;
+    std::mutex              _mutex;
+    std::condition_variable _cv;
+
+    std::deque<Block>    _blocks;
+    std::vector<uint8_t> _device; // what one tick plays
+    int                  _tickBytes = 0;
+    bool                 _stopping  = false;
+    bool                 _ended     = false;
+
+    bool                _audible     = false;
+    bool                _seekPending = false;
+    int                 _warmupBlocks;
+    int                 _underruns = 0;
+    Clock::time_point   _firstAudio;
+    Clock::time_point   _seekTime;
+    Clock::time_point   _seekAudio;
+    std::vector<double> _latencies;
+};
+
+// busy threads competing with the decoder and the sink for the cores
+class CpuContention
+{
+public:
+    explicit CpuContention(int threadsNum)
+    {
+        for (int i = 0; i < threadsNum; ++i)
+        {
+            _threads.emplace_back([this]
+            {
+                volatile double x = 1;
+                while (!_stop.load(std::memory_order_relaxed))
+                {
+                    x = x * 1.0000001 + 1e-9;
+                }
+            });
+        }
+    }
+
+    ~CpuContention()
+    {
+        _stop = true;
+        for (auto& thread : _threads)
+        {
+            thread.join();
+        }
+    }
+
+private:
+    std::atomic<bool>        _stop = false;
+    std::vector<std::thread> _threads;
+};
+
+//
+// Benchmark
+//
+
+static PlaybackStats runPlayback(const char* filename, BufferSetting setting)
+{
+    std::vector<std::vector<uint8_t>> buffers(setting.maxBufferCount,
+                                              std::vector<uint8_t>(setting.streamingBufferSize));
+    ClockedSink sink(setting.maxBufferCount);
+
+    // opening the decoder counts towards the first block
+    auto play = Clock::now();
+    sink.play();
+    StreamDecoder decoder;
+    exitIf(decoder.open(filename) < 0, "Could not open stream");
+
+    Clock::time_point firstBlock;
+    int64_t           submitted    = 0;
+    double            mediaSeconds = 0;
+    bool              seeked       = false;
+    while (true)
+    {
+        auto& buffer = buffers[submitted % setting.maxBufferCount];
+        sink.waitForFreeBuffer();
+        auto storeSize = decoder.fill(buffer.data(), setting.streamingBufferSize);
+        exitIf(storeSize < 0, "Error during decoding");
+        if (storeSize == 0)
+        {
+            break;
+        }
+
+        if (submitted++ == 0)
+        {
+            firstBlock = Clock::now();
+            sink.setFormat(decoder.bytesPerSecond(), decoder.blockAlign());
+        }
+        sink.submit(buffer.data(), storeSize);
+
+        mediaSeconds += (double)storeSize / decoder.bytesPerSecond();
+        if (!seeked && mediaSeconds >= PlaySeconds)
+        {
+            sink.flush();
+            exitIf(decoder.seek((int64_t)(decoder.index().samplesNum() * SeekFraction)) < 0, "Seek error");
+            seeked       = true;
+            mediaSeconds = 0;
+        }
+        else if (seeked && mediaSeconds >= AfterSeekSeconds)
+        {
+            break;
+        }
+    }
+    sink.finish();
+
+    return sink.stats(play, firstBlock);
+}
+
+// main.cpp's startup: map the whole file, full probe, decoder, then the first frame
+static double startupFullProbe(const char* filename)
+{
+    auto start = Clock::now();
+
+    uint8_t* fileBuffer = nullptr;
+    size_t   fileSize   = 0;
+    exitIf(av_file_map(filename, &fileBuffer, &fileSize, 0, nullptr) < 0, "file map error");
+
+    AVFormatContext* fmtCtx = nullptr;
+    exitIf(avformat_open_input(&fmtCtx, filename, nullptr, nullptr) < 0, "format open error");
+    exitIf(avformat_find_stream_info(fmtCtx, nullptr) < 0, "find stream info error");
+
+    auto decoder = avcodec_find_decoder(fmtCtx->streams[0]->codecpar->codec_id);
+    exitIf(!decoder, "Decoder not found");
+    auto decCtx = avcodec_alloc_context3(decoder);
+    exitIf(!decCtx, "Could not allocate audio decoder context");
+    exitIf(avcodec_parameters_to_context(decCtx, fmtCtx->streams[0]->codecpar) < 0, "Could not copy codec parameters");
+    exitIf(openDecoder(decCtx, decoder) < 0, "Could not open decoder");
+
+    auto pkt   = av_packet_alloc();
+    auto frame = av_frame_alloc();
+    exitIf(!pkt || !frame, "Could not allocate packet or frame");
+    while (avcodec_receive_frame(decCtx, frame) < 0)
+    {
+        exitIf(av_read_frame(fmtCtx, pkt) < 0, "No audio frame");
+        avcodec_send_packet(decCtx, pkt);
+        av_packet_unref(pkt);
+    }
+
+    auto elapsed = toMs(Clock::now() - start);
+
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&decCtx);
+    avformat_close_input(&fmtCtx);
+    av_file_unmap(fileBuffer, fileSize);
+    return elapsed;
+}
+
+static double startupFastStart(const char* filename, const FastStartOptions& options, bool cachedFormat)
+{
+    if (!cachedFormat)
+    {
+        clearInputFormatCache();
+    }
+
+    auto frame = av_frame_alloc();
+    exitIf(!frame, "Could not allocate frame");
+
+    double elapsed;
+    {
+        FastStartInput input;
+        auto start = Clock::now();
+        exitIf(input.open(filename, options) < 0, "format open error");
+        exitIf(input.receiveFrame(frame) < 0, "Error during decoding");
+        elapsed = toMs(Clock::now() - start);
+    }
+
+    av_frame_free(&frame);
+    return elapsed;
+}
+
+static void benchStartup(const char* filename)
+{
+    FastStartOptions eager;
+    eager.lazyMetadata = false;
+
+    struct StartupPath
+    {
+        const char*                 name;
+        std::function<double(void)> run;
+    };
+    StartupPath paths[] =
+    {
+        { "full probe",          [&] { return startupFullProbe(filename); } },
+        { "fast start, cold",    [&] { return startupFastStart(filename, {}, false); } },
+        { "fast start, cached",  [&] { return startupFastStart(filename, {}, true); } },
+        { "fast start, eager",   [&] { return startupFastStart(filename, eager, true); } },
+    };
+
+    printf("%-22s %10s %10s\n", "startup", "mean ms", "min ms");
+    for (auto& path : paths)
+    {
+        path.run(); // warm the page cache
+
+        double sum = 0, best = 1e9;
+        for (int i = 0; i < StartupRuns; ++i)
+        {
+            auto ms = path.run();
+            sum += ms;
+            best = std::min(best, ms);
+        }
+        printf("%-22s %10.3f %10.3f\n", path.name, sum / StartupRuns, best);
+    }
+    printf("\n");
+}
+
+void benchPlayback()
+{
+    auto path      = fixturePath(FixtureDefault);
+    auto hwThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+    benchStartup(path.c_str());
+
+    printf("%-8s %-6s %-8s %10s %10s %11s %10s %10s %10s\n",
+           "buffer", "count", "busy", "block ms", "audio ms", "seek ms", "latency", "jitter", "underruns");
+
+    for (auto factor : ContentionFactors)
+    {
+        CpuContention contention(factor * hwThreads);
+
+        for (auto setting : BufferSettings)
+        {
+            auto stats = runPlayback(path.c_str(), setting);
+            printf("%-8d %-6d %-8d %10.2f %10.2f %10.2f%c %10.2f %10.2f %10d\n",
+                   setting.streamingBufferSize, setting.maxBufferCount, factor * hwThreads,
+                   stats.firstBlockMs, stats.firstAudioMs, stats.seekMs, stats.seekMs > SeekTargetMs ? '*' : ' ',
+                   stats.latencyMs, stats.jitterMs, stats.underruns);
+        }
+    }
+}
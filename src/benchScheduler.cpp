@@ -0,0 +1,56 @@
+/**
+ * @file decode scheduling benchmark
+ * @example benchScheduler.cpp
+ *
+ * Start growing numbers of streams of a fixture on a DecodeScheduler with
+ * half the cores as workers, one stream every JoinIntervalMs, and let them
+ * play for RunSeconds once all joined. For earliest deadline first and for
+ * round-robin, report the underruns and the worst lateness.
+ */
+
+#include "DecodeScheduler.hpp"
+#include "Fixtures.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <stdio.h>
+
+constexpr int    StreamCounts[] = { 64, 256, 512, 1024 };
+constexpr int    JoinIntervalMs = 2;
+constexpr double RunSeconds     = 5.0;
+constexpr double BufferSeconds  = 0.5;
+constexpr double QuantumSeconds = 0.05;
+
+void benchScheduler()
+{
+    auto path       = fixturePath(FixtureDefault);
+    auto workersNum = std::max(1u, std::thread::hardware_concurrency() / 2);
+
+    printf("%u workers, %.0f ms buffers\n", workersNum, BufferSeconds * 1000);
+    printf("%8s %-6s %10s %10s %14s\n", "streams", "policy", "quanta", "underruns", "max late ms");
+    for (auto streamsNum : StreamCounts)
+    {
+        for (auto policy : { SchedulePolicy::EarliestDeadline, SchedulePolicy::RoundRobin })
+        {
+            DecodeScheduler scheduler(workersNum, policy, BufferSeconds, QuantumSeconds);
+            for (int i = 0; i < streamsNum; ++i)
+            {
+                if (scheduler.addStream(path.c_str()) < 0)
+                {
+                    fprintf(stderr, "Could not open %s\n", path.c_str());
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(JoinIntervalMs));
+            }
+            std::this_thread::sleep_for(std::chrono::duration<double>(RunSeconds));
+            scheduler.stop();
+
+            auto stats = scheduler.stats();
+            printf("%8d %-6s %10lld %10lld %14.1f\n", streamsNum,
+                   policy == SchedulePolicy::EarliestDeadline ? "edf" : "rr",
+                   (long long)stats.quanta, (long long)stats.missedDeadlines, stats.maxLatenessMs);
+        }
+    }
+}
@@ -0,0 +1,173 @@
+/**
+ * @file shared decoder thread pool benchmark
+ * @example benchSharedPool.cpp
+ *
+ * Decode the same file on N concurrent decoder contexts, once with
+ * libavcodec's per-context threads and once with every context dispatching
+ * onto ThreadPool::shared(), and compare throughput and context switches.
+ *
+ * Only decoders with slice threading ever dispatch onto the pool. The audio
+ * decoders of libavcodec have none (mp3 and mp2 have no threading at all,
+ * flac and alac only frame threading), so with the audio fixtures both modes
+ * decode on the calling thread and the numbers only show the setup cost.
+ * The threading column reports what every context actually got.
+ */
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include "DecoderSetup.hpp"
+#include "Fixtures.hpp"
+
+#include <chrono>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+constexpr int StreamCounts[] = { 1, 4, 16, 64 };
+
+static void exitIf(bool b, std::string_view msg)
+{
+    if (b)
+    {
+        fprintf(stderr, "%s\n", msg.data());
+        exit(EXIT_FAILURE);
+    }
+}
+
+// voluntary + involuntary context switches of the process, -1 if unknown
+static int64_t getContextSwitches()
+{
+#ifdef __linux__
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+#else
+    return -1;
+#endif
+}
+
+static const char* threadTypeName(int threadType)
+{
+    if (threadType & FF_THREAD_SLICE)
+    {
+        return "slice";
+    }
+    return threadType & FF_THREAD_FRAME ? "frame" : "none";
+}
+
+// decode the whole audio stream, return number of decoded samples per channel
+// and the threading libavcodec activated in threadType
+static int64_t decodeFile(const char* filename, bool useSharedPool, int& threadType)
+{
+    AVFormatContext* fmtCtx = nullptr;
+    exitIf(avformat_open_input(&fmtCtx, filename, nullptr, nullptr) < 0, "format open error");
+    exitIf(avformat_find_stream_info(fmtCtx, nullptr) < 0, "find stream info error");
+
+    const AVCodec* decoder = nullptr;
+    auto streamIndex = av_find_best_stream(fmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, &decoder, 0);
+    exitIf(streamIndex < 0, "Cannot find audio stream");
+
+    auto decCtx = avcodec_alloc_context3(decoder);
+    exitIf(!decCtx, "Could not allocate audio decoder context");
+    exitIf(avcodec_parameters_to_context(decCtx, fmtCtx->streams[streamIndex]->codecpar) < 0,
+           "Could not copy codec parameters");
+
+    if (useSharedPool)
+    {
+        exitIf(openDecoder(decCtx, decoder, nullptr, true) < 0, "Could not open decoder");
+    }
+    else
+    {
+        decCtx->thread_count = 0; // let libavcodec spawn its own threads
+        exitIf(avcodec_open2(decCtx, decoder, nullptr) < 0, "Could not open decoder");
+    }
+
+    threadType = decCtx->active_thread_type;
+
+    auto pkt = av_packet_alloc();
+    exitIf(!pkt, "Could not allocate packet");
+    auto frame = av_frame_alloc();
+    exitIf(!frame, "Could not allocate frame");
+
+    int64_t samples = 0;
+    auto receiveFrames = [&]
+    {
+        while (avcodec_receive_frame(decCtx, frame) >= 0)
+        {
+            samples += frame->nb_samples;
+        }
+    };
+
+    while (av_read_frame(fmtCtx, pkt) >= 0)
+    {
+        if (pkt->stream_index == streamIndex && avcodec_send_packet(decCtx, pkt) >= 0)
+        {
+            receiveFrames();
+        }
+        av_packet_unref(pkt);
+    }
+
+    // flush the decoder
+    avcodec_send_packet(decCtx, nullptr);
+    receiveFrames();
+
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&decCtx);
+    avformat_close_input(&fmtCtx);
+
+    return samples;
+}
+
+void benchSharedPool()
+{
+    auto path     = fixturePath(FixtureDefault);
+    auto filename = path.c_str();
+
+    printf("%-8s %-10s %-10s %12s %14s %12s\n", "streams", "threads", "threading", "wall ms", "Msamples/s", "ctx switch");
+
+    for (auto streamCount : StreamCounts)
+    {
+        for (auto useSharedPool : { false, true })
+        {
+            std::vector<int64_t>     samples(streamCount);
+            std::vector<int>         threadTypes(streamCount);
+            std::vector<std::thread> streams;
+
+            auto switches = getContextSwitches();
+            auto start    = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < streamCount; ++i)
+            {
+                streams.emplace_back([&, i] { samples[i] = decodeFile(filename, useSharedPool, threadTypes[i]); });
+            }
+            for (auto& stream : streams)
+            {
+                stream.join();
+            }
+
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            switches     = switches < 0 ? -1 : getContextSwitches() - switches;
+
+            int64_t total = 0;
+            for (auto n : samples)
+            {
+                total += n;
+            }
+
+            printf("%-8d %-10s %-10s %12.1f %14.2f %12lld\n",
+                   streamCount, useSharedPool ? "shared" : "context", threadTypeName(threadTypes[0]),
+                   elapsed * 1000, total / elapsed / 1e6, (long long)switches);
+        }
+    }
+}
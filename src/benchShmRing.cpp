@@ -0,0 +1,166 @@
+/**
+ * @file shared memory ring benchmark
+ * @example benchShmRing.cpp
+ *
+ * Send decoded size blocks through ShmRingWriter to a forked reader process.
+ * - throughput: blocks written as fast as the reader takes them, per ring size
+ * - wakeup latency: a block every LatencyPeriodUs to a reader asleep in the
+ *   futex, from publish to the reader holding the block
+ * Linux only.
+ */
+
+#ifdef __linux__
+
+#include "ShmRing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+constexpr int    SampleRate       = 44100;
+constexpr int    ChannelsNum      = 2;
+constexpr int    BlockSamples     = 1152; // an mp3 frame
+constexpr int    ThroughputBlocks = 100000;
+constexpr size_t RingSizes[]      = { 64 << 10, 1 << 20, 16 << 20 };
+constexpr size_t LatencyRingSize  = 1 << 20;
+constexpr int    LatencyBlocks    = 2000;
+constexpr int    LatencyPeriodUs  = 1000;
+constexpr float  SampleValue      = 0.25f;
+
+// written by the reader process
+struct ReaderResult
+{
+    int64_t samples;
+    int64_t endNs;
+    int64_t latenciesNs[LatencyBlocks];
+    int     latenciesNum;
+    bool    ok;
+};
+
+static void exitIf(bool b, std::string_view msg)
+{
+    if (b)
+    {
+        fprintf(stderr, "%s\n", msg.data());
+        exit(EXIT_FAILURE);
+    }
+}
+
+static int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void readerMain(int fd, ReaderResult& result)
+{
+    ShmRingReader reader;
+    if (reader.openFd(fd) < 0)
+    {
+        return;
+    }
+
+    ShmRingBlock block;
+    bool         isIntact = true;
+    while (reader.next(block) == 1)
+    {
+        auto heldNs = nowNs();
+        if (block.kind == ShmRecordKind::Samples)
+        {
+            isIntact       &= block.data[0] == SampleValue && block.data[block.samples * block.channelsNum - 1] == SampleValue;
+            result.samples += block.samples;
+            if (result.latenciesNum < LatencyBlocks)
+            {
+                result.latenciesNs[result.latenciesNum++] = heldNs - block.timestampNs;
+            }
+        }
+        else if (block.kind == ShmRecordKind::End)
+        {
+            result.endNs = heldNs;
+        }
+    }
+    result.ok = isIntact && result.endNs > 0;
+}
+
+// Fork a reader of a new ring, run write(writer), wait for the reader.
+template <typename Write>
+static const ReaderResult& runReader(size_t ringSize, Write write)
+{
+    static auto result = (ReaderResult*)mmap(nullptr, sizeof(ReaderResult), PROT_READ | PROT_WRITE,
+                                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    exitIf(result == MAP_FAILED, "Could not map the results");
+    *result = {};
+
+    ShmRingWriter writer;
+    exitIf(writer.create(nullptr, ringSize) < 0, "Could not create the ring");
+
+    auto pid = fork();
+    exitIf(pid < 0, "Could not fork");
+    if (pid == 0)
+    {
+        readerMain(writer.fd(), *result);
+        _exit(0);
+    }
+
+    write(writer);
+    writer.close();
+    waitpid(pid, nullptr, 0);
+    exitIf(!result->ok, "The reader failed");
+    return *result;
+}
+
+void benchShmRing()
+{
+    std::vector<float>        planes((size_t)BlockSamples * ChannelsNum, SampleValue);
+    std::vector<const float*> channels;
+    for (int ch = 0; ch < ChannelsNum; ++ch)
+    {
+        channels.push_back(planes.data() + (size_t)ch * BlockSamples);
+    }
+
+    printf("%10s %12s %12s %12s\n", "ring KB", "blocks/s", "MB/s", "x rt");
+    for (auto ringSize : RingSizes)
+    {
+        int64_t startNs = 0;
+        auto&   result  = runReader(ringSize, [&](ShmRingWriter& writer) {
+            startNs = nowNs();
+            writer.begin(SampleRate, ChannelsNum);
+            for (int i = 0; i < ThroughputBlocks; ++i)
+            {
+                writer.process(channels.data(), BlockSamples);
+            }
+            writer.end();
+        });
+
+        auto seconds = (result.endNs - startNs) * 1e-9;
+        auto bytes   = (double)result.samples * ChannelsNum * sizeof(float);
+        printf("%10zu %12.0f %12.1f %12.0f\n", ringSize >> 10, ThroughputBlocks / seconds,
+               bytes / seconds / 1048576, result.samples / (double)SampleRate / seconds);
+    }
+
+    auto& result = runReader(LatencyRingSize, [&](ShmRingWriter& writer) {
+        writer.begin(SampleRate, ChannelsNum);
+        for (int i = 0; i < LatencyBlocks; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(LatencyPeriodUs));
+            writer.process(channels.data(), BlockSamples);
+        }
+        writer.end();
+    });
+
+    std::vector<int64_t> latencies(result.latenciesNs, result.latenciesNs + result.latenciesNum);
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[(size_t)(p * (latencies.size() - 1))] / 1000.0; };
+    printf("wakeup latency us: p50 %.1f, p99 %.1f, max %.1f\n", percentile(0.5), percentile(0.99), percentile(1.0));
+}
+
+#endif
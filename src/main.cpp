@@ -13,6 +13,12 @@ extern "C"
 }
 
 #include "AudioInfo.hpp"
+#include "ChannelMatrix.hpp"
+#include "DecoderSetup.hpp"
+#include "DspChain.hpp"
+#include "FastStart.hpp"
+#include "PcmKernels.hpp"
+#include "Silence.hpp"
 
 #include <algorithm>
 #include <string>
@@ -30,6 +36,16 @@ extern "C"
 constexpr int StreamingBufferSize = 65536;
 constexpr int MaxBufferCount      = 3;
 
+// start the voice from the first decoded frame, see playFastStart()
+constexpr bool FastStart = true;
+
+// drop the intro and shorten long silences while playing, see SilenceSkipper,
+// off by default as it also shortens the pauses of the music itself
+constexpr bool SkipSilence = false;
+
+// keep the output from clipping, its 5 ms lookahead delays the track by as much
+constexpr bool UseLimiter = false;
+
 static void exitIfFailed(HRESULT hr)
 {
     if (FAILED(hr))
@@ -118,6 +134,181 @@ static std::vector<uint8_t> decode(AVCodecContext* decCtx, AVPacket* pkt, AVFram
     return pcm;
 }
 
+// Wake the streaming loop whenever the voice finished a buffer.
+struct BufferEndCallback : IXAudio2VoiceCallback
+{
+    HANDLE event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+    ~BufferEndCallback() { CloseHandle(event); }
+
+    void STDMETHODCALLTYPE OnBufferEnd(void*) override { SetEvent(event); }
+    void STDMETHODCALLTYPE OnStreamEnd() override {}
+    void STDMETHODCALLTYPE OnVoiceProcessingPassEnd() override {}
+    void STDMETHODCALLTYPE OnVoiceProcessingPassStart(UINT32) override {}
+    void STDMETHODCALLTYPE OnBufferStart(void*) override {}
+    void STDMETHODCALLTYPE OnLoopEnd(void*) override {}
+    void STDMETHODCALLTYPE OnVoiceError(void*, HRESULT) override {}
+};
+
+// Play without mapping the file or running the full probe first: the voice is
+// created from the first decoded frame, then the rest streams through
+// MaxBufferCount rotating buffers while the duration is probed in background.
+// Sources whose channels differ from the device's outputChannelsNum are remixed
+// while interleaving. Every buffer runs through dsp right before it is submitted,
+// at the end silence pushes the samples its latency holds back out.
+// With SkipSilence only the parts of each frame the skipper keeps are played.
+static void playFastStart(IXAudio2* xaudio2, const char* filename, int outputChannelsNum, DspChain& dsp)
+{
+    FastStartInput input;
+    exitIf(input.open(filename) < 0, "format open error");
+
+    auto frame = av_frame_alloc();
+    exitIf(!frame, "Could not allocate frame");
+    exitIf(input.receiveFrame(frame) < 0, "Error during decoding");
+
+    AudioInfo audioInfo(input.formatContext(), frame);
+    // the frames are read per channel below
+    exitIf(frame->format != AV_SAMPLE_FMT_FLTP, "This mp3 file's sample format is not planar float point.");
+
+    // layouts the default matrix can't map play with the file's channels as before
+    auto            channelsNum = frame->ch_layout.nb_channels;
+    ChannelMatrix   matrix;
+    AVChannelLayout outputLayout;
+    av_channel_layout_default(&outputLayout, outputChannelsNum);
+    if (matrix.buildDefault(frame->ch_layout, outputLayout) < 0)
+    {
+        matrix = ChannelMatrix::identity(channelsNum);
+    }
+    av_channel_layout_uninit(&outputLayout);
+
+    auto isRemixed      = !matrix.isIdentity();
+    auto outChannelsNum = matrix.outChannelsNum();
+    audioInfo.setChannelsNum(outChannelsNum);
+
+    BufferEndCallback    callback;
+    IXAudio2SourceVoice* sourceVoice;
+    auto wfx = audioInfo.getWaveFormat();
+    exitIfFailed(xaudio2->CreateSourceVoice(&sourceVoice, &wfx, 0, XAUDIO2_DEFAULT_FREQ_RATIO, &callback));
+    exitIfFailed(sourceVoice->Start());
+
+    auto bufferSamples = StreamingBufferSize / (int)sizeof(float) / outChannelsNum;
+
+    dsp.prepare(frame->sample_rate, outChannelsNum, bufferSamples);
+
+    auto           sampleRate = frame->sample_rate;
+    SilenceSkipper skipper;
+    skipper.begin(sampleRate, channelsNum);
+
+    std::vector<std::vector<float>> buffers(MaxBufferCount, std::vector<float>(bufferSamples * outChannelsNum));
+    int  bufferIndex = 0;
+    int  storeCount  = 0; // samples per channel in the current buffer
+    bool isEnd       = false; // decoding reached the end
+
+    auto waitQueued = [&](UINT32 maxQueued)
+    {
+        XAUDIO2_VOICE_STATE state;
+        for (sourceVoice->GetState(&state); state.BuffersQueued > maxQueued; sourceVoice->GetState(&state))
+        {
+            WaitForSingleObject(callback.event, INFINITE);
+        }
+    };
+
+    auto submit = [&](bool isLast)
+    {
+        dsp.process(buffers[bufferIndex].data(), storeCount);
+
+        XAUDIO2_BUFFER buf = {};
+        buf.AudioBytes = storeCount * outChannelsNum * sizeof(float);
+        buf.pAudioData = (const BYTE*)buffers[bufferIndex].data();
+        buf.Flags      = isLast ? XAUDIO2_END_OF_STREAM : 0;
+        exitIfFailed(sourceVoice->SubmitSourceBuffer(&buf));
+
+        bufferIndex = (bufferIndex + 1) % MaxBufferCount;
+        storeCount  = 0;
+    };
+
+    while (!isEnd)
+    {
+        SampleRange ranges[2] = { { 0, frame->nb_samples } };
+        auto        rangesNum = SkipSilence ? skipper.keep((const float* const*)frame->extended_data, frame->nb_samples, ranges) : 1;
+        for (int r = 0; r < rangesNum; ++r)
+        {
+            // split the range over buffers when it doesn't fit
+            auto rangeEnd = ranges[r].offset + ranges[r].count;
+            for (int offset = ranges[r].offset; offset < rangeEnd;)
+            {
+                auto count = std::min(rangeEnd - offset, bufferSamples - storeCount);
+                auto out   = buffers[bufferIndex].data() + storeCount * outChannelsNum;
+                if (isRemixed)
+                {
+                    matrix.apply((const float* const*)frame->extended_data, offset, count, out);
+                }
+                else
+                {
+                    interleaveFloat((const float* const*)frame->extended_data, channelsNum, offset, count, out);
+                }
+                offset     += count;
+                storeCount += count;
+
+                // the next buffer of the rotation is free once fewer than all are queued
+                if (storeCount == bufferSamples)
+                {
+                    submit(false);
+                    waitQueued(MaxBufferCount - 1);
+                }
+            }
+        }
+        av_frame_unref(frame);
+
+        // durationMs is -1 when the container doesn't tell
+        if (audioInfo.duration() == 0 && input.metadataReady() && input.metadata().durationMs > 0)
+        {
+            audioInfo.setDuration(input.metadata().durationMs);
+            printf("duration: %llu ms\n", (unsigned long long)audioInfo.duration());
+        }
+
+        auto ret = input.receiveFrame(frame);
+        exitIf(ret < 0 && ret != AVERROR_EOF, "Error during decoding");
+        isEnd = ret == AVERROR_EOF;
+    }
+
+    // the last latencySamples are still inside the effects
+    for (auto tailCount = dsp.latencySamples(); tailCount > 0;)
+    {
+        auto count = std::min(tailCount, bufferSamples - storeCount);
+        std::fill_n(buffers[bufferIndex].data() + storeCount * outChannelsNum, count * outChannelsNum, 0.0f);
+        storeCount += count;
+        tailCount  -= count;
+
+        if (storeCount == bufferSamples && tailCount > 0)
+        {
+            submit(false);
+            waitQueued(MaxBufferCount - 1);
+        }
+    }
+    if (storeCount > 0)
+    {
+        submit(true);
+    }
+    else
+    {
+        sourceVoice->Discontinuity();
+    }
+    waitQueued(0);
+
+    sourceVoice->DestroyVoice();
+    av_frame_free(&frame);
+
+    if (SkipSilence)
+    {
+        printf("silence skipped: %.1f s\n", (double)skipper.skippedSamples() / sampleRate);
+    }
+    for (auto& cost : dsp.costs())
+    {
+        printf("%s: %.2f ns/sample\n", cost.name, cost.nsPerSample);
+    }
+}
+
 int main()
 {
     av_log_set_level(AV_LOG_DEBUG);
@@ -138,6 +329,25 @@ int main()
     // Read File
     //
     auto     filename   = "D:/music/四季ノ唄.mp3";
+    if (FastStart)
+    {
+        Limiter  limiter;
+        DspChain dsp;
+        if (UseLimiter)
+        {
+            dsp.add(&limiter);
+        }
+
+        XAUDIO2_VOICE_DETAILS masterDetails;
+        masterVoice->GetVoiceDetails(&masterDetails);
+        playFastStart(xaudio2, filename, masterDetails.InputChannels, dsp);
+
+        masterVoice->DestroyVoice();
+        xaudio2->Release();
+        CoUninitialize();
+        return 0;
+    }
+
     uint8_t* fileBuffer = nullptr;
     size_t   fileSize   = 0;
     auto ret = av_file_map((char*)filename, &fileBuffer, &fileSize, 0, nullptr);
@@ -184,7 +394,7 @@ int main()
     exitIf(!decCtx, "Could not allocate audio decoder context");
 
     // open decoder
-    exitIf(avcodec_open2(decCtx, decoder, nullptr) < 0, "Could not open decoder");
+    exitIf(openDecoder(decCtx, decoder) < 0, "Could not open decoder");
 
     // get parser
     auto parser = av_parser_init(decoder->id);
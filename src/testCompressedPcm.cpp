@@ -0,0 +1,69 @@
+/**
+ * @file compressed buffered audio example
+ * @example testCompressedPcm.cpp
+ *
+ * Decode a fixture fully into CompressedPcm at 16 and 24 bits, then play it
+ * out in blocks as a looping player would and scrub to random positions.
+ * Report memory against raw float and decompression speed against real time.
+ */
+
+#include "BatchDecoder.hpp"
+#include "CompressedPcm.hpp"
+#include "Fixtures.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+
+constexpr int PlayBlockSamples = 8192;
+constexpr int ScrubsNum        = 2000;
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void testCompressedPcm()
+{
+    auto path = fixturePath(FixtureDefault);
+
+    printf("%-5s %10s %10s %6s %10s %12s %12s\n",
+           "bits", "raw MB", "stored MB", "ratio", "decode ms", "play x rt", "scrub us");
+    for (auto bits : { 16, 24 })
+    {
+        CompressedPcm pcm(bits);
+        FrameTap*     taps[] = { &pcm };
+
+        auto start = std::chrono::steady_clock::now();
+        if (decodeFile(path.c_str(), taps) < 0 || pcm.samplesNum() == 0)
+        {
+            fprintf(stderr, "Could not decode %s\n", path.c_str());
+            return;
+        }
+        auto decodeMs = msSince(start);
+
+        std::vector<float> block(PlayBlockSamples * pcm.channelsNum());
+
+        start = std::chrono::steady_clock::now();
+        for (int64_t position = 0; auto count = pcm.read(position, PlayBlockSamples, block.data());)
+        {
+            position += count;
+        }
+        auto playMs = msSince(start);
+
+        std::mt19937_64 rng(1);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ScrubsNum; ++i)
+        {
+            pcm.read(rng() % pcm.samplesNum(), PlayBlockSamples, block.data());
+        }
+        auto scrubUs = msSince(start) * 1000 / ScrubsNum;
+
+        auto audioMs = pcm.samplesNum() * 1000.0 / pcm.sampleRate();
+        printf("%-5d %10.2f %10.2f %6.2f %10.2f %12.0f %12.2f\n", bits,
+               pcm.rawBytes() / 1048576.0, pcm.compressedBytes() / 1048576.0,
+               (double)pcm.rawBytes() / pcm.compressedBytes(), decodeMs, audioMs / playMs, scrubUs);
+    }
+}
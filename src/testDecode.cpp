@@ -10,6 +10,8 @@ extern "C"
 #include <libavcodec/avcodec.h>
 }
 
+#include "DecoderSetup.hpp"
+
 #include <algorithm>
 #include <string>
 #include <string_view>
@@ -136,7 +138,7 @@ void testDecode()
     exitIf(!decCtx, "Could not allocate audio decoder context");
 
     // open decoder
-    exitIf(avcodec_open2(decCtx, decoder, nullptr) < 0, "Could not open decoder");
+    exitIf(openDecoder(decCtx, decoder) < 0, "Could not open decoder");
 
     // get parser
     auto parser = av_parser_init(decoder->id);
@@ -0,0 +1,65 @@
+/**
+ * @file duplicate detection example
+ * @example testDuplicates.cpp
+ *
+ * Hash the decoded audio of every fixture in one parallel pass,
+ * then list the files whose audio is identical and the ones sharing windows.
+ */
+
+#include "BatchDecoder.hpp"
+#include "Fixtures.hpp"
+#include "PcmHash.hpp"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdio.h>
+
+void testDuplicates()
+{
+    auto files = fixtureLibrary();
+
+    std::vector<PcmHasher> hashers(files.size());
+    auto results = decodeBatch(files, [&](size_t index) { return std::vector<FrameTap*>{ &hashers[index] }; });
+
+    // whole track duplicates, tags and container don't matter
+    std::map<uint64_t, std::vector<size_t>> tracks;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (results[i] >= 0)
+        {
+            tracks[hashers[i].hash().track].push_back(i);
+        }
+    }
+
+    for (auto& [hash, indices] : tracks)
+    {
+        if (indices.size() > 1)
+        {
+            printf("identical audio %016llx:\n", (unsigned long long)hash);
+            for (auto i : indices)
+            {
+                printf("    %s\n", files[i].c_str());
+            }
+        }
+    }
+
+    // partial duplicates, e.g. a truncated copy, share leading windows
+    std::unordered_map<uint64_t, size_t> firstOwner;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (results[i] < 0 || hashers[i].hash().windows.empty())
+        {
+            continue;
+        }
+
+        auto [it, isNew] = firstOwner.try_emplace(hashers[i].hash().windows[0], i);
+        if (!isNew && hashers[it->second].hash().track != hashers[i].hash().track)
+        {
+            printf("same opening %ds: %s <-> %s\n", hashers[i].hash().windowSeconds,
+                   files[it->second].c_str(), files[i].c_str());
+        }
+    }
+}
@@ -0,0 +1,58 @@
+/**
+ * @file pcm export example
+ * @example testExport.cpp
+ *
+ * Decode every fixture in parallel to WAV files in the temp directory,
+ * print the write throughput, then remove the files.
+ */
+
+#include "BatchDecoder.hpp"
+#include "Fixtures.hpp"
+#include "PcmFileWriter.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+void testExport()
+{
+    auto files = fixtureLibrary();
+    auto dir   = std::filesystem::temp_directory_path();
+
+    std::vector<std::string>                    outputs;
+    std::vector<std::unique_ptr<PcmFileWriter>> writers;
+    for (auto& file : files)
+    {
+        auto& output = outputs.emplace_back((dir / std::filesystem::path(file).filename().replace_extension(".wav")).string());
+        writers.emplace_back(std::make_unique<PcmFileWriter>(output, PcmContainer::Wav, PcmSampleFormat::Float32));
+    }
+
+    auto start   = std::chrono::steady_clock::now();
+    auto results = decodeBatch(files, [&](size_t index) { return std::vector<FrameTap*>{ writers[index].get() }; });
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int64_t totalSize = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (results[i] < 0 || !writers[i]->ok())
+        {
+            printf("export failed: %s\n", files[i].c_str());
+            continue;
+        }
+        totalSize += writers[i]->fileSize();
+    }
+
+    printf("%zu files, %.1f MB in %.2f s, %.1f MB/s\n",
+           files.size(), totalSize / 1e6, elapsed, totalSize / 1e6 / elapsed);
+
+    writers.clear();
+    std::error_code ec;
+    for (auto& output : outputs)
+    {
+        std::filesystem::remove(output, ec);
+    }
+}
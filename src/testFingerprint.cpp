@@ -0,0 +1,77 @@
+/**
+ * @file perceptual fingerprint example
+ * @example testFingerprint.cpp
+ *
+ * Fingerprint every fixture in one parallel decoding pass, store each
+ * fingerprint as sidecar, then match every track against the catalog and
+ * list the recordings found more than once, re-encoded or not.
+ */
+
+#include "BatchDecoder.hpp"
+#include "Fingerprint.hpp"
+#include "Fixtures.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+void testFingerprint()
+{
+    auto files = fixtureLibrary();
+
+    std::vector<FingerprintExtractor> extractors(files.size());
+
+    auto start   = std::chrono::steady_clock::now();
+    auto results = decodeBatch(files, [&](size_t index) { return std::vector<FrameTap*>{ &extractors[index] }; });
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%zu files fingerprinted in %.2f s\n", files.size(), elapsed);
+
+    auto sidecar = (std::filesystem::temp_directory_path() / "fingerprint.afp").string();
+
+    FingerprintCatalog  catalog;
+    std::vector<size_t> fileOf; // catalog index to file index
+    size_t              bytes = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (results[i] < 0 || extractors[i].error() < 0)
+        {
+            printf("decode failed: %s\n", files[i].c_str());
+            continue;
+        }
+
+        // round trip through the sidecar format
+        auto&       fingerprint = extractors[i].fingerprint();
+        Fingerprint loaded;
+        if (!saveFingerprint(sidecar.c_str(), fingerprint) || !loadFingerprint(sidecar.c_str(), loaded) ||
+            loaded.frames != fingerprint.frames)
+        {
+            printf("sidecar round trip failed: %s\n", files[i].c_str());
+        }
+        catalog.add(fingerprint);
+        fileOf.push_back(i);
+        bytes += fingerprint.frames.size() * sizeof(uint32_t);
+    }
+    std::error_code ec;
+    std::filesystem::remove(sidecar, ec);
+    printf("catalog: %zu tracks, %.1f KiB\n", catalog.size(), bytes / 1024.0);
+
+    // every track against the whole catalog, only the later one of a pair is reported
+    start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < catalog.size(); ++q)
+    {
+        auto& query = extractors[fileOf[q]].fingerprint();
+        for (auto& match : catalog.match(query))
+        {
+            if (match.index < q)
+            {
+                printf("same recording (%.1f%% bits differ, offset %d):\n    %s\n    %s\n",
+                       match.bitErrorRate * 100, match.offset, files[fileOf[match.index]].c_str(), files[fileOf[q]].c_str());
+            }
+        }
+    }
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%zu queries in %.3f s\n", catalog.size(), elapsed);
+}
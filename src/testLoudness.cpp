@@ -0,0 +1,43 @@
+/**
+ * @file loudness analysis example
+ * @example testLoudness.cpp
+ *
+ * Decode every fixture in parallel and print its EBU R128
+ * loudness and ReplayGain, measured while decoding.
+ */
+
+#include "BatchDecoder.hpp"
+#include "Fixtures.hpp"
+#include "LoudnessAnalyzer.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+void testLoudness()
+{
+    auto files = fixtureLibrary();
+
+    std::vector<LoudnessAnalyzer> analyzers(files.size());
+
+    auto start   = std::chrono::steady_clock::now();
+    auto results = decodeBatch(files, [&](size_t index) { return std::vector<FrameTap*>{ &analyzers[index] }; });
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%10s %8s %10s %10s %10s  %s\n", "LUFS", "LRA", "dBTP", "dBFS", "gain dB", "file");
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (results[i] < 0)
+        {
+            printf("%-54s  %s\n", "decode failed", files[i].c_str());
+            continue;
+        }
+
+        auto& r = analyzers[i].result();
+        printf("%10.2f %8.2f %10.2f %10.2f %10.2f  %s\n",
+               r.integrated, r.range, r.truePeak, r.samplePeak, r.replayGain, files[i].c_str());
+    }
+    printf("%zu files in %.2f s\n", files.size(), elapsed);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file decoded audio cache example
+ * @example testPcmCache.cpp
+ *
+ * Play a fixture twice through PcmDiskCache: the first time decodes and
+ * stores it, the replay maps the stored audio and never opens a decoder.
+ * A truncated copy must not leave an entry behind.
+ */
+
+#include "BatchDecoder.hpp"
+#include "Fixtures.hpp"
+#include "PcmDiskCache.hpp"
+
+#include <chrono>
+#include <vector>
+
+#include <stdio.h>
+
+constexpr int PlayBlockSamples = 8192;
+
+// hand the audio out in blocks as a player would, return samples per channel
+static int64_t play(const char* filename, PcmDiskCache& cache)
+{
+    CachedPcm pcm;
+    if (!cache.open(filename, pcm))
+    {
+        auto writer = cache.writer(filename);
+        FrameTap* taps[] = { writer.get() };
+        if (!writer || decodeFile(filename, taps) < 0 || !cache.open(filename, pcm))
+        {
+            return -1;
+        }
+    }
+
+    std::vector<float> block(PlayBlockSamples * pcm.channelsNum());
+    int64_t            position = 0;
+    while (auto count = pcm.readFloat(position, PlayBlockSamples, block.data()))
+    {
+        position += count;
+    }
+    return position;
+}
+
+void testPcmCache()
+{
+    auto path = fixturePath(FixtureDefault);
+
+    PcmDiskCache cache("pcm-cache", 512ull << 20);
+    for (auto pass : { "first", "replay" })
+    {
+        auto start   = std::chrono::steady_clock::now();
+        auto samples = play(path.c_str(), cache);
+        auto ms      = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("%-8s %10lld samples %10.2f ms\n", pass, (long long)samples, ms);
+    }
+
+    // decodes without error, but to fewer samples than the Xing header states
+    auto truncated = fixturePath(FixtureTruncated);
+    auto stores    = cache.counters().stores;
+    auto writer    = cache.writer(truncated.c_str());
+    if (writer)
+    {
+        FrameTap* taps[] = { writer.get() };
+        decodeFile(truncated.c_str(), taps);
+        writer.reset();
+
+        CachedPcm pcm;
+        if (cache.open(truncated.c_str(), pcm) || cache.counters().stores != stores)
+        {
+            fprintf(stderr, "truncated decode left a cache entry\n");
+        }
+        else
+        {
+            printf("truncated decode not cached\n");
+        }
+    }
+
+    auto counters = cache.counters();
+    printf("hits %lld, misses %lld, stores %lld, evictions %lld\n",
+           (long long)counters.hits, (long long)counters.misses,
+           (long long)counters.stores, (long long)counters.evictions);
+}
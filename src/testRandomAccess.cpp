@@ -0,0 +1,77 @@
+/**
+ * @file random access reading example
+ * @example testRandomAccess.cpp
+ *
+ * Read sample ranges of a fixture through PcmReader the way analysis tools
+ * do: a sequential pass, random windows, then windows overlapping the random
+ * ones, and print block hit rate and read latency of each pattern.
+ */
+
+#include "Fixtures.hpp"
+#include "PcmReader.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+
+constexpr int64_t WindowSamples = 4096;
+constexpr int     RandomReads   = 200;
+
+static void printStats(const char* pattern, const PcmReaderStats& stats)
+{
+    auto missReads = stats.reads - stats.hitReads;
+    printf("%-12s %8lld %8.1f%% %10.3f %10.3f %10.3f %12lld %12lld\n", pattern,
+           (long long)stats.reads, stats.hitRate() * 100,
+           stats.hitReads ? stats.hitReadMs / stats.hitReads : 0.0,
+           missReads ? stats.missReadMs / missReads : 0.0,
+           stats.maxReadMs, (long long)stats.decodedSamples, (long long)stats.preRollSamples);
+}
+
+void testRandomAccess()
+{
+    auto path = fixturePath(FixtureDefault);
+
+    PcmBlockCache cache(16 << 20);
+    PcmReader     reader(&cache);
+    if (reader.open(path.c_str()) < 0)
+    {
+        printf("open failed: %s\n", path.c_str());
+        return;
+    }
+
+    std::vector<float> out(WindowSamples * reader.channelsNum());
+    std::mt19937       random(1);
+    std::uniform_int_distribution<int64_t> anyStart(0, std::max<int64_t>(0, reader.samplesNum() - WindowSamples));
+
+    printf("%-12s %8s %9s %10s %10s %10s %12s %12s\n",
+           "pattern", "reads", "hit rate", "hit ms", "miss ms", "max ms", "decoded", "pre-roll");
+
+    for (int64_t start = 0; start < reader.samplesNum(); start += WindowSamples)
+    {
+        reader.read(start, start + WindowSamples, out.data());
+    }
+    printStats("sequential", reader.stats());
+
+    // the sequential pass may hold all of it, start over
+    reader.open(path.c_str());
+    reader.resetStats();
+
+    std::vector<int64_t> starts(RandomReads);
+    for (auto& start : starts)
+    {
+        start = anyStart(random);
+        reader.read(start, start + WindowSamples, out.data());
+    }
+    printStats("random", reader.stats());
+
+    reader.resetStats();
+    for (auto start : starts)
+    {
+        reader.read(start + WindowSamples / 2, start + WindowSamples * 3 / 2, out.data());
+    }
+    printStats("overlapping", reader.stats());
+
+    printf("cache %.1f MiB\n", cache.bytes() / 1048576.0);
+}
@@ -0,0 +1,89 @@
+/**
+ * @file sample accurate seek example
+ * @example testSeek.cpp
+ *
+ * Decode a fixture from start to end, then seek to positions around frame
+ * boundaries and at random, and compare what StreamDecoder hands out after
+ * each seek with the forward decode.
+ */
+
+#include "Fixtures.hpp"
+#include "StreamDecoder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+
+constexpr int CompareSamples = 4096;
+constexpr int RandomSeeks    = 16;
+
+void testSeek()
+{
+    auto path = fixturePath(FixtureDefault);
+
+    StreamDecoder decoder;
+    if (decoder.open(path.c_str()) < 0)
+    {
+        printf("open failed: %s\n", path.c_str());
+        return;
+    }
+
+    auto& index       = decoder.index();
+    auto  channelsNum = decoder.channelsNum();
+
+    // forward reference
+    std::vector<float>   reference;
+    std::vector<uint8_t> block(65536);
+    int                  storeSize;
+    while ((storeSize = decoder.fill(block.data(), (int)block.size())) > 0)
+    {
+        auto samples = (const float*)block.data();
+        reference.insert(reference.end(), samples, samples + storeSize / sizeof(float));
+    }
+    printf("%zu frames, %lld samples indexed, %zu decoded\n",
+           index.size(), (long long)index.samplesNum(), reference.size() / channelsNum);
+
+    std::vector<int64_t> positions = { 0, 1, index.samplesNum() / 2 };
+    for (auto frame : { (size_t)1, (size_t)2, (size_t)10, index.size() / 2, index.size() - 1 })
+    {
+        auto sample = index[frame].firstSample;
+        positions.insert(positions.end(), { sample - 1, sample, sample + 1 });
+    }
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int64_t> anySample(0, index.samplesNum() - 1);
+    for (int i = 0; i < RandomSeeks; ++i)
+    {
+        positions.push_back(anySample(random));
+    }
+
+    printf("%12s %10s %12s\n", "sample", "seek ms", "max diff");
+    std::vector<float> samples(CompareSamples * channelsNum);
+    for (auto position : positions)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto ret   = decoder.seek(position);
+        storeSize  = ret < 0 ? ret : decoder.fill((uint8_t*)samples.data(), (int)(samples.size() * sizeof(float)));
+        auto ms    = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (storeSize < 0)
+        {
+            printf("%12lld seek or decode failed\n", (long long)position);
+            continue;
+        }
+
+        auto offset   = std::min(reference.size(), (size_t)position * channelsNum);
+        auto expected = std::min(samples.size(), reference.size() - offset);
+        auto count    = (size_t)storeSize / sizeof(float);
+        auto maxDiff  = 0.0f;
+        for (size_t i = 0; i < std::min(count, expected); ++i)
+        {
+            maxDiff = std::max(maxDiff, std::abs(samples[i] - reference[offset + i]));
+        }
+
+        printf("%12lld %10.3f %12g %s\n", (long long)position, ms, maxDiff,
+               count == expected && maxDiff == 0 ? "exact" : "MISMATCH");
+    }
+}
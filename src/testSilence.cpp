@@ -0,0 +1,115 @@
+/**
+ * @file silence detection example
+ * @example testSilence.cpp
+ *
+ * Measure what a SilenceDetector adds to decoding a fixture, export the
+ * fixture with intro and outro cut by a SilenceSkipTap, then list the intro,
+ * outro and silent regions of every fixture in one parallel pass.
+ */
+
+#include "BatchDecoder.hpp"
+#include "Fixtures.hpp"
+#include "PcmFileWriter.hpp"
+#include "Silence.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+constexpr int Runs = 3;
+
+// fastest of Runs decodes of filename into the taps made by makeTaps
+template <typename MakeTaps>
+static double bestDecodeMs(const char* filename, MakeTaps makeTaps)
+{
+    double best = 1e300;
+    for (int i = 0; i < Runs; ++i)
+    {
+        auto taps  = makeTaps();
+        auto start = std::chrono::steady_clock::now();
+        if (decodeFile(filename, taps.taps) < 0)
+        {
+            return -1;
+        }
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+struct NoTaps
+{
+    std::vector<FrameTap*> taps;
+};
+
+struct DetectorTaps
+{
+    SilenceDetector        detector;
+    std::vector<FrameTap*> taps = { &detector };
+};
+
+void testSilence()
+{
+    auto path = fixturePath(FixtureDefault);
+
+    auto plainMs    = bestDecodeMs(path.c_str(), [] { return NoTaps(); });
+    auto detectedMs = bestDecodeMs(path.c_str(), [] { return DetectorTaps(); });
+    if (plainMs < 0 || detectedMs < 0)
+    {
+        fprintf(stderr, "Could not decode %s\n", path.c_str());
+        return;
+    }
+    printf("decode %.2f ms, with silence detection %.2f ms (%+.1f%%)\n",
+           plainMs, detectedMs, (detectedMs / plainMs - 1) * 100);
+
+    // single pass export without intro and outro, pauses inside stay whole
+    auto output = (std::filesystem::temp_directory_path() / "trimmed.wav").string();
+    {
+        PcmFileWriter   writer(output);
+        SilenceSkipTap  skip(writer);
+        SilenceDetector exportDetector;
+        FrameTap*       exportTaps[] = { &skip, &exportDetector };
+        if (decodeFile(path.c_str(), exportTaps) < 0 || !writer.ok())
+        {
+            fprintf(stderr, "Could not export %s\n", path.c_str());
+        }
+        else
+        {
+            auto& detected = exportDetector.result();
+            auto  trimmed  = detected.audioStart + detected.samplesNum - detected.audioEnd;
+            printf("trimmed export: %lld samples skipped\n", (long long)skip.skippedSamples());
+            if (skip.skippedSamples() != trimmed)
+            {
+                fprintf(stderr, "expected intro and outro, %lld samples\n", (long long)trimmed);
+            }
+        }
+    }
+    std::error_code ec;
+    std::filesystem::remove(output, ec);
+
+    // batch analysis of a library
+    auto files = fixtureLibrary();
+
+    std::vector<SilenceDetector> detectors(files.size());
+    auto results = decodeBatch(files, [&](size_t index) { return std::vector<FrameTap*>{ &detectors[index] }; });
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (results[i] < 0)
+        {
+            printf("decode failed: %s\n", files[i].c_str());
+            continue;
+        }
+
+        auto& result = detectors[i].result();
+        printf("%s: intro %lld, outro %lld samples, %zu silent regions\n", files[i].c_str(),
+               (long long)result.audioStart, (long long)(result.samplesNum - result.audioEnd), result.regions.size());
+        for (auto& region : result.regions)
+        {
+            printf("    %lld - %lld\n", (long long)region.start, (long long)region.end);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file spectrum analyzer example
+ * @example testSpectrum.cpp
+ *
+ * Decode the short fixture at the pace of playback into a SpectrumAnalyzer,
+ * poll the newest spectrum at DisplayHz as a monitoring UI would, then print
+ * the last one as bars and what the analyzer thread cost in percent of a core.
+ */
+
+#include "BatchDecoder.hpp"
+#include "Fixtures.hpp"
+#include "SpectrumAnalyzer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string_view>
+#include <thread>
+
+#include <stdio.h>
+
+constexpr auto Fixture   = "stereo_44k_cbr_short";
+constexpr int  DisplayHz = 30;
+constexpr int  BarWidth  = 60; // characters for 60 dB
+
+static void exitIf(bool b, std::string_view msg)
+{
+    if (b)
+    {
+        fprintf(stderr, "%s\n", msg.data());
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Forwards to the analyzer no faster than the audio would play.
+class PacedTap : public FrameTap
+{
+public:
+    explicit PacedTap(FrameTap& tap) : _tap(tap) {}
+
+    void begin(int sampleRate, int channelsNum) override
+    {
+        _sampleRate = sampleRate;
+        _start      = std::chrono::steady_clock::now();
+        _tap.begin(sampleRate, channelsNum);
+    }
+
+    void process(const float* const* channels, int samples) override
+    {
+        std::this_thread::sleep_until(_start + std::chrono::duration<double>((double)_position / _sampleRate));
+        _tap.process(channels, samples);
+        _position += samples;
+    }
+
+    void end() override { _tap.end(); }
+    void abort() override { _tap.abort(); }
+
+    double seconds() const { return (double)_position / _sampleRate; }
+
+private:
+    FrameTap&                             _tap;
+    int                                   _sampleRate = 0;
+    int64_t                               _position   = 0;
+    std::chrono::steady_clock::time_point _start;
+};
+
+void testSpectrum()
+{
+    auto path = fixturePath(Fixture);
+
+    SpectrumAnalyzer  analyzer;
+    PacedTap          paced(analyzer);
+    FrameTap*         taps[] = { &paced };
+    std::atomic<bool> isDone = false;
+    int               ret    = 0;
+
+    std::thread decoder([&]
+    {
+        ret    = decodeFile(path.c_str(), taps);
+        isDone = true;
+    });
+
+    // the display side, it only ever sees whole spectra
+    int64_t lastSequence = 0;
+    int     updates      = 0;
+    while (!isDone)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000 / DisplayHz));
+        auto& frame = analyzer.latest();
+        if (frame.sequence != lastSequence)
+        {
+            lastSequence = frame.sequence;
+            ++updates;
+        }
+    }
+    decoder.join();
+    exitIf(ret < 0, "Failed to decode file");
+    exitIf(analyzer.error() < 0, "Failed to set up the transform");
+
+    auto& frame = analyzer.latest();
+    auto& edges = analyzer.bandFrequencies();
+    for (size_t b = 0; b < frame.bands.size(); ++b)
+    {
+        auto width = std::clamp((int)((frame.bands[b] + 60) * BarWidth / 60), 0, BarWidth);
+        printf("%7.0f Hz %6.1f dB %.*s\n", edges[b], frame.bands[b], width,
+               "############################################################");
+    }
+
+    auto stats = analyzer.stats();
+    printf("%lld analyses, %d display updates, %lld samples dropped\n",
+           (long long)stats.analyses, updates, (long long)stats.droppedSamples);
+    printf("analyzer thread: %.3f%% of a core\n", stats.busySeconds / paced.seconds() * 100);
+}
@@ -0,0 +1,95 @@
+/**
+ * @file multi-sink fan out example
+ * @example testTee.cpp
+ *
+ * Decode a fixture once into a TeeTap feeding a recorder, a loudness
+ * analyzer and an output that plays at OutputSpeed times real time.
+ * The recorder and the analyzer must see every frame and hold the decoder
+ * back when behind, the output drops its oldest blocks instead.
+ */
+
+#include "BatchDecoder.hpp"
+#include "Fixtures.hpp"
+#include "LoudnessAnalyzer.hpp"
+#include "PcmFileWriter.hpp"
+#include "TeeTap.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+#include <stdio.h>
+
+constexpr double OutputSpeed  = 20.0;
+constexpr size_t RecordBlocks = 64;
+constexpr size_t OutputBlocks = 8;
+
+// Takes the time of the audio it gets, divided by OutputSpeed.
+class PacedOutput : public FrameTap
+{
+public:
+    void begin(int sampleRate, int /*channelsNum*/) override
+    {
+        _sampleRate = sampleRate;
+        _samplesNum = 0;
+    }
+
+    void process(const float* const* /*channels*/, int samples) override
+    {
+        _samplesNum += samples;
+        std::this_thread::sleep_for(std::chrono::duration<double>(samples / (_sampleRate * OutputSpeed)));
+    }
+
+    int64_t samplesNum() const { return _samplesNum; }
+
+private:
+    int     _sampleRate = 0;
+    int64_t _samplesNum = 0;
+};
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void testTee()
+{
+    auto path   = fixturePath(FixtureDefault);
+    auto output = (std::filesystem::temp_directory_path() / "tee.wav").string();
+
+    PcmFileWriter    recorder(output);
+    LoudnessAnalyzer analyzer;
+    PacedOutput      player;
+
+    TeeTap tee;
+    auto   recordSink  = tee.addSink(&recorder, RecordBlocks, OverflowPolicy::Block);
+    auto   analyzeSink = tee.addSink(&analyzer, RecordBlocks, OverflowPolicy::Block);
+    auto   playSink    = tee.addSink(&player,   OutputBlocks, OverflowPolicy::DropOldest);
+
+    FrameTap* taps[] = { &tee };
+
+    auto start    = std::chrono::steady_clock::now();
+    auto ret      = decodeFile(path.c_str(), taps);
+    auto decodeMs = msSince(start);
+    tee.drain();
+    auto drainMs  = msSince(start);
+    if (ret < 0)
+    {
+        fprintf(stderr, "Could not decode %s\n", path.c_str());
+        return;
+    }
+
+    printf("decode %.2f ms, all sinks done %.2f ms\n", decodeMs, drainMs);
+    printf("%-10s %10s %10s %10s\n", "sink", "blocks", "dropped", "max queued");
+    for (auto [name, sink] : { std::pair{ "recorder", recordSink }, { "analyzer", analyzeSink }, { "output", playSink } })
+    {
+        auto stats = tee.stats(sink);
+        printf("%-10s %10lld %10lld %10lld\n", name,
+               (long long)stats.blocks, (long long)stats.dropped, (long long)stats.maxQueued);
+    }
+    printf("recorded %lld bytes, %.2f LUFS, output played %lld samples\n",
+           (long long)recorder.fileSize(), analyzer.result().integrated, (long long)player.samplesNum());
+
+    std::error_code ec;
+    std::filesystem::remove(output, ec);
+}
@@ -0,0 +1,42 @@
+/**
+ * @file tempo analysis example
+ * @example testTempo.cpp
+ *
+ * Decode every fixture in parallel and print its tempo and onset count,
+ * measured while decoding, as tags for the whole library.
+ */
+
+#include "BatchDecoder.hpp"
+#include "Fixtures.hpp"
+#include "TempoAnalyzer.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+void testTempo()
+{
+    auto files = fixtureLibrary();
+
+    std::vector<TempoAnalyzer> analyzers(files.size());
+
+    auto start   = std::chrono::steady_clock::now();
+    auto results = decodeBatch(files, [&](size_t index) { return std::vector<FrameTap*>{ &analyzers[index] }; });
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%8s %6s %8s  %s\n", "BPM", "conf", "onsets", "file");
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (results[i] < 0 || analyzers[i].error() < 0)
+        {
+            printf("%-24s  %s\n", "decode failed", files[i].c_str());
+            continue;
+        }
+
+        auto& r = analyzers[i].result();
+        printf("%8.2f %6.2f %8zu  %s\n", r.bpm, r.confidence, r.onsets.size(), files[i].c_str());
+    }
+    printf("%zu files in %.2f s\n", files.size(), elapsed);
+}
@@ -0,0 +1,62 @@
+/**
+ * @file waveform peaks example
+ * @example testWaveform.cpp
+ *
+ * Build the waveform pyramid of the default fixture while decoding it, save
+ * it as sidecar in the temp directory, then query a few zoom levels from the
+ * memory mapped sidecar.
+ */
+
+#include "BatchDecoder.hpp"
+#include "Fixtures.hpp"
+#include "WaveformPeaks.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stdio.h>
+
+constexpr int ColumnCount = 1920;
+
+static void exitIf(bool b, std::string_view msg)
+{
+    if (b)
+    {
+        fprintf(stderr, "%s\n", msg.data());
+        exit(EXIT_FAILURE);
+    }
+}
+
+void testWaveform()
+{
+    auto filename  = fixturePath(FixtureDefault);
+    auto peaksPath = (std::filesystem::temp_directory_path() / "waveform.peaks").string();
+
+    WaveformBuilder builder;
+    FrameTap*       taps[] = { &builder };
+    exitIf(decodeFile(filename.c_str(), taps) < 0, "Failed to decode file");
+    exitIf(!builder.save(peaksPath.c_str()), "Failed to save peaks");
+
+    WaveformPeaks peaks;
+    exitIf(!peaks.open(peaksPath.c_str()), "Failed to open peaks");
+
+    std::vector<PeakBin> columns(ColumnCount);
+
+    // whole track, then zoom in 10x each time
+    for (auto length = peaks.totalSamples(); length >= ColumnCount; length /= 10)
+    {
+        auto start = std::chrono::steady_clock::now();
+        peaks.query(0, 0, length, columns);
+        auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        printf("%12lld samples: %8.1f us, first column min %.3f max %.3f rms %.3f\n",
+               (long long)length, elapsed, columns[0].min, columns[0].max, columns[0].rms);
+    }
+
+    peaks.close();
+    std::error_code ec;
+    std::filesystem::remove(peaksPath, ec);
+}
@@ -0,0 +1,284 @@
+/**
+ * @file fixture corpus generator
+ *
+ * Encode the deterministic inputs listed in Fixtures.hpp with the mp3
+ * encoder of the linked libavcodec (libmp3lame), plus truncated and
+ * corrupted copies.
+ *
+ * Usage: genFixtures [output directory]
+ */
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+}
+
+#include "Fixtures.hpp"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <numbers>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stdio.h>
+
+constexpr double SilenceSeconds = 1.0; // at both ends
+constexpr double BeatSeconds    = 0.5; // 120 BPM
+
+static void exitIf(bool b, std::string_view msg)
+{
+    if (b)
+    {
+        fprintf(stderr, "%s\n", msg.data());
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+// Signal
+//
+
+// Tones, noise bursts on every beat and a noise floor, framed by silence.
+// Noise comes from a seeded LCG, so every run produces the same samples.
+class SignalGenerator
+{
+public:
+    SignalGenerator(int sampleRate, int channelsNum, int64_t totalSamples)
+        : _sampleRate(sampleRate), _totalSamples(totalSamples), _noiseStates(channelsNum)
+    {
+        for (int ch = 0; ch < channelsNum; ++ch)
+        {
+            _noiseStates[ch] = 12345u + ch * 7919u;
+        }
+    }
+
+    float sample(int64_t n, int ch)
+    {
+        using std::numbers::pi;
+
+        auto noise = nextNoise(ch);
+        auto t     = (double)n / _sampleRate;
+        if (t < SilenceSeconds || n >= _totalSamples - (int64_t)(SilenceSeconds * _sampleRate))
+        {
+            return 0.0f;
+        }
+
+        auto envelope = 0.5 + 0.5 * std::sin(2 * pi * 0.2 * t);
+        auto tones    = 0.25 * std::sin(2 * pi * 220.0 * (ch + 1) * t)
+                      + 0.15 * std::sin(2 * pi * 330.5 * t + ch);
+        auto beatTime = std::fmod(t, BeatSeconds);
+        auto beat     = 0.3 * std::exp(-30 * beatTime) * noise;
+
+        return (float)(envelope * tones + beat + 0.01 * noise);
+    }
+
+private:
+    // LCG, uniform in [-1, 1)
+    double nextNoise(int ch)
+    {
+        _noiseStates[ch] = _noiseStates[ch] * 1664525u + 1013904223u;
+        return (_noiseStates[ch] >> 8) / double(1 << 24) * 2 - 1;
+    }
+
+    int                   _sampleRate;
+    int64_t               _totalSamples;
+    std::vector<uint32_t> _noiseStates;
+};
+
+static AVSampleFormat pickSampleFormat(const AVCodec* encoder)
+{
+    const AVSampleFormat* formats = nullptr;
+    avcodec_get_supported_config(nullptr, encoder, AV_CODEC_CONFIG_SAMPLE_FORMAT, 0, (const void**)&formats, nullptr);
+
+    // prefer float, the decoders output it too
+    for (auto p = formats; p && *p != AV_SAMPLE_FMT_NONE; ++p)
+    {
+        if (*p == AV_SAMPLE_FMT_FLTP)
+        {
+            return *p;
+        }
+    }
+    return formats ? formats[0] : AV_SAMPLE_FMT_FLTP;
+}
+
+static void fillFrame(AVFrame* frame, SignalGenerator& signal, int64_t firstSample)
+{
+    auto fmt         = (AVSampleFormat)frame->format;
+    auto isPlanar    = av_sample_fmt_is_planar(fmt);
+    auto channelsNum = frame->ch_layout.nb_channels;
+
+    for (int i = 0; i < frame->nb_samples; ++i)
+    {
+        for (int ch = 0; ch < channelsNum; ++ch)
+        {
+            auto x     = signal.sample(firstSample + i, ch);
+            auto plane = isPlanar ? frame->data[ch] : frame->data[0];
+            auto index = isPlanar ? i : i * channelsNum + ch;
+
+            switch (av_get_packed_sample_fmt(fmt))
+            {
+            case AV_SAMPLE_FMT_FLT: ((float*)plane)[index]   = x;                                      break;
+            case AV_SAMPLE_FMT_S16: ((int16_t*)plane)[index] = (int16_t)std::lrint(x * 32767.0);      break;
+            case AV_SAMPLE_FMT_S32: ((int32_t*)plane)[index] = (int32_t)std::lrint(x * 2147483647.0); break;
+            default:                exitIf(true, "Unsupported encoder sample format");
+            }
+        }
+    }
+}
+
+//
+// Encode
+//
+
+static void writePackets(AVCodecContext* encCtx, AVFormatContext* fmtCtx, AVStream* stream, AVPacket* pkt)
+{
+    while (avcodec_receive_packet(encCtx, pkt) >= 0)
+    {
+        av_packet_rescale_ts(pkt, encCtx->time_base, stream->time_base);
+        pkt->stream_index = stream->index;
+        exitIf(av_interleaved_write_frame(fmtCtx, pkt) < 0, "Error while writing packet");
+    }
+}
+
+static void encodeFixture(const FixtureSpec& spec, const std::string& path)
+{
+    // Only the mp3 muxer writes the ID3 and Xing headers the specs ask for,
+    // so there is no fallback to another encoder.
+    auto encoder = avcodec_find_encoder(AV_CODEC_ID_MP3);
+    exitIf(!encoder, "mp3 encoder not found, build ffmpeg with libmp3lame");
+
+    AVFormatContext* fmtCtx = nullptr;
+    exitIf(avformat_alloc_output_context2(&fmtCtx, nullptr, "mp3", path.c_str()) < 0,
+           "Could not allocate output context");
+    fmtCtx->flags |= AVFMT_FLAG_BITEXACT;
+
+    auto encCtx = avcodec_alloc_context3(encoder);
+    exitIf(!encCtx, "Could not allocate encoder context");
+
+    encCtx->sample_rate = spec.sampleRate;
+    encCtx->sample_fmt  = pickSampleFormat(encoder);
+    encCtx->time_base   = { 1, spec.sampleRate };
+    encCtx->flags      |= AV_CODEC_FLAG_BITEXACT;
+    av_channel_layout_default(&encCtx->ch_layout, spec.channelsNum);
+    if (spec.isVbr)
+    {
+        encCtx->flags         |= AV_CODEC_FLAG_QSCALE;
+        encCtx->global_quality = 4 * FF_QP2LAMBDA; // lame -V4
+    }
+    else
+    {
+        encCtx->bit_rate = 64000 * spec.channelsNum;
+    }
+    exitIf(avcodec_open2(encCtx, encoder, nullptr) < 0, "Could not open encoder");
+
+    auto stream = avformat_new_stream(fmtCtx, nullptr);
+    exitIf(!stream, "Could not create stream");
+    stream->time_base = encCtx->time_base;
+    exitIf(avcodec_parameters_from_context(stream->codecpar, encCtx) < 0, "Could not copy encoder parameters");
+
+    exitIf(avio_open(&fmtCtx->pb, path.c_str(), AVIO_FLAG_WRITE) < 0, "Could not open output file");
+
+    AVDictionary* options = nullptr;
+    av_dict_set(&options, "id3v2_version", spec.hasId3 ? "4" : "0", 0);
+    av_dict_set(&options, "write_xing", spec.hasXing ? "1" : "0", 0);
+    if (spec.hasId3)
+    {
+        av_dict_set(&fmtCtx->metadata, "title", spec.name, 0);
+        av_dict_set(&fmtCtx->metadata, "artist", "learn-ffmpeg fixtures", 0);
+    }
+    exitIf(avformat_write_header(fmtCtx, &options) < 0, "Could not write header");
+    av_dict_free(&options);
+
+    auto pkt = av_packet_alloc();
+    exitIf(!pkt, "Could not allocate packet");
+    auto frame = av_frame_alloc();
+    exitIf(!frame, "Could not allocate frame");
+
+    frame->nb_samples  = encCtx->frame_size;
+    frame->format      = encCtx->sample_fmt;
+    frame->sample_rate = encCtx->sample_rate;
+    exitIf(av_channel_layout_copy(&frame->ch_layout, &encCtx->ch_layout) < 0, "Could not copy channel layout");
+    exitIf(av_frame_get_buffer(frame, 0) < 0, "Could not allocate frame data");
+
+    // whole frames only, the tail is silence anyway
+    auto totalSamples = (int64_t)spec.seconds * spec.sampleRate;
+    totalSamples      = (totalSamples + frame->nb_samples - 1) / frame->nb_samples * frame->nb_samples;
+
+    SignalGenerator signal(spec.sampleRate, spec.channelsNum, totalSamples);
+    for (int64_t n = 0; n < totalSamples; n += frame->nb_samples)
+    {
+        exitIf(av_frame_make_writable(frame) < 0, "Frame is not writable");
+        fillFrame(frame, signal, n);
+        frame->pts = n;
+
+        exitIf(avcodec_send_frame(encCtx, frame) < 0, "Error sending frame to the encoder");
+        writePackets(encCtx, fmtCtx, stream, pkt);
+    }
+
+    // flush the encoder
+    exitIf(avcodec_send_frame(encCtx, nullptr) < 0, "Error flushing the encoder");
+    writePackets(encCtx, fmtCtx, stream, pkt);
+
+    exitIf(av_write_trailer(fmtCtx) < 0, "Could not write trailer");
+
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&encCtx);
+    avio_closep(&fmtCtx->pb);
+    avformat_free_context(fmtCtx);
+}
+
+//
+// Damaged Variants
+//
+
+static std::vector<char> readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    exitIf(!file, "Could not read fixture");
+    return std::vector<char>(std::istreambuf_iterator<char>(file), {});
+}
+
+static void writeFile(const std::string& path, const char* data, size_t size)
+{
+    std::ofstream file(path, std::ios::binary);
+    exitIf(!file.write(data, size), "Could not write fixture");
+}
+
+int main(int argc, char** argv)
+{
+    std::string dir = argc > 1 ? argv[1] : FixtureDir;
+    std::filesystem::create_directories(dir);
+
+    auto pathOf = [&](std::string_view name) { return dir + "/" + std::string(name) + ".mp3"; };
+
+    // before any output, so a build without libmp3lame leaves no partial corpus
+    exitIf(!avcodec_find_encoder(AV_CODEC_ID_MP3), "mp3 encoder not found, build ffmpeg with libmp3lame");
+
+    for (auto& spec : FixtureSpecs)
+    {
+        printf("%s\n", spec.name);
+        encodeFixture(spec, pathOf(spec.name));
+    }
+
+    auto data = readFile(pathOf(FixtureDefault));
+
+    printf("%s\n", FixtureTruncated);
+    writeFile(pathOf(FixtureTruncated), data.data(), data.size() * 6 / 10);
+
+    // every 997th byte of the middle fifth
+    printf("%s\n", FixtureCorrupted);
+    for (auto i = data.size() * 2 / 5; i < data.size() * 3 / 5; i += 997)
+    {
+        data[i] ^= 0x5a;
+    }
+    writeFile(pathOf(FixtureCorrupted), data.data(), data.size());
+
+    return 0;
+}